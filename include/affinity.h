@@ -0,0 +1,52 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stddef.h>
+#include <mpi.h>
+
+/* Máximo de CPUs que se leen de la topología */
+#define AFFINITY_MAX_CPUS 4096
+
+/* CPUs de la máquina ordenadas por nodo NUMA (como las ve /sys/devices/system/node) */
+typedef struct {
+    int n_cpus;
+    int n_nodes;
+    int cpus[AFFINITY_MAX_CPUS];   /* id de CPU, agrupadas por nodo */
+    int nodes[AFFINITY_MAX_CPUS];  /* nodo NUMA de cada entrada de cpus */
+} CpuTopology;
+
+/* Lugar elegido para un proceso */
+typedef struct {
+    int cpu;        /* CPU a la que quedó fijado (-1 si no se pudo) */
+    int numa_node;  /* nodo NUMA de esa CPU */
+} Placement;
+
+/**
+ * Lee la topología de /sys (nodos NUMA y sus CPUs), restringida a las CPUs que el proceso
+ * tiene permitidas (cgroups, binding de mpirun). Sin información NUMA queda un solo nodo.
+ *
+ * @return 0 si hay al menos una CPU, -1 si no se pudo leer
+ */
+int affinity_read_topology(CpuTopology* topo);
+
+/**
+ * Fija cada proceso a un core. Los procesos de una misma máquina (MPI_COMM_TYPE_SHARED)
+ * se reparten en bloques sobre las CPUs ordenadas por nodo NUMA: los ranks locales
+ * consecutivos comparten nodo y rank 0 queda en el nodo 0. Como todo lo que se aloja
+ * después lo toca primero el mismo core, los buffers quedan en memoria local.
+ * Rank 0 de comm imprime la ubicación de todos. Es colectiva.
+ *
+ * @param comm Comunicador con todos los procesos
+ * @param placement Salida: CPU y nodo de este proceso
+ * @return 0 si se fijó la afinidad, -1 si el sistema no lo permitió (se sigue sin fijar)
+ */
+int affinity_apply(MPI_Comm comm, Placement* placement);
+
+/**
+ * Toca (escribe) una vez cada página de data[from, to) para que el kernel la ubique en el
+ * nodo del core que ejecuta al proceso en vez de hacerlo más tarde desde otro lado.
+ * Solo para memoria recién reservada: el contenido del rango se pierde.
+ */
+void affinity_first_touch(void* data, size_t from, size_t to);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include <mpi.h>
+#include "common.h"
+
+/* Contexto de análisis reutilizable entre archivos (opaco) */
+typedef struct Analyzer Analyzer;
+
+/* Resumen de una corrida de analyzer_run (válido solo en rank 0 del comunicador) */
+typedef struct {
+    char results_dir[MAX_PATH];  /* directorio con los CSV y la cache del track */
+    float bpm;                   /* BPM estimado */
+    int n_frames;                /* ventanas del espectrograma */
+    int n_bins;                  /* bins calculados (banda completa o limitada) */
+    int sample_rate;             /* sample rate del archivo */
+    int cache_state;             /* cache_status_t de la búsqueda en cache */
+    double t_read;               /* lectura y decodificación del WAV */
+    double t_stft;               /* difusión de muestras + STFT + recolección */
+    double t_write_spec;         /* escritura del CSV del espectrograma */
+    double t_total;              /* corrida completa */
+} AnalyzerReport;
+
+/**
+ * Crea un contexto de análisis para una configuración. El contexto conserva el plan de
+ * FFT, la ventana precalculada y una arena con los buffers de trabajo (alineados a 64
+ * bytes; con cfg->huge_pages, en páginas enormes), así que analizar varios archivos
+ * seguidos no vuelve a planificar ni a pedir memoria salvo que un archivo sea más largo
+ * o cambie el sample rate. Es colectiva sobre comm (se duplica).
+ *
+ * @param cfg Configuración base (cfg->fs se reemplaza por el del archivo en cada corrida)
+ * @param comm Comunicador de los procesos que colaboran
+ * @return Contexto o NULL si no hay memoria
+ */
+Analyzer* analyzer_create(const Config* cfg, MPI_Comm comm);
+
+/**
+ * Analiza un archivo: STFT distribuido, CSV del espectrograma, BPM, cache y tempograma
+ * (si está activado). Es colectiva; todos los procesos devuelven el mismo resultado.
+ *
+ * @param analyzer Contexto creado con analyzer_create
+ * @param path Ruta del WAV (solo se lee en rank 0 de comm)
+ * @param report Resumen de la corrida (solo se completa en rank 0; puede ser NULL)
+ * @return 0 si se analizó, -1 si hubo un error (archivo ilegible, muy corto, etc.)
+ */
+int analyzer_run(Analyzer* analyzer, const char* path, AnalyzerReport* report);
+
+/**
+ * Cambia la configuración de las próximas corridas (ej. otro rango de BPM o banda).
+ * Los buffers se conservan; el plan de FFT se rehace solo si cambian N, hop, ventana o banda.
+ * Todos los procesos deben pasar la misma configuración.
+ */
+void analyzer_set_config(Analyzer* analyzer, const Config* cfg);
+
+/* Máximo de memoria de trabajo que usó este proceso en una corrida (bytes): lo entregado
+   por la arena más los frames propios de la distribución dinámica */
+size_t analyzer_peak_memory(const Analyzer* analyzer);
+
+/* Bytes de la arena de este proceso respaldados por páginas enormes */
+size_t analyzer_huge_page_memory(const Analyzer* analyzer);
+
+/* Libera el contexto (colectiva sobre el comunicador del contexto) */
+void analyzer_destroy(Analyzer* analyzer);
+
+#endif
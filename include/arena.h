@@ -0,0 +1,57 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Alineación de todos los bloques (una línea de cache; alcanza para AVX-512) */
+#define ARENA_ALIGN 64
+
+/* Opciones de arena_create */
+#define ARENA_HUGE_PAGES 1   /* respaldar los bloques grandes con páginas enormes */
+
+/* Tamaño de página enorme que se asume para redondear (x86-64) */
+#define ARENA_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+/* Arena de memoria por proceso (opaca) */
+typedef struct Arena Arena;
+
+/**
+ * Crea una arena. La memoria se pide al sistema con mmap en trozos grandes y se entrega
+ * de forma secuencial en bloques alineados a ARENA_ALIGN; no se libera bloque por bloque
+ * sino toda junta con arena_reset o arena_destroy. Las páginas solo ocupan memoria física
+ * cuando se escriben, así que reservar de más no cuesta.
+ *
+ * Con ARENA_HUGE_PAGES los trozos de al menos ARENA_HUGE_PAGE_SIZE se piden con
+ * MAP_HUGETLB y, si el sistema no tiene páginas reservadas, con madvise(MADV_HUGEPAGE).
+ *
+ * @param initial_bytes Tamaño del primer trozo (0 = se reserva con el primer bloque)
+ * @param flags 0 o ARENA_HUGE_PAGES
+ * @return Arena o NULL si no hay memoria
+ */
+Arena* arena_create(size_t initial_bytes, int flags);
+
+/**
+ * Entrega un bloque de 'bytes' alineado a ARENA_ALIGN (sin inicializar).
+ * @return Puntero o NULL si no hay memoria
+ */
+void* arena_alloc(Arena* arena, size_t bytes);
+
+/**
+ * Libera de una vez todos los bloques entregados. La memoria queda reservada para reusarla;
+ * si la arena tuvo que crecer en varios trozos, se unifican en uno solo del tamaño total.
+ */
+void arena_reset(Arena* arena);
+
+/* Devuelve toda la memoria al sistema */
+void arena_destroy(Arena* arena);
+
+/* Bytes entregados desde el último reset */
+size_t arena_used(const Arena* arena);
+
+/* Máximo de bytes entregados entre dos resets (desde que se creó) */
+size_t arena_peak(const Arena* arena);
+
+/* Bytes respaldados por páginas enormes (MAP_HUGETLB o MADV_HUGEPAGE aceptado) */
+size_t arena_huge_bytes(const Arena* arena);
+
+#endif
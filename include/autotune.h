@@ -0,0 +1,47 @@
+/* include/autotune.h */
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stddef.h>
+#include <mpi.h>
+#include "common.h"
+
+/* Lo que elige el autotuner (se aplica sobre la configuración) */
+typedef struct {
+    fft_kernel_t fft_kernel;  /* variante de la FFT completa */
+    sched_t schedule;         /* distribución de frames */
+    int block_frames;         /* frames por bloque (SCHED_BLOCK) */
+    int chunk_min;            /* bloque mínimo (SCHED_DYNAMIC) */
+} TuneChoice;
+
+/**
+ * @brief Modelo de CPU de este nodo (/proc/cpuinfo), la clave del archivo wisdom junto con
+ * N, hop y la cantidad de procesos. Si no se puede leer queda "desconocido".
+ */
+void autotune_cpu_model(char* model, size_t size);
+
+/**
+ * @brief Mide en esta máquina los kernels de FFT y las distribuciones de frames para el N y
+ * hop de cfg y devuelve la combinación más rápida. Cada candidato se corre sobre una señal
+ * sintética con todos los procesos a la vez y cuenta el tiempo del más lento (el que
+ * define la corrida real), mejor de varias repeticiones. Es colectiva.
+ *
+ * @param cfg Configuración (N, hop y ventana)
+ * @param comm Comunicador de los procesos que van a analizar
+ * @param choice Salida: la combinación elegida (igual en todos los procesos)
+ */
+void autotune_measure(const Config* cfg, MPI_Comm comm, TuneChoice* choice);
+
+/**
+ * @brief Aplica el autotuner a cfg: si el archivo wisdom (cfg->wisdom_path) ya tiene una
+ * entrada para este modelo de CPU, N, hop y cantidad de procesos se usa directamente; si
+ * no, se mide (autotune_measure) y rank 0 agrega la entrada al archivo. Es colectiva.
+ *
+ * @param cfg Configuración a ajustar (kernel de FFT, distribución, bloque y chunk mínimo)
+ * @param comm Comunicador de los procesos que van a analizar
+ * @return 1 si se usó el archivo wisdom, 0 si se midió
+ */
+int autotune_apply(Config* cfg, MPI_Comm comm);
+
+#endif /* AUTOTUNE_H */
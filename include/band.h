@@ -0,0 +1,50 @@
+#ifndef BAND_H
+#define BAND_H
+
+/* Cómo se calculan los bins de una banda [bin_lo, bin_hi] */
+typedef enum {
+    BAND_FULL_FFT = 0,   /* FFT completa y recorte (banda ancha) */
+    BAND_GOERTZEL = 1,   /* un filtro de Goertzel por bin (banda muy angosta) */
+    BAND_PRUNED_FFT = 2  /* FFT podada en la salida: N = L*D, D FFTs de tamaño L */
+} band_method_t;
+
+/* Plan de transformada para una banda (opaco) */
+typedef struct BandPlan BandPlan;
+
+/**
+ * Convierte un rango en Hz a bins de una FFT de N puntos (limitado a [0, N/2]).
+ * f_hi <= 0 significa "hasta Nyquist".
+ * @return 0 si la banda tiene bins, -1 si f_lo queda arriba de Nyquist
+ */
+int band_bins_from_hz(int N, int fs, float f_lo, float f_hi, int* bin_lo, int* bin_hi);
+
+/* Método más barato (estimando flops por frame) para los bins [bin_lo, bin_hi] */
+band_method_t band_choose_method(int N, int bin_lo, int bin_hi);
+
+/**
+ * Prepara el cálculo de los bins [bin_lo, bin_hi] de una DFT de N puntos de un frame real.
+ * Elige el método más barato (estimando flops) entre FFT completa, Goertzel y FFT podada.
+ *
+ * @return Plan listo para band_magnitudes, o NULL si no hay memoria
+ */
+BandPlan* band_plan_create(int N, int bin_lo, int bin_hi);
+
+/**
+ * Calcula las magnitudes de la banda para un frame ya ventaneado.
+ *
+ * @param plan Plan de la banda
+ * @param frame N muestras reales ventaneadas
+ * @param out Destino de (bin_hi - bin_lo + 1) magnitudes
+ */
+void band_magnitudes(BandPlan* plan, const float* frame, float* out);
+
+/* Método elegido por band_plan_create */
+band_method_t band_plan_method(const BandPlan* plan);
+
+/* Nombre legible del método (para los logs) */
+const char* band_method_name(band_method_t method);
+
+/* Libera el plan */
+void band_plan_destroy(BandPlan* plan);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <mpi.h>
+#include "common.h"
+
+/* Frames mínimos por proceso para que valga la pena sumar un proceso a un archivo */
+#define BATCH_MIN_FRAMES_PER_RANK 256
+
+/**
+ * Modo lote: analiza todos los archivos de cfg->batch_list (sin límite de cantidad) sin
+ * interacción. Los procesos se dividen en grupos (MPI_Comm_split) cuyo tamaño depende
+ * del largo de los archivos: uno largo recibe varios procesos (frames repartidos dentro
+ * del grupo) y los cortos uno solo, así varios archivos se analizan a la vez. Los
+ * archivos se reparten de mayor a menor: cada grupo arranca con el archivo para el que
+ * fue dimensionado y después pide el siguiente a un contador compartido en rank 0.
+ * Al terminar, rank 0 escribe results/batch_summary.csv (con cfg->store_dir, en el
+ * directorio del almacén). Es colectiva sobre comm.
+ *
+ * @param cfg Configuración de todos los análisis
+ * @param comm Comunicador con todos los procesos
+ * @return 0 si se analizaron todos, -1 si la lista no se pudo leer o algún archivo falló
+ */
+int batch_run(const Config* cfg, MPI_Comm comm);
+
+#endif
@@ -17,16 +17,60 @@ typedef struct {
  * * @param spectrogram La matriz 2D del espectrograma (magnitud). [num_frames][num_bins]
  * @param num_frames Número de frames (columnas) en el espectrograma.
  * @param num_bins Número de bins (filas) en el espectrograma.
+ * @param cfg Configuración de la corrida (sample rate, hop y rango de BPM).
  * @return AnalysisResults* Un puntero a una estructura con todos los resultados. 
  * ¡El llamador es responsable de liberar esta memoria con free_analysis_results()!
  */
-AnalysisResults* analyze_features_and_bpm(float* spectrogram, int num_frames, int num_bins, int sample_rate);
+AnalysisResults* analyze_features_and_bpm(float* spectrogram, int num_frames, int num_bins, const Config* cfg);
+
+/**
+ * @brief Igual que analyze_features_and_bpm pero sin alojar memoria: el flux y la
+ * autocorrelación se escriben en buffers del llamador (reutilizables entre archivos).
+ * @param flux_out Curva de flux de salida (num_frames floats).
+ * @param acf_scratch Buffer intermedio para la autocorrelación (num_frames floats).
+ * @return float El BPM estimado.
+ */
+float analyze_bpm_into(float* spectrogram, int num_frames, int num_bins, const Config* cfg,
+                       float* flux_out, float* acf_scratch);
+
+/**
+ * @brief Curva de spectral flux (suma de los aumentos de magnitud de cada bin respecto del
+ * frame anterior). Es la que usa el BPM; sirve también para el flux de cada canal.
+ * @param flux_curve Salida (num_frames floats, el primero es 0)
+ */
+void calculate_spectral_flux(float* spectrogram, int num_frames, int num_bins, float* flux_curve);
+
+/**
+ * @brief Rango de lags (en frames de la curva de flux) que corresponde al rango de BPM.
+ * * @param cfg Configuración de la corrida (sample rate, hop y rango de BPM).
+ * @param lag_min Salida: lag del BPM máximo (>= 1).
+ * @param lag_max Salida: lag del BPM mínimo.
+ */
+void bpm_lag_range(const Config* cfg, int* lag_min, int* lag_max);
+
+/**
+ * @brief Convierte un lag (frames de flux) a BPM.
+ */
+float bpm_from_lag(const Config* cfg, int lag);
+
+/**
+ * @brief Confianza del BPM: autocorrelación normalizada de la curva de flux centrada en el
+ * lag del BPM (la misma medida que el tempograma, pero sobre todo el track).
+ * @return Valor en [0, 1] (0 si no hubo BPM o el track es más corto que un período)
+ */
+float bpm_confidence(const float* flux, int num_frames, float bpm, const Config* cfg);
+
+/**
+ * @brief Libera la estructura de resultados y la curva de flux que contiene.
+ */
+void free_analysis_results(AnalysisResults* results);
 
 /**
  * @brief Escribe los resultados del análisis a un archivo CSV.
  * * @param filename Nombre del archivo de salida (ej. "results/audio_analysis.csv")
  * @param results La estructura que contiene los datos del análisis.
+ * @param cfg Configuración de la corrida (sample rate y hop para el eje de tiempo).
  */
-void write_results_to_csv(const char* filename, const AnalysisResults* results, int sample_rate);
+void write_results_to_csv(const char* filename, const AnalysisResults* results, const Config* cfg);
 
 #endif /* BPM_H */
\ No newline at end of file
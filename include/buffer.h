@@ -0,0 +1,25 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stddef.h>
+
+/* Buffer que solo crece: se reutiliza entre archivos sin volver a pedir memoria */
+typedef struct {
+    void* data;
+    size_t capacity;   /* bytes reservados */
+} GrowBuffer;
+
+#define GROW_BUFFER_INIT { NULL, 0 }
+
+/**
+ * Garantiza al menos 'bytes' de capacidad. Si hay que crecer, conserva el contenido
+ * (realloc) y reserva un 50% extra para no crecer de a poco.
+ *
+ * @return Puntero a los datos, o NULL si no hay memoria (el buffer anterior sigue válido)
+ */
+void* grow_buffer_reserve(GrowBuffer* buffer, size_t bytes);
+
+/* Libera el buffer y lo deja vacío */
+void grow_buffer_free(GrowBuffer* buffer);
+
+#endif
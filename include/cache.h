@@ -0,0 +1,78 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include "common.h"
+#include "bpm.h"
+
+/* Resultado de buscar un track en la cache */
+typedef enum {
+    CACHE_MISS = 0,             /* no hay nada reutilizable: se calcula todo */
+    CACHE_HIT_SPECTROGRAM = 1,  /* el espectrograma sirve, pero el BPM se recalcula (ej. otro rango) */
+    CACHE_HIT_FULL = 2          /* espectrograma, flux y BPM guardados coinciden con la corrida */
+} cache_status_t;
+
+/* Clave de la cache: huella del audio + parámetros del STFT y del BPM */
+typedef struct {
+    uint64_t data_hash;  /* hash del chunk data del WAV */
+    int n_samples;       /* muestras mono */
+    int fs;              /* sample rate */
+    int N;               /* tamaño de ventana */
+    int hop;             /* avance */
+    int wtype;           /* tipo de ventana */
+    int bin_lo;          /* banda calculada */
+    int bin_hi;
+    int bpm_min;         /* rango BPM (solo afecta al análisis) */
+    int bpm_max;
+} CacheKey;
+
+/**
+ * Arma la clave de cache de un track con la configuración de la corrida.
+ *
+ * @param key Clave a completar
+ * @param data_hash Hash del chunk data (WAVFile.data_hash)
+ * @param n_samples Cantidad de muestras mono
+ * @param cfg Configuración de la corrida (cfg->fs ya debe ser el del archivo)
+ */
+void cache_make_key(CacheKey *key, uint64_t data_hash, int n_samples, const Config *cfg);
+
+/**
+ * Busca en el directorio de resultados del track qué partes se pueden reutilizar.
+ *
+ * @param dir Directorio de resultados del track (ej. "results/cancion")
+ * @param key Clave de la corrida actual
+ * @return CACHE_MISS, CACHE_HIT_SPECTROGRAM o CACHE_HIT_FULL
+ */
+cache_status_t cache_lookup(const char *dir, const CacheKey *key);
+
+/**
+ * Guarda el espectrograma completo (ordenado) en la cache del track.
+ * La escritura es atómica: se escribe un temporal y se renombra.
+ *
+ * @return 0 si se guardó, -1 si hubo un error
+ */
+int cache_store_spectrogram(const char *dir, const CacheKey *key, const float *mag,
+                            int n_frames, int n_bins);
+
+/**
+ * Carga el espectrograma guardado si coincide con la clave y las dimensiones pedidas.
+ *
+ * @return Array n_frames * n_bins (el llamador lo libera con free) o NULL si no sirve
+ */
+float *cache_load_spectrogram(const char *dir, const CacheKey *key, int n_frames, int n_bins);
+
+/**
+ * Guarda BPM y curva de flux en la cache del track (escritura atómica).
+ *
+ * @return 0 si se guardó, -1 si hubo un error
+ */
+int cache_store_analysis(const char *dir, const CacheKey *key, const AnalysisResults *results);
+
+/**
+ * Carga BPM y curva de flux guardados si coinciden con la clave completa.
+ *
+ * @return Resultados (liberar con free_analysis_results) o NULL si no sirven
+ */
+AnalysisResults *cache_load_analysis(const char *dir, const CacheKey *key);
+
+#endif
@@ -3,10 +3,19 @@
 
 /* Parámetros por defecto del proyecto */
 #define DEFAULT_FS    44100   /* Hz */
-#define DEFAULT_N     2048    /* tamaño de ventana (2^k) */
+#define DEFAULT_N     2048    /* tamaño de ventana (cualquier N, ver fft_plan_create) */
 #define DEFAULT_HOP   512     /* avance entre ventanas */
 #define DEFAULT_BPM_MIN 60
 #define DEFAULT_BPM_MAX 200
+#define DEFAULT_TEMPO_WINDOW 8.0f  /* segundos por ventana del tempograma */
+#define DEFAULT_TEMPO_HOP 1.0f     /* segundos entre ventanas del tempograma */
+#define DEFAULT_CHUNK_MIN 4   /* frames por bloque mínimo (distribución dinámica) */
+#define MAX_PYRAMID_LEVELS 8  /* niveles reducidos de la pirámide (hasta 256x) */
+#define DEFAULT_CQT_BINS 12   /* bins por octava de la CQT (semitonos) */
+#define DEFAULT_CQT_FMIN 32.70f /* Hz: primer bin de la CQT (C1) */
+#define CQT_MAX_BINS 96       /* bins por octava máximos de la CQT */
+#define DEFAULT_BLOCK_FRAMES 32 /* frames por bloque en la distribución por bloques */
+#define DEFAULT_WISDOM_PATH "paa.wisdom" /* elecciones del autotuner por CPU y parámetros */
 #define MAX_FILES 100
 #define MAX_PATH 512
 
@@ -17,6 +26,34 @@ typedef enum {
     WIN_BLACKMAN = 2
 } win_t;
 
+/* Distribución de frames entre procesos */
+typedef enum {
+    SCHED_CYCLIC = 0,   /* estática: proceso p calcula p, p+P, p+2P, ... */
+    SCHED_DYNAMIC = 1,  /* dinámica: bloques guiados reclamados de un contador RMA */
+    SCHED_BLOCK = 2     /* estática por bloques: proceso p calcula los bloques p, p+P, ... */
+} sched_t;
+
+/* Variante de la FFT completa (el autotuner elige la más rápida para cada máquina) */
+typedef enum {
+    FFT_KERNEL_RADIX4 = 0,  /* Stockham con etapas radix-4 primero (default) */
+    FFT_KERNEL_RADIX2 = 1,  /* Stockham solo con etapas radix-2 para las potencias de 2 */
+    FFT_KERNEL_INPLACE = 2  /* radix-2 in-place con bit-reversal (solo potencias de 2) */
+} fft_kernel_t;
+
+/* Recolección hacia rank 0 (ver node_topology_attach en mpi_utils.h) */
+typedef enum {
+    GATHER_AUTO = 0,    /* dos niveles si hay más de un nodo y algún nodo con varios procesos */
+    GATHER_FLAT = 1,    /* todos los procesos le mandan directo a rank 0 */
+    GATHER_NODE = 2     /* siempre dos niveles: dentro de cada nodo y después entre líderes */
+} gather_t;
+
+/* Canales que se analizan por separado (además del espectrograma mono) */
+typedef enum {
+    STEREO_OFF = 0,     /* solo la mezcla mono */
+    STEREO_LR = 1,      /* izquierdo y derecho */
+    STEREO_MS = 2       /* medio (L + R) / 2 y lateral (L - R) / 2 */
+} stereo_t;
+
 /* Configuración de corrida (compartida entre módulos) */
 typedef struct Config{
     int fs;         /* sample rate */
@@ -25,6 +62,39 @@ typedef struct Config{
     win_t wtype;    /* tipo de ventana */
     int bpm_min;    /* rango BPM */
     int bpm_max;
+    int use_cache;  /* 1 = reutilizar resultados guardados si el audio no cambió */
+    sched_t schedule; /* distribución de frames */
+    int chunk_min;  /* tamaño mínimo de bloque en la distribución dinámica */
+    float band_lo_hz; /* banda de frecuencias a calcular (0/0 = espectro completo) */
+    float band_hi_hz;
+    int bin_lo;     /* bins de la banda (se resuelven con config_resolve_band) */
+    int bin_hi;
+    int tempogram;  /* 1 = calcular BPM por ventana además del global */
+    float tempo_window_s; /* largo de cada ventana del tempograma (segundos) */
+    float tempo_hop_s;    /* avance entre ventanas del tempograma (segundos) */
+    int pyramid_levels;   /* niveles reducidos 2x, 4x, ... para visualizar (0 = sin pirámide) */
+    int resynth;    /* 1 = volver al tiempo con ISTFT distribuida y escribir resynth.wav */
+    int modulation; /* 1 = espectro de modulación por bin (espectrograma transpuesto) */
+    int cqt;        /* 1 = transformada Q constante además del STFT */
+    int cqt_bins;   /* bins por octava de la CQT */
+    float cqt_f_min; /* frecuencia del primer bin de la CQT (Hz) */
+    stereo_t stereo; /* espectrogramas y flux por canal (dos canales en una FFT compleja) */
+    fft_kernel_t fft_kernel; /* variante de la FFT completa del STFT */
+    int block_frames; /* frames por bloque con --schedule block */
+    int tune;       /* 1 = elegir kernel y distribución con el autotuner (o el archivo wisdom) */
+    char wisdom_path[MAX_PATH]; /* archivo donde el autotuner guarda lo que midió */
+    int affinity;   /* 1 = fijar cada proceso a un core ordenado por nodo NUMA */
+    int huge_pages; /* 1 = buffers de trabajo en páginas enormes (si el sistema las da) */
+    int profile;    /* 1 = contadores de hardware (perf_event_open) por etapa y proceso */
+    gather_t gather; /* recolección plana o en dos niveles (por nodo) */
+    int node_size;  /* procesos consecutivos por nodo (0 = detectar por memoria compartida) */
+    char gain_mask[MAX_PATH];  /* máscara de ganancia por frecuencia ("" = sin máscara) */
+    char serve_path[MAX_PATH]; /* socket del modo servicio ("" = modo interactivo) */
+    char batch_list[MAX_PATH]; /* lista del modo lote ("" = modo interactivo) */
+    char store_dir[MAX_PATH];  /* almacén de resultados consolidado ("" = CSV por track) */
+    float query_bpm_lo;        /* consulta del almacén por rango de BPM (hi = 0: sin consulta) */
+    float query_bpm_hi;
+    char lookup_path[MAX_PATH]; /* consulta del almacén por ruta ("" = sin consulta) */
 } Config;
 
 /* Helpers chiquitos que no dependen de libs externas */
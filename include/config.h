@@ -0,0 +1,36 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "common.h"
+
+/**
+ * Carga los valores por defecto del proyecto en la configuración.
+ *
+ * @param cfg Configuración a inicializar
+ */
+void config_init_defaults(Config *cfg);
+
+/**
+ * Interpreta las opciones de línea de comandos y las vuelca en la configuración.
+ * Todos los procesos reciben el mismo argv, así que cada uno la parsea por su cuenta.
+ *
+ * @param cfg Configuración (ya inicializada con config_init_defaults)
+ * @param argc Cantidad de argumentos
+ * @param argv Argumentos
+ * @return 0 si todo salió bien, -1 si hay una opción inválida
+ */
+int config_parse_args(Config *cfg, int argc, char *argv[]);
+
+/**
+ * Traduce la banda en Hz a bins con el N y fs de la corrida (cfg->fs ya debe ser el del archivo).
+ * Sin banda configurada deja el espectro completo [0, N/2].
+ *
+ * @return 1 si hay una banda activa (se calcula solo un rango de bins), 0 si no,
+ *         -1 si la banda queda vacía con este sample rate (f_lo arriba de Nyquist)
+ */
+int config_resolve_band(Config *cfg);
+
+/* Imprime las opciones disponibles */
+void config_print_usage(const char *prog);
+
+#endif
@@ -0,0 +1,70 @@
+/* include/cqt.h */
+
+#ifndef CQT_H
+#define CQT_H
+
+#include "common.h"
+
+/* Kernels espectrales ralos de una octava + buffers de un frame (opaco) */
+typedef struct CqtKernel CqtKernel;
+
+/**
+ * @brief Octavas que entran entre f_min y la frecuencia más alta que se puede calcular sin
+ * aliasing después de cada decimación (0.4 * fs).
+ * @return Cantidad de octavas (0 si f_min es demasiado alta para fs)
+ */
+int cqt_octaves(int fs, float f_min);
+
+/**
+ * @brief Precalcula los kernels de la transformada Q constante (Brown y Puckette): para cada
+ * bin de la octava más alta, la FFT de una sinusoide compleja con ventana Hann de largo
+ * Q * fs / f, sin los coeficientes despreciables. Las octavas de abajo reutilizan los
+ * mismos kernels sobre la señal decimada por 2, 4, ... así que la FFT de cada frame es
+ * chica (la potencia de 2 que contiene el kernel más largo de la octava).
+ *
+ * @param fs Sample rate del audio
+ * @param bins_per_octave Bins por octava (12 = semitonos)
+ * @param f_min Frecuencia del primer bin (Hz)
+ * @return Kernel o NULL si no hay memoria o no entra ninguna octava
+ */
+CqtKernel* cqt_kernel_create(int fs, int bins_per_octave, float f_min);
+
+/* Devuelve 1 si el kernel se creó para los mismos fs, bins por octava y f_min */
+int cqt_kernel_matches(const CqtKernel* kernel, int fs, int bins_per_octave, float f_min);
+
+/* Bins totales (octavas * bins por octava) */
+int cqt_n_bins(const CqtKernel* kernel);
+
+/* Frecuencia central del bin k (Hz) */
+float cqt_bin_frequency(const CqtKernel* kernel, int k);
+
+/* Libera el kernel */
+void cqt_kernel_destroy(CqtKernel* kernel);
+
+/**
+ * @brief Calcula la CQT de los frames de este proceso en la misma distribución cíclica que
+ * el STFT (frame p, p + P, ...). Cada frame se centra donde está centrado el frame del
+ * STFT (m * hop + N / 2), así que las dos salidas quedan alineadas en el tiempo.
+ * Cada proceso decima la señal una vez por octava (filtro de media banda) y por frame hace
+ * una FFT chica por octava y el producto con los kernels ralos.
+ *
+ * @param kernel Kernel creado para el sample rate del audio
+ * @param samples Señal completa
+ * @param n_samples Largo de la señal
+ * @param rank ID del proceso
+ * @param procs_number Cantidad de procesos
+ * @param n_frames Frames totales (los del STFT)
+ * @param cfg Configuración (N y hop del STFT)
+ * @param cq_local Salida: magnitudes de los frames propios (frame por frame, cqt_n_bins cada uno)
+ * @return 0 si todo salió bien, -1 si no hay memoria
+ */
+int cqt_compute_cyclic(CqtKernel* kernel, const float* samples, int n_samples, int rank,
+                       int procs_number, int n_frames, const Config* cfg, float* cq_local);
+
+/**
+ * @brief Escribe la CQT a CSV: encabezado con la frecuencia de cada bin y una fila por frame.
+ * @return 0 si se escribió, -1 si no
+ */
+int write_cqt_csv(const char* filename, const float* cq, int n_frames, const CqtKernel* kernel);
+
+#endif /* CQT_H */
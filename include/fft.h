@@ -1,10 +1,50 @@
 #ifndef FFT_H
 #define FFT_H
 
+#include "common.h"
+
+/* Plan de FFT para un tamaño n arbitrario (opaco: se crea con fft_plan_create) */
+typedef struct FFTPlan FFTPlan;
+
+/**
+ * Prepara una FFT de tamaño n: factoriza n en radices 4/2/3/5 (y primos chicos hasta 13)
+ * y precalcula los twiddles de cada etapa. Si n tiene un factor primo mayor, usa el
+ * algoritmo de Bluestein sobre una FFT potencia de 2.
+ *
+ * @param n Tamaño de la transformada (n >= 1, no hace falta que sea potencia de 2)
+ * @return Plan listo para fft_execute, o NULL si no hay memoria
+ */
+FFTPlan* fft_plan_create(int n);
+
+/**
+ * Igual que fft_plan_create pero con una variante de kernel (ver fft_kernel_t). Las
+ * variantes radix-2 solo cambian algo si n es potencia de 2; si no, se usa el plan normal.
+ */
+FFTPlan* fft_plan_create_kernel(int n, fft_kernel_t kernel);
+
+/**
+ * Ejecuta la FFT directa in-place con un plan. Usa buffers internos del plan,
+ * así que un mismo plan no debe ejecutarse desde dos hilos a la vez.
+ *
+ * @param plan Plan creado para el tamaño de re/im
+ * @param re Parte real (entrada/salida)
+ * @param im Parte imaginaria (entrada/salida)
+ */
+void fft_execute(FFTPlan* plan, float* re, float* im);
+
+/* FFT inversa con el mismo plan (normaliza dividiendo por n) */
+void fft_execute_inverse(FFTPlan* plan, float* re, float* im);
+
+/* Tamaño para el que se creó el plan */
+int fft_plan_size(const FFTPlan* plan);
+
+/* Libera el plan */
+void fft_plan_destroy(FFTPlan* plan);
+
 /* Al terminar: re/im contienen el ESPECTRO (dominio frecuencia).*/
 void fft_inplace(float *re, /* parte real del número complejo */
                 float *im, /* parte imaginaria del número complejo */
-                 int n); /* restricción de fft, el número de muestras debe ser potencia de 2 */              
+                 int n); /* potencias de 2 usan Radix-2 in-place; otro tamaño crea un plan temporal */
 
 /* Declaración de la fft inversa: toma la frecuencia y la trasforma a tiempo */
 void ifft_inplace(float *re, float *im, int n); /* normaliza dividiendo por n */
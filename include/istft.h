@@ -0,0 +1,56 @@
+/* include/istft.h */
+
+#ifndef ISTFT_H
+#define ISTFT_H
+
+#include <mpi.h>
+#include "common.h"
+
+/**
+ * @brief Frames por proceso para la resíntesis: bloques contiguos (proceso p calcula
+ * [p * bloque, (p + 1) * bloque)). El bloque es al menos ceil((N - hop) / hop) frames
+ * para que el solapamiento que un proceso le pasa al siguiente caiga entero dentro de la
+ * región de ese proceso, y es múltiplo de align (ej. para la pirámide).
+ *
+ * @return Frames por bloque (el último proceso con frames puede tener menos)
+ */
+int istft_block_frames(int n_frames, int procs_number, int N, int hop, int align);
+
+/**
+ * @brief Lee una máscara de ganancia por frecuencia (EQ) y la lleva a los bins de una FFT.
+ * El archivo tiene una línea "frecuencia_hz,ganancia_db" por punto, en orden creciente
+ * de frecuencia; entre puntos se interpola en dB y fuera del rango se extiende el extremo.
+ * Se ignoran las líneas que no empiezan con un número (encabezado, comentarios).
+ *
+ * @param path Archivo CSV
+ * @param N Tamaño de la FFT
+ * @param fs Sample rate del audio
+ * @param gain Salida: ganancia lineal de cada bin (N/2 + 1)
+ * @return 0 si se leyó, -1 si no (el error ya se informó)
+ */
+int load_gain_mask(const char* path, int N, int fs, float* gain);
+
+/**
+ * @brief STFT inversa distribuida con overlap-add. Cada proceso aplica la máscara a sus
+ * frames complejos, los vuelve al tiempo (FFT inversa), les aplica la ventana de síntesis
+ * y los suma en su región de salida. Los últimos N - hop samples de cada región se solapan
+ * con el comienzo de la región del proceso siguiente: se intercambian una sola vez
+ * (MPI_Sendrecv entre vecinos) y cada proceso normaliza lo suyo por la suma de ventanas al
+ * cuadrado. Rank 0 recolecta las regiones en orden. Es colectiva.
+ *
+ * @param spec_re Partes reales de los frames de este proceso (count * (N/2 + 1))
+ * @param spec_im Partes imaginarias (count * (N/2 + 1))
+ * @param first Primer frame de este proceso (bloques de istft_block_frames)
+ * @param count Frames de este proceso (0 si no tiene)
+ * @param n_frames Frames totales
+ * @param n_samples Largo de la señal de salida
+ * @param gain Ganancia por bin (N/2 + 1) o NULL para resintetizar sin cambios
+ * @param cfg Configuración (N, hop y ventana del análisis)
+ * @param comm Comunicador de los procesos que calcularon los frames
+ * @param out Señal resintetizada (n_samples, solo rank 0 de comm)
+ */
+void istft_overlap_add(const float* spec_re, const float* spec_im, int first, int count,
+                       int n_frames, int n_samples, const float* gain, const Config* cfg,
+                       MPI_Comm comm, float* out);
+
+#endif /* ISTFT_H */
@@ -0,0 +1,51 @@
+/* include/modulation.h */
+
+#ifndef MODULATION_H
+#define MODULATION_H
+
+#include <mpi.h>
+#include "common.h"
+
+/* Frames por segmento del espectro de modulación (~3 s con hop 512 a 44.1 kHz) */
+#define MODULATION_SEGMENT 256
+
+/* Frames mínimos: con menos la ventana Hann del segmento queda en cero (o indefinida con 1) */
+#define MODULATION_MIN_FRAMES 4
+
+/* Espectro de modulación: cómo varía en el tiempo la energía de cada bin */
+typedef struct {
+    int n_bins;           /* bins del espectrograma (filas) */
+    int n_mod;            /* frecuencias de modulación (columnas) */
+    float mod_step_hz;    /* separación entre frecuencias de modulación */
+    float* values;        /* n_bins * n_mod: magnitud promedio de cada bin y modulación */
+} ModulationSpectrum;
+
+/**
+ * @brief Calcula el espectro de modulación a partir del espectrograma distribuido por bins
+ * (ver transpose_frames_to_bins). Cada proceso toma la serie temporal de cada uno de sus
+ * bins, le resta la media y promedia la magnitud de la FFT de segmentos de
+ * MODULATION_SEGMENT frames con ventana Hann y 50% de solapamiento. Rank 0 recolecta las
+ * filas en orden de bin. Es colectiva.
+ *
+ * @param series Bins propios * n_frames (serie de cada bin contigua)
+ * @param local_bins Bins de este proceso
+ * @param n_bins Bins totales
+ * @param n_frames Largo de cada serie (al menos MODULATION_MIN_FRAMES)
+ * @param cfg Configuración (fs y hop: la serie está muestreada a fs / hop)
+ * @param comm Comunicador del reparto por bins
+ * @return Espectro completo en rank 0 (liberar con free_modulation_spectrum), NULL en los demás
+ */
+ModulationSpectrum* compute_modulation_parallel(const float* series, int local_bins, int n_bins,
+                                                int n_frames, const Config* cfg, MPI_Comm comm);
+
+/**
+ * @brief Escribe el espectro de modulación a CSV: una fila por bin (frecuencia en Hz y una
+ * columna por frecuencia de modulación).
+ * @return 0 si se escribió, -1 si no
+ */
+int write_modulation_csv(const char* filename, const ModulationSpectrum* spectrum, const Config* cfg);
+
+/* Libera el espectro de modulación */
+void free_modulation_spectrum(ModulationSpectrum* spectrum);
+
+#endif /* MODULATION_H */
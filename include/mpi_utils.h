@@ -1,6 +1,29 @@
 #ifndef MPI_UTILS_H
 #define MPI_UTILS_H
 
+#include <mpi.h>
+#include "stft.h"
+
+/* Contador compartido (vive en rank 0) para repartir trabajo de forma dinámica */
+typedef struct {
+    MPI_Win win;    /* ventana RMA con un único int */
+    int* base;      /* memoria de la ventana (solo significativa en rank 0) */
+} WorkCounter;
+
+/**
+ * Prepara la recolección en dos niveles sobre comm (colectiva): los procesos se agrupan
+ * por nodo (MPI_Comm_split_type con MPI_COMM_TYPE_SHARED, o de a node_size ranks
+ * consecutivos si node_size > 0) y el rank 0 de cada nodo queda como líder. Desde
+ * entonces las recolecciones de este archivo sobre comm juntan primero dentro de cada nodo
+ * y rank 0 recibe un solo bloque ya ordenado por nodo, en lugar de un mensaje por proceso.
+ * La topología queda guardada como atributo de comm y se libera junto con él.
+ *
+ * @param mode GATHER_AUTO usa dos niveles solo si hay más de un nodo y alguno tiene varios
+ *             procesos; GATHER_FLAT no hace nada
+ * @return Cantidad de nodos si quedó en dos niveles, 0 si la recolección sigue plana
+ */
+int node_topology_attach(MPI_Comm comm, gather_t mode, int node_size);
+
 /**
  * Recolecta y reordena los datos del espectrograma desde todos los procesos.
  * Los datos se distribuyen cíclicamente entre procesos y se reordenan secuencialmente.
@@ -16,4 +39,96 @@
 float* gather_and_reorder_spectrogram(float* mag_local, int local_frames, int n_frames, 
                                        int n_bins, int rank, int procs_number);
 
+/**
+ * Igual que gather_and_reorder_spectrogram pero sobre cualquier comunicador y con los
+ * buffers de rank 0 provistos por el llamador (se pueden reutilizar entre archivos).
+ *
+ * @param mag_temp Buffer de recepción (n_frames * n_bins, solo rank 0 de comm)
+ * @param mag_global Salida ordenada (n_frames * n_bins, solo rank 0 de comm)
+ */
+void gather_spectrogram_into(float* mag_local, int local_frames, int n_frames, int n_bins,
+                             MPI_Comm comm, float* mag_temp, float* mag_global);
+
+/**
+ * Recolecta el espectrograma de la distribución dinámica y lo ubica en orden temporal.
+ * Rank 0 recibe además los bloques (inicio, cantidad) que calculó cada proceso.
+ * 
+ * @param mag_local Array local de magnitudes (bloques concatenados en orden de reclamo)
+ * @param local_frames Cantidad de frames procesados localmente
+ * @param chunks Bloques calculados por este proceso
+ * @param n_frames Cantidad total de frames
+ * @param n_bins Cantidad de bins de frecuencia
+ * @param comm Comunicador de los procesos que calcularon
+ * @param mag_temp Buffer de recepción (n_frames * n_bins, solo rank 0 de comm)
+ * @param mag_global Salida ordenada (n_frames * n_bins, solo rank 0 de comm)
+ */
+void gather_dynamic_spectrogram(float* mag_local, int local_frames, const FrameChunks* chunks,
+                                int n_frames, int n_bins, MPI_Comm comm,
+                                float* mag_temp, float* mag_global);
+
+/**
+ * Igual que gather_dynamic_spectrogram pero sin informar la distribución: sirve para
+ * cualquier reparto en bloques de frames consecutivos (ej. stft_compute_blocks o los
+ * niveles reducidos de la pirámide).
+ */
+void gather_chunked_spectrogram(float* mag_local, int local_frames, const FrameChunks* chunks,
+                                int n_frames, int n_bins, MPI_Comm comm,
+                                float* mag_temp, float* mag_global);
+
+/**
+ * Concatena en rank 0 los floats de cada proceso en orden de rank (filas de bins
+ * contiguos, regiones de la ISTFT). Es colectiva.
+ *
+ * @param local Datos de este proceso
+ * @param count Cantidad de floats de este proceso (puede ser 0)
+ * @param out Salida con la suma de los count (solo rank 0 de comm)
+ */
+void gather_ordered(const float* local, int count, MPI_Comm comm, float* out);
+
+/**
+ * MPI_Reduce hacia rank 0 de comm; en dos niveles reduce primero dentro de cada nodo y
+ * después entre líderes. La operación tiene que ser conmutativa (suma, máximo, mínimo).
+ *
+ * @param recvbuf Resultado en rank 0; debe tener lugar en todos los procesos porque los
+ *                líderes lo usan para el resultado parcial de su nodo
+ */
+void reduce_by_node(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type,
+                    MPI_Op op, MPI_Comm comm);
+
+/* Primer bin del proceso rank en el reparto por bins (bloques contiguos; rank = procs da n_bins) */
+int transpose_bin_first(int rank, int n_bins, int procs_number);
+
+/**
+ * Transpone el espectrograma distribuido por frames (cada proceso con algunos frames
+ * completos) a distribuido por bins: el proceso p queda con los bins
+ * [transpose_bin_first(p), transpose_bin_first(p + 1)) de todos los frames, guardados
+ * bin por bin (la serie temporal de cada bin es contigua). Un único MPI_Alltoallv; el
+ * empaquetado recorre bloques de frames x bins que entran en cache. Es colectiva.
+ *
+ * @param mag_local Frames de este proceso (local_frames * n_bins, frame por frame)
+ * @param frame_index Índice global de cada frame local (cualquier distribución)
+ * @param local_frames Frames de este proceso (puede ser 0)
+ * @param n_frames Frames totales
+ * @param n_bins Bins de cada frame
+ * @param comm Comunicador de los procesos
+ * @param out Salida: bins propios * n_frames, serie por serie
+ */
+void transpose_frames_to_bins(const float* mag_local, const int* frame_index, int local_frames,
+                              int n_frames, int n_bins, MPI_Comm comm, float* out);
+
+/**
+ * Crea el contador compartido en 0 (colectiva sobre comm).
+ * @return 0 si se pudo crear, -1 si no
+ */
+int work_counter_create(WorkCounter* counter, MPI_Comm comm);
+
+/**
+ * Reclama atómicamente 'amount' unidades de trabajo.
+ * @return Valor del contador antes del incremento (primer índice del bloque reclamado)
+ */
+int work_counter_next(WorkCounter* counter, int amount);
+
+/* Libera la ventana del contador (colectiva) */
+void work_counter_free(WorkCounter* counter);
+
 #endif
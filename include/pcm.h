@@ -0,0 +1,61 @@
+#ifndef PCM_H
+#define PCM_H
+
+/* Formatos de muestra soportados en el chunk data */
+typedef enum {
+    PCM_S16 = 0,   /* entero 16 bits */
+    PCM_S24 = 1,   /* entero 24 bits empaquetado (3 bytes) */
+    PCM_S32 = 2,   /* entero 32 bits */
+    PCM_F32 = 3    /* IEEE float 32 bits */
+} pcm_format_t;
+
+/* Códigos de formato del chunk "fmt " */
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+/**
+ * Traduce el código de formato del WAV y los bits por muestra a un formato de decodificación.
+ *
+ * @param audio_format Código de formato (para EXTENSIBLE, el del SubFormat)
+ * @param bits_per_sample Bits por muestra
+ * @param out Formato resultante
+ * @return 0 si el formato está soportado, -1 si no
+ */
+int pcm_format_from_wav(int audio_format, int bits_per_sample, pcm_format_t *out);
+
+/* Bytes que ocupa una muestra de un canal */
+int pcm_bytes_per_sample(pcm_format_t fmt);
+
+/**
+ * Decodifica frames intercalados a float32 normalizado [-1,1] y promedia los canales (mono)
+ * en una sola pasada. Usa kernels SSE2 para mono/estéreo cuando están disponibles.
+ *
+ * @param src Bytes crudos del chunk data (frames * channels muestras, little endian)
+ * @param dst Salida mono (frames elementos)
+ * @param frames Cantidad de frames a decodificar
+ * @param channels Cantidad de canales intercalados
+ * @param fmt Formato de las muestras
+ */
+void pcm_decode_downmix(const void *src, float *dst, int frames, int channels, pcm_format_t fmt);
+
+/**
+ * Decodifica los dos primeros canales por separado (sin mezclar) y, si se pide, la mezcla
+ * mono en la misma pasada (con 1 o 2 canales es el medio (L + R) / 2; con más se hace
+ * además la mezcla de todos con pcm_decode_downmix). Un archivo mono da el mismo canal en
+ * las dos salidas; con más de dos canales se toman los dos primeros. Kernels SSE2 cuando
+ * están disponibles.
+ *
+ * @param src Bytes crudos del chunk data
+ * @param a Salida: izquierdo, o medio (L + R) / 2 si mid_side (frames elementos)
+ * @param b Salida: derecho, o lateral (L - R) / 2 si mid_side (frames elementos)
+ * @param mono Salida mono como la de pcm_decode_downmix (frames elementos) o NULL
+ * @param frames Cantidad de frames a decodificar
+ * @param channels Cantidad de canales intercalados
+ * @param fmt Formato de las muestras
+ * @param mid_side 1 = devolver medio/lateral en vez de izquierdo/derecho
+ */
+void pcm_decode_pair(const void *src, float *a, float *b, float *mono, int frames, int channels,
+                     pcm_format_t fmt, int mid_side);
+
+#endif
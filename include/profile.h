@@ -0,0 +1,60 @@
+/* include/profile.h */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <mpi.h>
+
+/* Etapas medidas */
+typedef enum {
+    PROFILE_STFT = 0,   /* ventaneo + FFT + magnitudes de los frames propios (cada proceso) */
+    PROFILE_BPM = 1,    /* flux + autocorrelación + pico (rank 0) */
+    PROFILE_STAGES = 2
+} profile_stage_t;
+
+/* Contadores de cada etapa */
+typedef enum {
+    COUNTER_CYCLES = 0,
+    COUNTER_INSTRUCTIONS = 1,
+    COUNTER_L1D_MISSES = 2,     /* fallos de lectura en la L1 de datos */
+    COUNTER_LLC_MISSES = 3,     /* fallos en el último nivel de caché (van a memoria) */
+    COUNTER_BRANCH_MISSES = 4,
+    COUNTER_TASK_CLOCK = 5,     /* tiempo de CPU del proceso en ns (contador de software) */
+    PROFILE_COUNTERS = 6
+} profile_counter_t;
+
+/* Contadores abiertos + lo acumulado por etapa (opaco) */
+typedef struct Profile Profile;
+
+/**
+ * @brief Abre los contadores de hardware del proceso (perf_event_open, solo espacio de
+ * usuario). Los que el sistema no da (sin PMU en una VM, perf_event_paranoid, otro SO)
+ * quedan como no disponibles y el reporte los muestra como "n/d".
+ * @return Perfil o NULL si no hay memoria
+ */
+Profile* profile_create(void);
+
+/* Pone en cero lo acumulado (al empezar cada archivo) */
+void profile_reset(Profile* profile);
+
+/* Marca el comienzo de una etapa (lee los contadores) */
+void profile_begin(Profile* profile);
+
+/**
+ * @brief Cierra la etapa empezada con profile_begin y acumula la diferencia de los contadores.
+ * @param frames Frames que procesó este proceso en la etapa
+ * @param flops Operaciones de punto flotante nominales de ese trabajo
+ */
+void profile_end(Profile* profile, profile_stage_t stage, double frames, double flops);
+
+/**
+ * @brief Reduce los contadores de todos los procesos (suma, y el máximo del tiempo de CPU
+ * para ver el desbalance) y rank 0 imprime por etapa: IPC, ciclos y fallos de caché por
+ * frame, tasa de fallos de salto y bytes de memoria (fallos de LLC * 64) por FLOP. Es colectiva.
+ */
+void profile_report(Profile* profile, MPI_Comm comm);
+
+/* Cierra los contadores */
+void profile_destroy(Profile* profile);
+
+#endif /* PROFILE_H */
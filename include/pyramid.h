@@ -0,0 +1,82 @@
+/* include/pyramid.h */
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <mpi.h>
+#include "common.h"
+#include "stft.h"
+
+/* Celdas por lado de cada tile en disco (frames x bins, mismo tamaño en todos los niveles) */
+#define PYRAMID_TILE 256
+
+/* Frames por bloque de la distribución por bloques cuando se arma la pirámide */
+#define PYRAMID_BLOCK_FRAMES 64
+
+/* Los bloques de cada proceso deben empezar en múltiplos del factor del último nivel */
+#define PYRAMID_ALIGN(levels_) (1 << (levels_))
+
+/**
+ * Pirámide de resolución del espectrograma (mip-map): el nivel k agrupa celdas de
+ * 2^k frames x 2^k bins en su máximo y su promedio. El nivel 0 es el espectrograma.
+ */
+typedef struct {
+    int levels;                              /* niveles reducidos (1..levels) */
+    int n_frames[MAX_PYRAMID_LEVELS + 1];    /* frames de cada nivel */
+    int n_bins[MAX_PYRAMID_LEVELS + 1];      /* bins de cada nivel */
+    float* max[MAX_PYRAMID_LEVELS + 1];      /* nivel k >= 1: máximo de cada celda */
+    float* mean[MAX_PYRAMID_LEVELS + 1];     /* nivel k >= 1: promedio de cada celda */
+} Pyramid;
+
+/**
+ * @brief Frames por bloque de la distribución por bloques para una pirámide de 'levels'
+ * niveles (PYRAMID_BLOCK_FRAMES redondeado a múltiplo de PYRAMID_ALIGN(levels)).
+ */
+int pyramid_block_frames(int levels);
+
+/**
+ * @brief Arma la pirámide a partir de los frames que calculó cada proceso. Cada proceso
+ * reduce sus propios bloques nivel por nivel (sin comunicarse) y rank 0 recolecta cada
+ * nivel ya reducido, así que lo que viaja es a lo sumo un tercio del espectrograma.
+ * Es colectiva.
+ *
+ * @param mag_local Magnitudes de este proceso (bloques concatenados)
+ * @param chunks Bloques de frames consecutivos de este proceso; cada uno debe empezar en
+ *               un múltiplo de PYRAMID_ALIGN(levels) (stft_compute_blocks o compute_stft_dynamic
+ *               con ese align)
+ * @param n_frames Frames del espectrograma completo
+ * @param n_bins Bins de cada frame
+ * @param levels Niveles reducidos (1..MAX_PYRAMID_LEVELS)
+ * @param comm Comunicador de los procesos que calcularon el STFT
+ * @return Pirámide completa en rank 0 (liberar con free_pyramid), NULL en los demás
+ */
+Pyramid* compute_pyramid_parallel(const float* mag_local, const FrameChunks* chunks,
+                                  int n_frames, int n_bins, int levels, MPI_Comm comm);
+
+/**
+ * @brief Arma la pirámide de un espectrograma completo en un solo proceso
+ * (ej. cuando el espectrograma viene de la cache).
+ * @return Pirámide o NULL si no hay memoria
+ */
+Pyramid* compute_pyramid(const float* spectrogram, int n_frames, int n_bins, int levels);
+
+/**
+ * @brief Escribe la pirámide en <dir>/pyramid: un archivo float32 por nivel y reducción
+ * (nivel0.f32, nivelK_max.f32, nivelK_mean.f32) e index.csv con las dimensiones.
+ * Cada archivo son tiles de PYRAMID_TILE x PYRAMID_TILE celdas (frames x bins, rellenos
+ * con 0 en los bordes) ordenados por tile de tiempo y después de frecuencia, así que un
+ * visor puede leer con un seek solo los tiles del nivel y la zona que muestra.
+ *
+ * @param dir Directorio de resultados del audio
+ * @param pyramid Niveles reducidos
+ * @param spectrogram Espectrograma completo (nivel 0)
+ * @param cfg Configuración (fs, N, hop y banda para las escalas de tiempo y frecuencia)
+ * @return 0 si se escribió, -1 si hubo un error
+ */
+int write_pyramid(const char* dir, const Pyramid* pyramid, const float* spectrogram,
+                  const Config* cfg);
+
+/* Libera la pirámide */
+void free_pyramid(Pyramid* pyramid);
+
+#endif /* PYRAMID_H */
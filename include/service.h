@@ -0,0 +1,29 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <mpi.h>
+#include "common.h"
+
+/* Largo máximo de una línea de trabajo (ruta + opciones) */
+#define SERVICE_LINE_MAX 2048
+
+/**
+ * Modo servicio: los procesos quedan iniciados y analizan un archivo por trabajo, sin
+ * relanzar mpirun ni MPI_Init. Rank 0 escucha en un socket Unix (cfg->serve_path); cada
+ * línea recibida es un trabajo "<ruta.wav> [opciones]" con las mismas opciones de la línea
+ * de comandos (se aplican sobre cfg) y se difunde a los demás procesos. Por cada trabajo
+ * responde una línea:
+ *
+ *   OK <directorio de resultados> <bpm> <segundos>
+ *   ERROR <ruta> <motivo>
+ *
+ * Las líneas "ping" (responde "OK pong"), "quit" (cierra la conexión) y "shutdown"
+ * (termina el servicio) son comandos. Es colectiva sobre comm.
+ *
+ * @param cfg Configuración base de los trabajos
+ * @param comm Comunicador de los procesos que colaboran
+ * @return 0 al terminar con "shutdown", -1 si no se pudo abrir el socket
+ */
+int service_run(const Config* cfg, MPI_Comm comm);
+
+#endif
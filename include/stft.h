@@ -1,6 +1,23 @@
 #ifndef STFT_H
 #define STFT_H
 
+#include <mpi.h>
+#include "common.h"
+#include "buffer.h"
+
+/* Bloques de frames consecutivos que calculó un proceso en la distribución dinámica */
+typedef struct {
+    int* starts;    /* primer frame global de cada bloque */
+    int* counts;    /* cantidad de frames de cada bloque */
+    int n_chunks;   /* cantidad de bloques */
+    int capacity;   /* lugar reservado en starts/counts */
+} FrameChunks;
+
+#define FRAME_CHUNKS_INIT { NULL, NULL, 0, 0 }
+
+/* Plan de FFT + ventana + buffers de un frame (opaco) */
+typedef struct StftWorkspace StftWorkspace;
+
 /**
  * Calcula el STFT (Short-Time Fourier Transform) de un conjunto de frames asignados a este proceso en una distribución cíclica.
  * 
@@ -11,9 +28,10 @@
  * @param n_frames Cantidad total de ventanas a procesar
  * @param n_bins Cantidad de "contenedores" de frecuencia que produce fft
  * @param local_frames Cantidad de frames que procesará este proceso
+ * @param cfg Configuración de la corrida (N, hop y tipo de ventana)
  * @return Array con las magnitudes calculadas (local_frames * n_bins elementos)
  */
-float* compute_stft_local(float* samples, int n_samples, int rank, int procs_number, int n_frames, int n_bins, int local_frames);
+float* compute_stft_local(float* samples, int n_samples, int rank, int procs_number, int n_frames, int n_bins, int local_frames, const Config* cfg);
 
 /**
  * Calcula cuántas ventanas procesará un proceso dado en distribución cíclica.
@@ -25,4 +43,116 @@ float* compute_stft_local(float* samples, int n_samples, int rank, int procs_num
  */
 int calculate_local_frames(int rank, int n_frames, int procs_number);
 
+/**
+ * Calcula cuántas ventanas procesará un proceso en distribución cíclica por bloques
+ * (bloque b de 'block' frames consecutivos al proceso b % procs_number).
+ */
+int calculate_block_frames(int rank, int n_frames, int procs_number, int block);
+
+/**
+ * Crea el estado reutilizable del STFT para una configuración: plan de FFT (o de banda),
+ * ventana precalculada y buffers de un frame. Sirve para todos los archivos que usen
+ * los mismos N, hop, ventana y banda.
+ *
+ * @param cfg Configuración (N, hop, ventana y bins de la banda ya resueltos)
+ * @return Workspace o NULL si no hay memoria
+ */
+StftWorkspace* stft_workspace_create(const Config* cfg);
+
+/* Devuelve 1 si el workspace se creó para los mismos parámetros de STFT que cfg */
+int stft_workspace_matches(const StftWorkspace* ws, const Config* cfg);
+
+/* Libera el workspace */
+void stft_workspace_destroy(StftWorkspace* ws);
+
+/**
+ * Igual que compute_stft_local, pero con un workspace ya creado y escribiendo en un buffer
+ * del llamador (calculate_local_frames(rank, ...) * n_bins elementos).
+ */
+void stft_compute_cyclic(StftWorkspace* ws, const float* samples, int rank, int procs_number,
+                         int n_frames, int n_bins, float* mag_local);
+
+/**
+ * Calcula el STFT con distribución cíclica por bloques: el proceso se queda con bloques
+ * de frames consecutivos, lo que permite procesar después cada bloque en el tiempo sin
+ * comunicarse (ej. los niveles reducidos de la pirámide).
+ *
+ * @param block Frames por bloque
+ * @param mag_local Destino (calculate_block_frames(rank, ...) * n_bins elementos)
+ * @param chunks Salida: bloques calculados, en orden (se reutiliza entre llamadas)
+ * @return 0 si todo salió bien, -1 si no hay memoria
+ */
+int stft_compute_blocks(StftWorkspace* ws, const float* samples, int rank, int procs_number,
+                        int n_frames, int n_bins, int block, float* mag_local, FrameChunks* chunks);
+
+/**
+ * Calcula los frames [first, first + count) conservando el espectro complejo (no solo la
+ * magnitud), para poder modificarlo y volver al tiempo (ver istft.h). Se guardan los
+ * N/2 + 1 bins no redundantes de cada frame. Requiere un workspace de espectro completo.
+ *
+ * @param spec_re Destino de las partes reales (count * (N/2 + 1))
+ * @param spec_im Destino de las partes imaginarias (count * (N/2 + 1))
+ * @param chunks Salida: el bloque calculado (para gather_chunked_spectrogram)
+ * @return 0 si todo salió bien, -1 si el workspace es de banda limitada o no hay memoria
+ */
+int stft_compute_complex(StftWorkspace* ws, const float* samples, int first, int count,
+                         float* spec_re, float* spec_im, FrameChunks* chunks);
+
+/**
+ * Magnitudes de los bins [bin_lo, bin_lo + n_bins) de frames complejos
+ * (mismo resultado que el STFT de magnitudes con la FFT completa).
+ */
+void stft_magnitudes(const float* spec_re, const float* spec_im, int count, int n_full,
+                     int bin_lo, int n_bins, float* mag);
+
+/**
+ * Igual que stft_compute_cyclic pero para dos canales a la vez: a va en la parte real y b
+ * en la imaginaria de una sola FFT compleja, y los dos espectros se separan por simetría
+ * conjugada. Cuesta prácticamente lo mismo que el STFT mono. Requiere un workspace de
+ * espectro completo (la banda se recorta al guardar).
+ *
+ * @param a Primer canal (izquierdo o medio)
+ * @param b Segundo canal (derecho o lateral)
+ * @param bin_lo Primer bin a guardar
+ * @param n_bins Bins a guardar por frame
+ * @param mix Mezcla mono, solo si no se puede armar con a y b (más de dos canales: cuesta
+ *            una FFT más por frame); NULL = la mezcla sale de los mismos espectros
+ * @param mode STEREO_LR (mono = (a + b) / 2) o STEREO_MS (mono = a)
+ * @param mag_mono Magnitudes de la mezcla mono (frames propios * n_bins)
+ * @param mag_a Magnitudes del primer canal (frames propios * n_bins)
+ * @param mag_b Magnitudes del segundo canal
+ * @return 0 si todo salió bien, -1 si el workspace es de banda limitada
+ */
+int stft_compute_pair_cyclic(StftWorkspace* ws, const float* a, const float* b, const float* mix, int rank,
+                             int procs_number, int n_frames, int bin_lo, int n_bins, stereo_t mode,
+                             float* mag_mono, float* mag_a, float* mag_b);
+
+/**
+ * Calcula el STFT con distribución dinámica: cada proceso reclama bloques de frames
+ * de un contador compartido (MPI_Fetch_and_op sobre una ventana RMA) hasta agotarlos.
+ * El tamaño del bloque es guiado (decrece a medida que quedan menos frames), así que
+ * un nodo más rápido termina procesando más frames. Es colectiva sobre comm.
+ * 
+ * @param ws Workspace del STFT (plan, ventana y buffers de un frame)
+ * @param samples Array completo de muestras de audio
+ * @param n_frames Cantidad total de ventanas a procesar
+ * @param n_bins Cantidad de "contenedores" de frecuencia que produce fft
+ * @param chunk_min Tamaño mínimo de bloque (en frames)
+ * @param align Los bloques son múltiplos de align frames (y empiezan en múltiplos de align);
+ *              1 = sin restricción
+ * @param comm Comunicador de los procesos que colaboran
+ * @param mag_local Destino de las magnitudes, bloque tras bloque: crece con cada bloque
+ *                  reclamado (no se sabe de antemano cuántos frames tocan) y se reutiliza
+ *                  entre llamadas; los datos quedan en mag_local->data
+ * @param local_frames Salida: cantidad de frames que calculó este proceso
+ * @param chunks Salida: bloques calculados, en el orden en que se guardaron (se reutiliza entre llamadas)
+ * @return 0 si todo salió bien, -1 si no hay memoria
+ */
+int compute_stft_dynamic(StftWorkspace* ws, const float* samples, int n_frames, int n_bins,
+                         int chunk_min, int align, MPI_Comm comm, GrowBuffer* mag_local,
+                         int* local_frames, FrameChunks* chunks);
+
+/* Libera las listas de bloques de compute_stft_dynamic */
+void free_frame_chunks(FrameChunks* chunks);
+
 #endif
@@ -0,0 +1,81 @@
+/* include/store.h */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdint.h>
+#include "common.h"
+
+/* Archivos del almacén dentro de su directorio */
+#define STORE_RECORDS_FILE "records.bin"   /* registros de largo fijo, solo se agregan */
+#define STORE_BLOB_FILE "blob.bin"         /* rutas y curvas de flux de todos los tracks */
+#define STORE_INDEX_FILE "index.bin"       /* (hash de ruta, registro) ordenado por hash */
+
+/* Registros sin indexar que se toleran antes de rehacer el índice */
+#define STORE_INDEX_TAIL 256
+
+/* Resultado de un track (largo fijo: el catálogo se recorre con una lectura secuencial) */
+typedef struct {
+    uint64_t path_hash;    /* hash de la ruta tal como aparece en la lista */
+    uint64_t path_offset;  /* ruta en blob.bin (path_len bytes, sin '\0') */
+    uint64_t flux_offset;  /* curva de flux en blob.bin (n_flux floats) */
+    int path_len;
+    int n_flux;
+    int sample_rate;
+    int hop;               /* avance del STFT: eje de tiempo del flux */
+    float duration_s;
+    float bpm;
+    float confidence;      /* autocorrelación normalizada del flux en el lag del BPM [0,1] */
+    uint32_t check;        /* hash de los campos anteriores: descarta registros incompletos */
+} StoreRecord;
+
+/* Hash de una ruta (clave del índice) */
+uint64_t store_path_hash(const char* path);
+
+/**
+ * @brief Agrega el resultado de un track al almacén (crea el directorio y los archivos si
+ * no existen). Primero se escriben la ruta y el flux al final de blob.bin y se bajan a
+ * disco; después el registro, con una sola escritura al final de records.bin. Un lector
+ * nunca ve un registro que apunte a datos que no están. Varios procesos pueden agregar a
+ * la vez (modo lote): cada agregado toma un lock exclusivo sobre records.bin. Cada
+ * STORE_INDEX_TAIL registros se rehace el índice ordenado (temporal + rename).
+ *
+ * @param dir Directorio del almacén
+ * @param path Ruta del audio (clave de búsqueda)
+ * @param record Valores del track (duración, sample rate, hop, BPM y confianza; el resto se completa acá)
+ * @param flux Curva de flux (n_flux floats)
+ * @return 0 si se agregó, -1 si hubo un error
+ */
+int store_append(const char* dir, const char* path, const StoreRecord* record,
+                 const float* flux, int n_flux);
+
+/**
+ * @brief Busca el último resultado guardado de una ruta: búsqueda binaria en el índice y
+ * recorrido de los registros agregados después de la última vez que se rehízo.
+ * @return 0 si lo encontró, -1 si no está (o el almacén no existe)
+ */
+int store_lookup(const char* dir, const char* path, StoreRecord* record);
+
+/**
+ * @brief Lee la curva de flux de un registro.
+ * @return Array de record->n_flux floats (el llamador lo libera con free) o NULL
+ */
+float* store_read_flux(const char* dir, const StoreRecord* record);
+
+/**
+ * @brief Imprime el último resultado guardado de una ruta y su curva de flux en el formato
+ * de analysis_results.csv (tiempo_seg,flux_onset,bpm_estimado).
+ * @return 0 si la ruta estaba en el almacén, -1 si no
+ */
+int store_print_track(const char* dir, const char* path);
+
+/**
+ * @brief Imprime en CSV (ruta, BPM, confianza, duración y sample rate) los tracks cuyo
+ * último resultado tiene BPM en [bpm_lo, bpm_hi]. Los registros se leen con una sola
+ * pasada secuencial sobre records.bin; solo las rutas de los que coinciden se leen del blob.
+ *
+ * @return Cantidad de tracks encontrados, -1 si el almacén no se pudo leer
+ */
+int store_query_bpm(const char* dir, float bpm_lo, float bpm_hi);
+
+#endif /* STORE_H */
@@ -0,0 +1,41 @@
+/* include/tempogram.h */
+
+#ifndef TEMPOGRAM_H
+#define TEMPOGRAM_H
+
+#include <mpi.h>
+#include "common.h"
+
+/* Tempo variable en el tiempo: un BPM por ventana de análisis de la curva de flux */
+typedef struct {
+    int num_windows;
+    int window_frames;    /* largo de cada ventana (frames de flux) */
+    int hop_frames;       /* avance entre ventanas (frames de flux) */
+    float* bpm;           /* BPM de cada ventana (0 si no hubo pico) */
+    float* confidence;    /* autocorrelación normalizada en el pico [0,1] */
+} Tempogram;
+
+/**
+ * @brief Calcula el tempograma repartiendo las ventanas de análisis entre procesos.
+ * La curva de flux (válida solo en rank 0) se difunde a todos; cada proceso calcula la
+ * autocorrelación restringida al rango de lags del BPM y el pico de sus ventanas
+ * (distribución cíclica) y rank 0 recolecta la curva completa. Es colectiva.
+ * 
+ * @param flux Curva de flux (solo se lee en rank 0)
+ * @param num_frames Largo de la curva de flux
+ * @param cfg Configuración (fs, hop, rango de BPM y ventana/avance del tempograma)
+ * @param comm Comunicador de los procesos que colaboran (rank 0 de comm tiene el flux)
+ * @return Tempograma completo en rank 0 (liberar con free_tempogram), NULL en los demás
+ */
+Tempogram* compute_tempogram_parallel(const float* flux, int num_frames, const Config* cfg,
+                                      MPI_Comm comm);
+
+/**
+ * @brief Escribe el tempograma a CSV (una fila por ventana).
+ */
+void write_tempogram_csv(const char* filename, const Tempogram* tempogram, const Config* cfg);
+
+/* Libera el tempograma */
+void free_tempogram(Tempogram* tempogram);
+
+#endif /* TEMPOGRAM_H */
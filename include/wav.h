@@ -2,6 +2,7 @@
 #define WAV_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include "../include/common.h"
 
 #ifdef __cplusplus
@@ -13,15 +14,37 @@ typedef struct {
     int samplerate;       /* Hz */
     int n_samples;        /* total de muestras (ya en mono) */
     int channels;         /* cantidad de canales originales */
+    int bits_per_sample;  /* bits por muestra en el archivo (16, 24 o 32) */
     float *samples;       /* buffer de muestras mono normalizadas [-1,1] */
+    int capacity;         /* muestras alojadas en samples (>= n_samples) */
+    float *channel[2];    /* solo con wav_read_channels: los dos canales por separado */
+    int channel_capacity; /* muestras alojadas en cada channel[c] */
+    uint64_t data_hash;   /* hash del chunk "data" (clave de la cache de resultados) */
 } WAVFile;
 
-/* Lectura de archivo WAV PCM16 mono o estéreo */
+/* Lectura de archivo WAV PCM 16/24/32 bits o float32 (mezclado a mono) */
 int wav_read(const char *path, WAVFile *out);
 
+/* Igual que wav_read, pero reutiliza out->samples si alcanza (out debe venir de un
+   wav_read previo o inicializado en cero). Si falla, out conserva su buffer. */
+int wav_read_reuse(const char *path, WAVFile *out);
+
+/* Igual que wav_read_reuse, pero además deja los dos primeros canales sin mezclar en
+   out->channel (izquierdo/derecho, o medio/lateral si mid_side; ver pcm_decode_pair) */
+int wav_read_channels(const char *path, WAVFile *out, int mid_side);
+
+/* Lee solo el encabezado: muestras por canal y sample rate (sin decodificar el audio) */
+int wav_probe(const char *path, int *frames, int *samplerate);
+
+/* Hash rápido (64 bits) de un bloque de bytes; encadenable pasando el hash anterior como seed */
+uint64_t wav_hash_bytes(const void *data, size_t len, uint64_t seed);
+
 /* Libera la memoria del WAVFile */
 void wav_free(WAVFile *w);
 
+/* Escribe un WAV mono float32 (WAVE_FORMAT_IEEE_FLOAT); 0 si se escribió, -1 si no */
+int wav_write_float(const char *path, const float *samples, int n_samples, int samplerate);
+
 /* Guarda features en un CSV */
 int wav_write_features_csv(const char *outpath, const float *times, const float *rms,
                            const float *centroid, const float *rolloff, const float *flux,
@@ -30,6 +53,11 @@ int wav_write_features_csv(const char *outpath, const float *times, const float
 
 int load_wav_list(const char *path, char files[MAX_FILES][MAX_PATH]);
 
+/* Igual que load_wav_list pero sin límite de archivos: devuelve las rutas una tras otra
+   (cada una terminada en '\0'), su cantidad en count y los bytes usados en bytes.
+   NULL si no se pudo abrir. Liberar con free. */
+char *load_wav_list_all(const char *path, int *count, size_t *bytes);
+
 #ifdef __cplusplus
 }
 #endif
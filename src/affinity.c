@@ -0,0 +1,198 @@
+/* sched_setaffinity y CPU_SET son extensiones de GNU */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include "affinity.h"
+
+/* Lee la primera línea de un archivo de /sys; -1 si no existe */
+static int read_sys_line(const char* path, char* buf, size_t size) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    if (!fgets(buf, (int)size, f)) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+/* Interpreta listas de /sys como "0-3,8-11,16"; devuelve cuántos ids escribió */
+static int parse_id_list(const char* text, int* ids, int max_ids) {
+    int count = 0, first, last, id;
+    char* end;
+
+    while (*text) {
+        first = (int)strtol(text, &end, 10);
+        if (end == text) break;
+        last = first;
+        text = end;
+        if (*text == '-') {
+            last = (int)strtol(text + 1, &end, 10);
+            text = end;
+        }
+        for (id = first; id <= last && count < max_ids; id++) {
+            ids[count++] = id;
+        }
+        if (*text == ',') text++;
+        else break;
+    }
+    return count;
+}
+
+int affinity_read_topology(CpuTopology* topo) {
+    cpu_set_t allowed;
+    char line[4096], path[128];
+    int nodes[256], cpus[AFFINITY_MAX_CPUS];
+    int n_nodes, n_cpus, i, j, have_allowed;
+
+    topo->n_cpus = 0;
+    topo->n_nodes = 0;
+
+    /* Solo las CPUs que nos dejan usar (mpirun, taskset o cgroups pueden restringirlas) */
+    CPU_ZERO(&allowed);
+    have_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    /* 1. Nodos NUMA y sus CPUs */
+    n_nodes = 0;
+    if (read_sys_line("/sys/devices/system/node/online", line, sizeof(line)) == 0) {
+        n_nodes = parse_id_list(line, nodes, 256);
+    }
+
+    for (i = 0; i < n_nodes; i++) {
+        int used = 0;
+
+        sprintf(path, "/sys/devices/system/node/node%d/cpulist", nodes[i]);
+        if (read_sys_line(path, line, sizeof(line)) != 0) continue;
+
+        n_cpus = parse_id_list(line, cpus, AFFINITY_MAX_CPUS);
+        for (j = 0; j < n_cpus && topo->n_cpus < AFFINITY_MAX_CPUS; j++) {
+            if (have_allowed && (cpus[j] >= CPU_SETSIZE || !CPU_ISSET(cpus[j], &allowed))) continue;
+            topo->cpus[topo->n_cpus] = cpus[j];
+            topo->nodes[topo->n_cpus] = nodes[i];
+            topo->n_cpus++;
+            used = 1;
+        }
+        topo->n_nodes += used;
+    }
+
+    /* 2. Sin información NUMA: todas las CPUs en un nodo */
+    if (topo->n_cpus == 0) {
+        n_cpus = 0;
+        if (read_sys_line("/sys/devices/system/cpu/online", line, sizeof(line)) == 0) {
+            n_cpus = parse_id_list(line, cpus, AFFINITY_MAX_CPUS);
+        }
+        for (j = 0; j < n_cpus; j++) {
+            if (have_allowed && (cpus[j] >= CPU_SETSIZE || !CPU_ISSET(cpus[j], &allowed))) continue;
+            topo->cpus[topo->n_cpus] = cpus[j];
+            topo->nodes[topo->n_cpus] = 0;
+            topo->n_cpus++;
+        }
+        topo->n_nodes = topo->n_cpus > 0 ? 1 : 0;
+    }
+
+    return topo->n_cpus > 0 ? 0 : -1;
+}
+
+int affinity_apply(MPI_Comm comm, Placement* placement) {
+    CpuTopology* topo;
+    MPI_Comm local;
+    cpu_set_t set;
+    char host[MPI_MAX_PROCESSOR_NAME];
+    char* hosts = NULL;
+    int* all = NULL;
+    int info[2];
+    int rank, procs_number, local_rank, local_size, index, host_len, r;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    /* Procesos que comparten máquina (y por lo tanto CPUs) */
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &local);
+    MPI_Comm_rank(local, &local_rank);
+    MPI_Comm_size(local, &local_size);
+    MPI_Comm_free(&local);
+
+    placement->cpu = -1;
+    placement->numa_node = -1;
+
+    topo = malloc(sizeof(CpuTopology));
+    if (topo && affinity_read_topology(topo) == 0) {
+        /* Bloques sobre la lista ordenada por nodo: ranks locales consecutivos en el mismo
+           nodo y, si hay menos ranks que CPUs, repartidos entre todos los nodos */
+        if (local_size <= topo->n_cpus) {
+            index = (int)((long)local_rank * topo->n_cpus / local_size);
+        } else {
+            index = local_rank % topo->n_cpus;
+        }
+
+        CPU_ZERO(&set);
+        CPU_SET(topo->cpus[index], &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+            placement->cpu = topo->cpus[index];
+            placement->numa_node = topo->nodes[index];
+        } else {
+            perror("sched_setaffinity");
+        }
+
+        if (rank == 0) {
+            printf("Topologia: %d CPUs permitidas en %d nodos NUMA\n", topo->n_cpus, topo->n_nodes);
+        }
+    } else if (rank == 0) {
+        fprintf(stderr, "Advertencia: no se pudo leer la topologia, procesos sin fijar\n");
+    }
+    free(topo);
+
+    /* Reporte: rank 0 muestra dónde quedó cada proceso */
+    info[0] = placement->cpu;
+    info[1] = placement->numa_node;
+    memset(host, 0, sizeof(host));
+    MPI_Get_processor_name(host, &host_len);
+
+    if (rank == 0) {
+        all = malloc(procs_number * 2 * sizeof(int));
+        hosts = malloc((size_t)procs_number * MPI_MAX_PROCESSOR_NAME);
+        if (!all || !hosts) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para el reporte de afinidad\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(info, 2, MPI_INT, all, 2, MPI_INT, 0, comm);
+    MPI_Gather(host, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, hosts, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, 0, comm);
+
+    if (rank == 0) {
+        for (r = 0; r < procs_number; r++) {
+            if (all[2 * r] >= 0) {
+                printf("Afinidad: rank %d -> %s cpu %d (nodo NUMA %d)\n",
+                       r, hosts + (size_t)r * MPI_MAX_PROCESSOR_NAME, all[2 * r], all[2 * r + 1]);
+            } else {
+                printf("Afinidad: rank %d -> %s sin fijar\n", r, hosts + (size_t)r * MPI_MAX_PROCESSOR_NAME);
+            }
+        }
+        fflush(stdout);
+        free(all);
+        free(hosts);
+    }
+
+    return placement->cpu >= 0 ? 0 : -1;
+}
+
+void affinity_first_touch(void* data, size_t from, size_t to) {
+    char* bytes = (char*)data;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t step = page > 0 ? (size_t)page : 4096;
+    size_t i;
+
+    /* Escrituras separadas una página: ninguna página del rango queda sin tocar */
+    for (i = from; i < to; i += step) {
+        bytes[i] = 0;
+    }
+    if (to > from) {
+        bytes[to - 1] = 0;
+    }
+}
@@ -0,0 +1,859 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "analyzer.h"
+#include "wav.h"
+#include "stft.h"
+#include "mpi_utils.h"
+#include "bpm.h"
+#include "config.h"
+#include "cache.h"
+#include "band.h"
+#include "tempogram.h"
+#include "pyramid.h"
+#include "istft.h"
+#include "modulation.h"
+#include "cqt.h"
+#include "store.h"
+#include "profile.h"
+#include "arena.h"
+#include "affinity.h"
+
+struct Analyzer {
+    Config base;            /* configuración tal como la pidió el usuario */
+    MPI_Comm comm;          /* duplicado: no interfiere con otros mensajes del llamador */
+    int rank;
+    int procs_number;
+    StftWorkspace* stft;    /* se recrea solo si cambian N, hop, ventana o banda */
+    CqtKernel* cqt;         /* kernels de la CQT: se recrean solo si cambian fs, bins o f_min */
+    WAVFile wav;            /* rank 0: muestras del último archivo (buffer reutilizado) */
+    Arena* arena;           /* buffers de cada corrida: muestras, magnitudes, flux, ACF */
+    FrameChunks chunks;     /* bloques de la distribución dinámica */
+    GrowBuffer dynamic_mag; /* magnitudes de la distribución dinámica: crece con lo reclamado,
+                               fuera de la arena (sin páginas enormes reservadas de más) */
+    size_t dynamic_peak;    /* bytes de dynamic_mag que llegaron a usarse */
+    Profile* profile;       /* contadores de hardware (solo con --profile) */
+};
+
+/* Devuelve 1 si el archivo existe */
+static int file_exists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+/* results/<nombre sin "data/" ni ".wav">; -1 si la ruta no entra en MAX_PATH */
+static int build_results_dir(const char* path, char* out) {
+    const char* name = path;
+    size_t len;
+
+    if (strncmp(name, "data/", 5) == 0) {
+        name += 5;
+    }
+    len = strlen(name);
+    if (len > 4 && strcmp(name + len - 4, ".wav") == 0) {
+        len -= 4;
+    }
+
+    /* Dejamos lugar para "/analysis_results.csv" y similares */
+    if (len == 0 || len + 8 + 32 >= MAX_PATH) {
+        return -1;
+    }
+
+    memcpy(out, "results/", 8);
+    memcpy(out + 8, name, len);
+    out[8 + len] = '\0';
+    return 0;
+}
+
+/* Crea el directorio y los intermedios que falten (ignora los que ya existen) */
+static void make_dirs(const char* dir) {
+    char partial[MAX_PATH];
+    size_t i;
+
+    for (i = 0; dir[i] != '\0' && i < sizeof(partial) - 1; i++) {
+        if (dir[i] == '/' && i > 0) {
+            partial[i] = '\0';
+            mkdir(partial, 0755);
+        }
+        partial[i] = dir[i];
+    }
+    partial[i] = '\0';
+    mkdir(partial, 0755);
+}
+
+/**
+ * Pide n floats a la arena del contexto (aborta si no hay memoria, como el resto del
+ * programa). Con --affinity y touch != 0 las páginas se tocan enseguida desde el core del
+ * proceso; los buffers que se llenan parcialmente (touch = 0) se dejan para el primer uso.
+ */
+static float* arena_floats(Analyzer* analyzer, size_t n, int touch, const char* what) {
+    float* data = arena_alloc(analyzer->arena, n * sizeof(float));
+    if (!data) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para %s\n", what);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (touch && analyzer->base.affinity) {
+        affinity_first_touch(data, 0, n * sizeof(float));
+    }
+    return data;
+}
+
+/**
+ * Índice global de cada frame que tiene este proceso en mag_local: los repartos en bloques
+ * (dinámico, pirámide, resíntesis) lo sacan de los bloques calculados; si no, los frames
+ * son first, first + stride, first + 2 * stride, ... (cíclico: rank y P)
+ */
+static int* local_frame_index(Analyzer* analyzer, int chunked, int local_frames, int first, int stride) {
+    int* index = arena_alloc(analyzer->arena, ((size_t)local_frames + 1) * sizeof(int));
+    int c, j, n = 0;
+
+    if (!index) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para los indices de frames\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (chunked) {
+        for (c = 0; c < analyzer->chunks.n_chunks; c++) {
+            for (j = 0; j < analyzer->chunks.counts[c]; j++) {
+                index[n++] = analyzer->chunks.starts[c] + j;
+            }
+        }
+    } else {
+        for (j = 0; j < local_frames; j++) {
+            index[j] = first + j * stride;
+        }
+    }
+    return index;
+}
+
+/* FLOPs nominales del STFT de count frames (5 N log2 N por FFT, la medida usual) */
+static double stft_flops(const Config* cfg, int count) {
+    return (double)count * 5.0 * cfg->N * (log((double)cfg->N) / log(2.0));
+}
+
+/* Nombre corto de cada canal del análisis por canal */
+static const char* channel_name(stereo_t mode, int c) {
+    if (mode == STEREO_MS) return c == 0 ? "M" : "S";
+    return c == 0 ? "L" : "R";
+}
+
+static int write_spectrogram_csv(const char* path, const float* mag, int n_frames, int n_bins) {
+    FILE* f;
+    int i, k;
+
+    f = fopen(path, "w");
+    if (!f) {
+        perror("No se pudo crear el archivo CSV");
+        return -1;
+    }
+
+    for (i = 0; i < n_frames; i++) {
+        for (k = 0; k < n_bins; k++) {
+            fprintf(f, "%.6f", mag[(size_t)i * n_bins + k]);
+            if (k < n_bins - 1)
+                fprintf(f, ",");
+        }
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/* Flux de cada canal, una fila por frame (mismo formato de tiempo que analysis_results.csv) */
+static int write_channel_flux_csv(const char* path, float* const flux[2], int n_frames,
+                                  const Config* cfg) {
+    FILE* f = fopen(path, "w");
+    int t;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    fprintf(f, "tiempo_seg,flux_%s,flux_%s\n", channel_name(cfg->stereo, 0), channel_name(cfg->stereo, 1));
+    for (t = 0; t < n_frames; t++) {
+        fprintf(f, "%.6f,%.6f,%.6f\n", (float)t * cfg->hop / cfg->fs, flux[0][t], flux[1][t]);
+    }
+
+    fclose(f);
+    return 0;
+}
+
+Analyzer* analyzer_create(const Config* cfg, MPI_Comm comm) {
+    Analyzer* analyzer;
+    FrameChunks empty_chunks = FRAME_CHUNKS_INIT;
+    GrowBuffer empty_buffer = GROW_BUFFER_INIT;
+    int nodes;
+
+    analyzer = malloc(sizeof(Analyzer));
+    if (!analyzer) {
+        return NULL;
+    }
+
+    analyzer->base = *cfg;
+    MPI_Comm_dup(comm, &analyzer->comm);
+    MPI_Comm_rank(analyzer->comm, &analyzer->rank);
+    MPI_Comm_size(analyzer->comm, &analyzer->procs_number);
+
+    /* Las recolecciones sobre el comunicador del analizador pasan por los líderes de nodo */
+    nodes = node_topology_attach(analyzer->comm, cfg->gather, cfg->node_size);
+    if (nodes > 0 && analyzer->rank == 0) {
+        printf("Recoleccion en dos niveles: %d nodos, un lider por nodo\n", nodes);
+    }
+
+    analyzer->stft = NULL;
+    analyzer->cqt = NULL;
+    memset(&analyzer->wav, 0, sizeof(WAVFile));
+    analyzer->chunks = empty_chunks;
+    analyzer->dynamic_mag = empty_buffer;
+    analyzer->dynamic_peak = 0;
+    analyzer->profile = NULL;
+
+    /* Una arena por proceso; crece con el primer archivo largo y después se reutiliza */
+    analyzer->arena = arena_create(0, cfg->huge_pages ? ARENA_HUGE_PAGES : 0);
+    if (cfg->profile) {
+        analyzer->profile = profile_create();
+    }
+    if (!analyzer->arena || (cfg->profile && !analyzer->profile)) {
+        arena_destroy(analyzer->arena);
+        MPI_Comm_free(&analyzer->comm);
+        free(analyzer);
+        return NULL;
+    }
+
+    return analyzer;
+}
+
+void analyzer_set_config(Analyzer* analyzer, const Config* cfg) {
+    analyzer->base = *cfg;
+}
+
+size_t analyzer_peak_memory(const Analyzer* analyzer) {
+    return arena_peak(analyzer->arena) + analyzer->dynamic_peak;
+}
+
+size_t analyzer_huge_page_memory(const Analyzer* analyzer) {
+    return arena_huge_bytes(analyzer->arena);
+}
+
+void analyzer_destroy(Analyzer* analyzer) {
+    if (!analyzer) return;
+    stft_workspace_destroy(analyzer->stft);
+    cqt_kernel_destroy(analyzer->cqt);
+    wav_free(&analyzer->wav);
+    arena_destroy(analyzer->arena);
+    free_frame_chunks(&analyzer->chunks);
+    grow_buffer_free(&analyzer->dynamic_mag);
+    profile_destroy(analyzer->profile);
+    MPI_Comm_free(&analyzer->comm);
+    free(analyzer);
+}
+
+/* Crea (o reutiliza) el workspace del STFT para la configuración de esta corrida */
+static StftWorkspace* analyzer_workspace(Analyzer* analyzer, const Config* cfg) {
+    if (analyzer->stft && stft_workspace_matches(analyzer->stft, cfg)) {
+        return analyzer->stft;
+    }
+
+    stft_workspace_destroy(analyzer->stft);
+    analyzer->stft = stft_workspace_create(cfg);
+    if (!analyzer->stft) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para el STFT\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return analyzer->stft;
+}
+
+/* Crea (o reutiliza) los kernels de la CQT para el sample rate de esta corrida */
+static CqtKernel* analyzer_cqt(Analyzer* analyzer, const Config* cfg) {
+    if (analyzer->cqt && cqt_kernel_matches(analyzer->cqt, cfg->fs, cfg->cqt_bins, cfg->cqt_f_min)) {
+        return analyzer->cqt;
+    }
+
+    cqt_kernel_destroy(analyzer->cqt);
+    analyzer->cqt = cqt_kernel_create(cfg->fs, cfg->cqt_bins, cfg->cqt_f_min);
+    if (!analyzer->cqt) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para los kernels de la CQT\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return analyzer->cqt;
+}
+
+int analyzer_run(Analyzer* analyzer, const char* path, AnalyzerReport* report) {
+    MPI_Comm comm = analyzer->comm;
+    int rank = analyzer->rank;
+    Config cfg = analyzer->base;
+    CacheKey cache_key;
+    char results_dir[MAX_PATH];
+    char spectrogram_path[MAX_PATH];
+    char analysis_path[MAX_PATH];
+    int header[5];   /* estado, muestras, estado de cache, sample rate, canales */
+    int status = 0, n_samples = 0, cache_state = CACHE_MISS;
+    int n_frames, n_bins, local_frames = 0, frames_chunked = 0, channels = 1;
+    float *samples, *mag_local = NULL, *mag_temp = NULL, *mag_global = NULL;
+    float *spec_re = NULL, *spec_im = NULL, *gain = NULL;
+    float* channel_mag[2] = { NULL, NULL };
+    int first_frame = 0, band;
+    /* Con el almacén solo las salidas extra (tempograma, pirámide, ...) usan results/<track>/ */
+    int track_dir = cfg.store_dir[0] == '\0' || cfg.tempogram || cfg.pyramid_levels > 0 ||
+                    cfg.resynth || cfg.modulation || cfg.cqt || cfg.stereo != STEREO_OFF;
+    AnalysisResults* cached_analysis = NULL;
+    Pyramid* pyramid = NULL;
+    AnalysisResults analysis;
+    double t_start, t_read = 0.0, t_start_stft = 0.0, t_stft = 0.0;
+    double t_start_write_spec, t_write_spec = 0.0, t_istft = 0.0, t_cqt = 0.0;
+
+    t_start = MPI_Wtime();
+
+    /* Los buffers de la corrida anterior ya no hacen falta: la arena vuelve a empezar */
+    arena_reset(analyzer->arena);
+    profile_reset(analyzer->profile);
+
+    /* 1. Rank 0 lee el archivo y busca en la cache */
+    if (rank == 0) {
+        if (build_results_dir(path, results_dir) != 0) {
+            fprintf(stderr, "Error: ruta de audio inválida (%s)\n", path);
+            status = -1;
+        }
+
+        if (status == 0) {
+            /* Creamos el directorio (y results/ si hace falta; ignoramos si ya existe) */
+            if (track_dir) {
+                make_dirs(results_dir);
+            }
+
+            if ((cfg.stereo != STEREO_OFF ?
+                 wav_read_channels(path, &analyzer->wav, cfg.stereo == STEREO_MS) :
+                 wav_read_reuse(path, &analyzer->wav)) == -1) {
+                printf("Error en la lectura del archivo de audio\n");
+                status = -1;
+            }
+        }
+        t_read = MPI_Wtime() - t_start;
+
+        if (status == 0) {
+            cfg.fs = analyzer->wav.samplerate;
+            n_samples = analyzer->wav.n_samples;
+
+            /* La banda en bins depende del sample rate del archivo */
+            band = config_resolve_band(&cfg);
+            if (band < 0) {
+                fprintf(stderr, "Error: la banda pedida (desde %.1f Hz) queda arriba de Nyquist (%.1f Hz)\n",
+                        cfg.band_lo_hz, cfg.fs / 2.0f);
+                status = -1;
+            } else if (band > 0) {
+                printf("\nBanda limitada: %.1f - %.1f Hz -> bins %d..%d (%s)\n",
+                       (float)cfg.bin_lo * cfg.fs / cfg.N, (float)cfg.bin_hi * cfg.fs / cfg.N,
+                       cfg.bin_lo, cfg.bin_hi,
+                       band_method_name(band_choose_method(cfg.N, cfg.bin_lo, cfg.bin_hi)));
+            }
+
+            if (status == 0 && STFT_NFRAMES(n_samples, cfg.N, cfg.hop) <= 0) {
+                fprintf(stderr, "Error: el audio es más corto que una ventana (%d muestras, N=%d)\n",
+                        n_samples, cfg.N);
+                status = -1;
+            }
+        }
+
+        /* La CQT necesita al menos una octava entre f_min y el límite de la decimación */
+        if (status == 0 && cfg.cqt && cqt_octaves(cfg.fs, cfg.cqt_f_min) < 1) {
+            fprintf(stderr, "Error: la frecuencia minima de la CQT (%.2f Hz) es muy alta para %d Hz\n",
+                    cfg.cqt_f_min, cfg.fs);
+            status = -1;
+        }
+
+        /* Máscara de ganancia para la resíntesis (depende del sample rate) */
+        if (status == 0 && cfg.gain_mask[0] != '\0') {
+            gain = arena_floats(analyzer, (size_t)STFT_NBINS(cfg.N), 1, "gain");
+            if (load_gain_mask(cfg.gain_mask, cfg.N, cfg.fs, gain) != 0) {
+                status = -1;
+            }
+        }
+
+        /* Buscamos si este audio ya fue analizado con los mismos parámetros
+           (la resíntesis necesita los frames complejos, y la CQT y el análisis por canal las
+           muestras: siempre se recalcula el STFT) */
+        if (status == 0 && cfg.use_cache) {
+            cache_make_key(&cache_key, analyzer->wav.data_hash, n_samples, &cfg);
+            cache_state = (cfg.resynth || cfg.cqt || cfg.stereo != STEREO_OFF) ? CACHE_MISS : cache_lookup(results_dir, &cache_key);
+
+            if (cache_state == CACHE_HIT_FULL) {
+                printf("\nCache: resultados previos reutilizados (sin recalcular STFT ni BPM)\n");
+            } else if (cache_state == CACHE_HIT_SPECTROGRAM) {
+                printf("\nCache: espectrograma reutilizado, se recalcula el BPM\n");
+            }
+        }
+
+        header[0] = status;
+        header[1] = n_samples;
+        header[2] = cache_state;
+        header[3] = cfg.fs;
+        header[4] = analyzer->wav.channels;
+        t_start_stft = MPI_Wtime();
+    }
+
+    /* 2. Todos acuerdan si se sigue y con qué parámetros */
+    MPI_Bcast(header, 5, MPI_INT, 0, comm);
+    if (header[0] != 0) {
+        return -1;
+    }
+    n_samples = header[1];
+    cache_state = header[2];
+    cfg.fs = header[3];
+    channels = header[4];
+    config_resolve_band(&cfg);
+
+    /* Calcular parámetros del STFT (con banda limitada solo viajan sus bins) */
+    n_frames = STFT_NFRAMES(n_samples, cfg.N, cfg.hop);
+    n_bins = cfg.bin_hi - cfg.bin_lo + 1;
+
+    /* Todos reciben la máscara de ganancia */
+    if (cfg.gain_mask[0] != '\0') {
+        if (rank != 0) {
+            gain = arena_floats(analyzer, (size_t)STFT_NBINS(cfg.N), 1, "gain");
+        }
+        MPI_Bcast(gain, STFT_NBINS(cfg.N), MPI_FLOAT, 0, comm);
+    }
+
+    /* 3. Si el espectrograma está en cache, ningún proceso necesita las muestras ni el STFT */
+    if (cache_state == CACHE_MISS) {
+        Config stft_cfg = cfg;
+        StftWorkspace* ws;
+
+        /* La resíntesis y el par de canales necesitan el espectro completo aunque se guarde
+           solo la banda */
+        if (cfg.resynth || cfg.stereo != STEREO_OFF) {
+            stft_cfg.bin_lo = 0;
+            stft_cfg.bin_hi = STFT_NBINS(cfg.N) - 1;
+        }
+        ws = analyzer_workspace(analyzer, &stft_cfg);
+
+        /* Rank 0 difunde directamente desde el buffer del WAV */
+        if (rank == 0) {
+            samples = analyzer->wav.samples;
+            mag_global = arena_floats(analyzer, (size_t)n_frames * n_bins, 1, "mag_global");
+            mag_temp = arena_floats(analyzer, (size_t)n_frames * n_bins, 1, "mag_temp");
+        } else {
+            samples = arena_floats(analyzer, (size_t)n_samples, 1, "samples");
+        }
+
+        /* Con dos canales o menos la mezcla mono sale del par: solo viaja si la CQT o más
+           canales la necesitan */
+        if (cfg.stereo == STEREO_OFF || channels > 2 || cfg.cqt) {
+            MPI_Bcast(samples, n_samples, MPI_FLOAT, 0, comm);
+        }
+
+        if (cfg.resynth) {
+            /* Bloques contiguos con los frames complejos: después cada proceso resintetiza
+               su tramo y solo intercambia el solapamiento con el vecino */
+            int n_full = STFT_NBINS(cfg.N);
+            int block = istft_block_frames(n_frames, analyzer->procs_number, cfg.N, cfg.hop,
+                                           cfg.pyramid_levels > 0 ? PYRAMID_ALIGN(cfg.pyramid_levels) : 1);
+
+            first_frame = rank * block;
+            local_frames = (first_frame >= n_frames) ? 0 :
+                           (first_frame + block <= n_frames ? block : n_frames - first_frame);
+            spec_re = arena_floats(analyzer, (size_t)local_frames * n_full, 1, "spec_re");
+            spec_im = arena_floats(analyzer, (size_t)local_frames * n_full, 1, "spec_im");
+            mag_local = arena_floats(analyzer, (size_t)local_frames * n_bins, 1, "mag_local");
+
+            profile_begin(analyzer->profile);
+            if (stft_compute_complex(ws, samples, first_frame, local_frames, spec_re, spec_im,
+                                     &analyzer->chunks) != 0) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para los bloques del STFT\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            stft_magnitudes(spec_re, spec_im, local_frames, n_full, cfg.bin_lo, n_bins, mag_local);
+            profile_end(analyzer->profile, PROFILE_STFT, local_frames, stft_flops(&cfg, local_frames));
+            frames_chunked = 1;
+
+            gather_chunked_spectrogram(mag_local, local_frames, &analyzer->chunks, n_frames, n_bins,
+                                       comm, mag_temp, mag_global);
+        } else if (cfg.stereo != STEREO_OFF) {
+            /* Dos canales en una sola FFT compleja; la mezcla mono sale de los mismos
+               espectros, así que cuesta lo mismo que el STFT mono (distribución cíclica) */
+            float *pair[2], *channel_local[2];
+            int c;
+
+            local_frames = calculate_local_frames(rank, n_frames, analyzer->procs_number);
+            mag_local = arena_floats(analyzer, (size_t)local_frames * n_bins, 1, "mag_local");
+            for (c = 0; c < 2; c++) {
+                pair[c] = (rank == 0) ? analyzer->wav.channel[c] :
+                          arena_floats(analyzer, (size_t)n_samples, 1, "channel");
+                MPI_Bcast(pair[c], n_samples, MPI_FLOAT, 0, comm);
+                channel_local[c] = arena_floats(analyzer, (size_t)local_frames * n_bins, 1, "channel_local");
+                if (rank == 0) {
+                    channel_mag[c] = arena_floats(analyzer, (size_t)n_frames * n_bins, 1, "channel_mag");
+                }
+            }
+
+            profile_begin(analyzer->profile);
+            if (stft_compute_pair_cyclic(ws, pair[0], pair[1], channels > 2 ? samples : NULL, rank,
+                                         analyzer->procs_number, n_frames, cfg.bin_lo, n_bins,
+                                         cfg.stereo, mag_local, channel_local[0], channel_local[1]) != 0) {
+                fprintf(stderr, "Error: el STFT por canal requiere el espectro completo\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            profile_end(analyzer->profile, PROFILE_STFT, local_frames,
+                        stft_flops(&cfg, channels > 2 ? 2 * local_frames : local_frames));
+
+            gather_spectrogram_into(mag_local, local_frames, n_frames, n_bins, comm, mag_temp, mag_global);
+            for (c = 0; c < 2; c++) {
+                gather_spectrogram_into(channel_local[c], local_frames, n_frames, n_bins, comm,
+                                        mag_temp, channel_mag[c]);
+            }
+        } else if (cfg.schedule == SCHED_DYNAMIC) {
+            /* Computar STFT reclamando bloques del contador compartido. No se sabe de antemano
+               cuántos frames tocan: el destino crece con cada bloque reclamado */
+            profile_begin(analyzer->profile);
+            if (compute_stft_dynamic(ws, samples, n_frames, n_bins, cfg.chunk_min,
+                                     cfg.pyramid_levels > 0 ? PYRAMID_ALIGN(cfg.pyramid_levels) : 1,
+                                     comm, &analyzer->dynamic_mag, &local_frames, &analyzer->chunks) != 0) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para los bloques del STFT\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            profile_end(analyzer->profile, PROFILE_STFT, local_frames, stft_flops(&cfg, local_frames));
+            mag_local = (float*)analyzer->dynamic_mag.data;
+            if ((size_t)local_frames * n_bins * sizeof(float) > analyzer->dynamic_peak) {
+                analyzer->dynamic_peak = (size_t)local_frames * n_bins * sizeof(float);
+            }
+            frames_chunked = 1;
+
+            /* Recolectar y ubicar cada bloque en su posición temporal */
+            gather_dynamic_spectrogram(mag_local, local_frames, &analyzer->chunks, n_frames, n_bins,
+                                       comm, mag_temp, mag_global);
+        } else if (cfg.pyramid_levels > 0 || cfg.schedule == SCHED_BLOCK) {
+            /* La pirámide reduce frames consecutivos: bloques en vez de frames sueltos
+               (con --schedule block, del tamaño pedido redondeado a lo que pide la pirámide) */
+            int block = pyramid_block_frames(cfg.pyramid_levels);
+
+            if (cfg.schedule == SCHED_BLOCK) {
+                int align = PYRAMID_ALIGN(cfg.pyramid_levels);
+                block = ((cfg.block_frames + align - 1) / align) * align;
+            }
+
+            local_frames = calculate_block_frames(rank, n_frames, analyzer->procs_number, block);
+            mag_local = arena_floats(analyzer, (size_t)local_frames * n_bins, 1, "mag_local");
+            profile_begin(analyzer->profile);
+            if (stft_compute_blocks(ws, samples, rank, analyzer->procs_number, n_frames, n_bins,
+                                    block, mag_local, &analyzer->chunks) != 0) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para los bloques del STFT\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            profile_end(analyzer->profile, PROFILE_STFT, local_frames, stft_flops(&cfg, local_frames));
+            frames_chunked = 1;
+
+            gather_chunked_spectrogram(mag_local, local_frames, &analyzer->chunks, n_frames, n_bins,
+                                       comm, mag_temp, mag_global);
+        } else {
+            local_frames = calculate_local_frames(rank, n_frames, analyzer->procs_number);
+            mag_local = arena_floats(analyzer, (size_t)local_frames * n_bins, 1, "mag_local");
+
+            /* Computar STFT local */
+            profile_begin(analyzer->profile);
+            stft_compute_cyclic(ws, samples, rank, analyzer->procs_number, n_frames, n_bins, mag_local);
+            profile_end(analyzer->profile, PROFILE_STFT, local_frames, stft_flops(&cfg, local_frames));
+
+            /* Recolectar y reordenar resultados */
+            gather_spectrogram_into(mag_local, local_frames, n_frames, n_bins, comm,
+                                    mag_temp, mag_global);
+        }
+
+        /* Cada proceso reduce sus bloques antes de mandarlos: rank 0 recibe los niveles armados
+           (el análisis por canal usa la distribución cíclica: rank 0 la arma después) */
+        if (cfg.pyramid_levels > 0 && cfg.stereo == STEREO_OFF) {
+            pyramid = compute_pyramid_parallel(mag_local, &analyzer->chunks, n_frames, n_bins,
+                                               cfg.pyramid_levels, comm);
+        }
+
+        /* Guardamos el espectrograma para las próximas corridas */
+        if (rank == 0 && cfg.use_cache) {
+            cache_store_spectrogram(results_dir, &cache_key, mag_global, n_frames, n_bins);
+        }
+
+        /* CQT: mismos frames y misma distribución cíclica que el STFT, rank 0 escribe el CSV */
+        if (cfg.cqt) {
+            CqtKernel* kernel = analyzer_cqt(analyzer, &cfg);
+            int n_cq = cqt_n_bins(kernel);
+            int cq_frames = calculate_local_frames(rank, n_frames, analyzer->procs_number);
+            float* cq_local = arena_floats(analyzer, (size_t)cq_frames * n_cq, 1, "cq_local");
+            float *cq_temp = NULL, *cq_global = NULL;
+            double t_start_cqt = MPI_Wtime();
+
+            if (rank == 0) {
+                cq_temp = arena_floats(analyzer, (size_t)n_frames * n_cq, 1, "cq_temp");
+                cq_global = arena_floats(analyzer, (size_t)n_frames * n_cq, 1, "cq_global");
+            }
+            if (cqt_compute_cyclic(kernel, samples, n_samples, rank, analyzer->procs_number,
+                                   n_frames, &cfg, cq_local) != 0) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para la CQT\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            gather_spectrogram_into(cq_local, cq_frames, n_frames, n_cq, comm, cq_temp, cq_global);
+
+            if (rank == 0) {
+                char cqt_path[MAX_PATH + 16];
+
+                sprintf(cqt_path, "%s/cqt.csv", results_dir);
+                t_cqt = MPI_Wtime() - t_start_cqt;
+                printf("Tiempo de CQT (%d bins, %.2f - %.2f Hz): %f segundos\n", n_cq,
+                       cqt_bin_frequency(kernel, 0), cqt_bin_frequency(kernel, n_cq - 1), t_cqt);
+                if (write_cqt_csv(cqt_path, cq_global, n_frames, kernel) != 0) {
+                    status = -1;
+                } else {
+                    printf("CQT guardada en %s\n", cqt_path);
+                }
+            }
+        }
+
+        /* Resíntesis: ISTFT con overlap-add repartida, rank 0 escribe el WAV */
+        if (cfg.resynth) {
+            float* output = NULL;
+            double t_start_istft = MPI_Wtime();
+
+            if (rank == 0) {
+                output = arena_floats(analyzer, (size_t)n_samples, 1, "output");
+            }
+            istft_overlap_add(spec_re, spec_im, first_frame, local_frames, n_frames, n_samples,
+                              gain, &cfg, comm, output);
+
+            if (rank == 0) {
+                char resynth_path[MAX_PATH + 16];
+
+                sprintf(resynth_path, "%s/resynth.wav", results_dir);
+                t_istft = MPI_Wtime() - t_start_istft;
+                printf("Tiempo de ISTFT (overlap-add distribuido): %f segundos\n", t_istft);
+                if (wav_write_float(resynth_path, output, n_samples, cfg.fs) != 0) {
+                    status = -1;
+                } else {
+                    printf("Audio resintetizado%s guardado en %s\n",
+                           gain ? " (con mascara de ganancia)" : "", resynth_path);
+                }
+            }
+        }
+    }
+
+    /* 4. CSV y análisis de BPM (solo en rank 0) */
+    if (rank == 0) {
+        int write_spectrogram;
+
+        t_stft = MPI_Wtime() - t_start_stft - t_istft - t_cqt;
+        printf("Tiempo de computo STFT: %f segundos\n", t_stft);
+
+        t_start_write_spec = MPI_Wtime();
+
+        sprintf(spectrogram_path, "%s/spectrogram.csv", results_dir);
+        sprintf(analysis_path, "%s/analysis_results.csv", results_dir);
+
+        /* Con acierto completo solo hace falta leer BPM y flux guardados */
+        if (cache_state == CACHE_HIT_FULL) {
+            cached_analysis = cache_load_analysis(results_dir, &cache_key);
+        }
+
+        /* El CSV del espectrograma solo se reescribe si cambió o si alguien lo borró
+           (con el almacén no hay CSV por track) */
+        write_spectrogram = cfg.store_dir[0] == '\0' &&
+                            ((cache_state == CACHE_MISS) || !file_exists(spectrogram_path));
+
+        /* Traemos el espectrograma guardado si hace falta (para el CSV o para el BPM) */
+        if (!mag_global && (write_spectrogram || !cached_analysis || cfg.pyramid_levels > 0 ||
+                            cfg.modulation)) {
+            float* loaded = cache_load_spectrogram(results_dir, &cache_key, n_frames, n_bins);
+
+            mag_global = arena_floats(analyzer, (size_t)n_frames * n_bins, 1, "mag_global");
+            if (loaded) {
+                memcpy(mag_global, loaded, (size_t)n_frames * n_bins * sizeof(float));
+                free(loaded);
+            } else {
+                /* Cache ilegible: rank 0 calcula el STFT completo por su cuenta */
+                fprintf(stderr, "Advertencia: cache ilegible, se recalcula el STFT en rank 0\n");
+                stft_compute_cyclic(analyzer_workspace(analyzer, &cfg), analyzer->wav.samples,
+                                    0, 1, n_frames, n_bins, mag_global);
+                write_spectrogram = 1;
+                if (cfg.use_cache) {
+                    cache_store_spectrogram(results_dir, &cache_key, mag_global, n_frames, n_bins);
+                }
+            }
+        }
+
+        if (write_spectrogram) {
+            printf("\nEspectrograma global recibido (%d ventanas x %d bins)\n", n_frames, n_bins);
+
+            if (write_spectrogram_csv(spectrogram_path, mag_global, n_frames, n_bins) != 0) {
+                status = -1;
+            } else {
+                printf("\nArchivo CSV guardado en %s\n", spectrogram_path);
+            }
+        }
+
+        /* Análisis por canal: un espectrograma por canal y su flux */
+        if (status == 0 && channel_mag[0]) {
+            float* flux[2];
+            char channel_path[MAX_PATH + 32];
+            int c;
+
+            for (c = 0; c < 2 && status == 0; c++) {
+                sprintf(channel_path, "%s/spectrogram_%s.csv", results_dir, channel_name(cfg.stereo, c));
+                if (write_spectrogram_csv(channel_path, channel_mag[c], n_frames, n_bins) != 0) {
+                    status = -1;
+                }
+                flux[c] = arena_floats(analyzer, (size_t)n_frames, 1, "channel_flux");
+                calculate_spectral_flux(channel_mag[c], n_frames, n_bins, flux[c]);
+            }
+
+            sprintf(channel_path, "%s/channels.csv", results_dir);
+            if (status == 0 && write_channel_flux_csv(channel_path, flux, n_frames, &cfg) == 0) {
+                printf("Espectrogramas por canal (%s/%s) y flux guardados en %s\n",
+                       channel_name(cfg.stereo, 0), channel_name(cfg.stereo, 1), results_dir);
+            } else {
+                status = -1;
+            }
+        }
+
+        /* Pirámide para visualizar (desde la cache se arma acá, en rank 0) */
+        if (status == 0 && cfg.pyramid_levels > 0) {
+            if (!pyramid) {
+                pyramid = compute_pyramid(mag_global, n_frames, n_bins, cfg.pyramid_levels);
+            }
+            if (!pyramid || write_pyramid(results_dir, pyramid, mag_global, &cfg) != 0) {
+                fprintf(stderr, "Error: no se pudo escribir la piramide en %s/pyramid\n", results_dir);
+                status = -1;
+            } else {
+                printf("Piramide de %d niveles (hasta %dx) guardada en %s/pyramid\n",
+                       cfg.pyramid_levels, 1 << cfg.pyramid_levels, results_dir);
+            }
+            free_pyramid(pyramid);
+        }
+
+        t_write_spec = MPI_Wtime() - t_start_write_spec;
+
+        /* Calcular BPM y características (salvo que vengan de la cache) */
+        if (status == 0) {
+            if (cached_analysis) {
+                analysis = *cached_analysis;
+                if (!file_exists(analysis_path)) {
+                    write_results_to_csv(analysis_path, &analysis, &cfg);
+                }
+            } else {
+                float* acf = arena_floats(analyzer, (size_t)n_frames, 1, "acf");
+
+                analysis.num_frames = n_frames;
+                analysis.onset_flux_curve = arena_floats(analyzer, (size_t)n_frames, 1, "flux");
+                /* FLOPs: flux (resta y suma por bin) + autocorrelación completa (n^2 / 2 productos y sumas) */
+                profile_begin(analyzer->profile);
+                analysis.bpm_estimado = analyze_bpm_into(mag_global, n_frames, n_bins, &cfg,
+                                                         analysis.onset_flux_curve, acf);
+                profile_end(analyzer->profile, PROFILE_BPM, n_frames,
+                            2.0 * n_frames * n_bins + (double)n_frames * n_frames);
+                if (cfg.store_dir[0] != '\0') {
+                    StoreRecord record;
+
+                    memset(&record, 0, sizeof(record));
+                    record.sample_rate = cfg.fs;
+                    record.hop = cfg.hop;
+                    record.duration_s = (float)n_samples / cfg.fs;
+                    record.bpm = analysis.bpm_estimado;
+                    record.confidence = bpm_confidence(analysis.onset_flux_curve, n_frames,
+                                                       analysis.bpm_estimado, &cfg);
+                    if (store_append(cfg.store_dir, path, &record, analysis.onset_flux_curve, n_frames) != 0) {
+                        status = -1;
+                    } else {
+                        printf("\nResultado agregado al almacen %s (confianza %.2f)\n",
+                               cfg.store_dir, record.confidence);
+                    }
+                } else {
+                    write_results_to_csv(analysis_path, &analysis, &cfg);
+                }
+
+                if (cfg.use_cache) {
+                    cache_store_analysis(results_dir, &cache_key, &analysis);
+                }
+            }
+
+            printf("\nBPM de la cancion: %.2f\n", analysis.bpm_estimado);
+        }
+    }
+
+    /* 5. Si rank 0 no pudo escribir, nadie sigue con el tempograma */
+    MPI_Bcast(&status, 1, MPI_INT, 0, comm);
+
+    /* Tempograma: BPM por ventana, con las ventanas repartidas entre todos los procesos */
+    if (status == 0 && cfg.tempogram) {
+        Tempogram* tempogram;
+
+        tempogram = compute_tempogram_parallel(rank == 0 ? analysis.onset_flux_curve : NULL,
+                                               n_frames, &cfg, comm);
+        if (rank == 0) {
+            char tempogram_path[MAX_PATH];
+            sprintf(tempogram_path, "%s/tempogram.csv", results_dir);
+            write_tempogram_csv(tempogram_path, tempogram, &cfg);
+            free_tempogram(tempogram);
+        }
+    }
+
+    /* Espectro de modulación: el espectrograma se transpone a bins repartidos entre procesos
+       (desde la cache, rank 0 tiene todos los frames y los demás ninguno). n_frames es el
+       mismo en todos los procesos: todos saltean juntos la transpuesta colectiva */
+    if (status == 0 && cfg.modulation && n_frames < MODULATION_MIN_FRAMES && rank == 0) {
+        fprintf(stderr, "Advertencia: el espectro de modulacion requiere al menos %d frames (hay %d), se omite\n",
+                MODULATION_MIN_FRAMES, n_frames);
+    }
+    if (status == 0 && cfg.modulation && n_frames >= MODULATION_MIN_FRAMES) {
+        ModulationSpectrum* spectrum;
+        double t_start_mod = MPI_Wtime();
+        int my_bins = transpose_bin_first(rank + 1, n_bins, analyzer->procs_number) -
+                      transpose_bin_first(rank, n_bins, analyzer->procs_number);
+        float* series = arena_floats(analyzer, (size_t)my_bins * n_frames + 1, 1, "series");
+        int* frame_index;
+
+        if (cache_state != CACHE_MISS) {
+            mag_local = rank == 0 ? mag_global : NULL;
+            local_frames = rank == 0 ? n_frames : 0;
+            frames_chunked = 0;
+        }
+        frame_index = cache_state == CACHE_MISS ?
+                      local_frame_index(analyzer, frames_chunked, local_frames, rank, analyzer->procs_number) :
+                      local_frame_index(analyzer, 0, local_frames, 0, 1);
+
+        transpose_frames_to_bins(mag_local, frame_index, local_frames, n_frames, n_bins, comm, series);
+        spectrum = compute_modulation_parallel(series, my_bins, n_bins, n_frames, &cfg, comm);
+
+        if (rank == 0) {
+            char modulation_path[MAX_PATH + 16];
+
+            sprintf(modulation_path, "%s/modulation.csv", results_dir);
+            printf("Tiempo del espectro de modulacion (transpuesta + FFT por bin): %f segundos\n",
+                   MPI_Wtime() - t_start_mod);
+            if (write_modulation_csv(modulation_path, spectrum, &cfg) == 0) {
+                printf("Espectro de modulacion guardado en %s\n", modulation_path);
+            }
+            free_modulation_spectrum(spectrum);
+        }
+    }
+
+    /* Contadores de hardware de la corrida, reducidos entre todos los procesos */
+    if (analyzer->profile) {
+        profile_report(analyzer->profile, comm);
+    }
+
+    if (rank == 0) {
+        if (report && status == 0) {
+            strcpy(report->results_dir, results_dir);
+            report->bpm = analysis.bpm_estimado;
+            report->n_frames = n_frames;
+            report->n_bins = n_bins;
+            report->sample_rate = cfg.fs;
+            report->cache_state = cache_state;
+            report->t_read = t_read;
+            report->t_stft = t_stft;
+            report->t_write_spec = t_write_spec;
+            report->t_total = MPI_Wtime() - t_start;
+        }
+        free_analysis_results(cached_analysis);
+    }
+
+    return status;
+}
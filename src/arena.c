@@ -0,0 +1,181 @@
+/* MAP_ANONYMOUS, MAP_HUGETLB y madvise no son parte de C89 */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+/* Trozo de memoria obtenido con mmap; el encabezado vive al comienzo del propio trozo */
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;  /* trozo anterior (el actual es el primero de la lista) */
+    size_t size;              /* bytes mapeados (incluye el encabezado) */
+    size_t used;              /* bytes entregados (desde el comienzo del trozo) */
+    int huge;                 /* 1 si está respaldado por páginas enormes */
+} ArenaChunk;
+
+struct Arena {
+    ArenaChunk* head;
+    int flags;
+    size_t used;        /* bytes entregados desde el último reset */
+    size_t peak;
+    size_t huge_bytes;
+};
+
+/* Los datos empiezan alineados: el encabezado ocupa una línea de cache completa */
+#define CHUNK_HEADER (((sizeof(ArenaChunk) + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN)
+
+/* Trozo mínimo para no hacer un mmap por cada bloque chico */
+#define ARENA_MIN_CHUNK ((size_t)64 * 1024)
+
+static size_t round_up(size_t value, size_t multiple) {
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+static ArenaChunk* chunk_map(Arena* arena, size_t bytes) {
+    ArenaChunk* chunk;
+    void* mem = MAP_FAILED;
+    size_t size = round_up(bytes + CHUNK_HEADER, 4096);
+    int huge = 0;
+
+    if (size < ARENA_MIN_CHUNK) size = ARENA_MIN_CHUNK;
+
+    if ((arena->flags & ARENA_HUGE_PAGES) && size >= ARENA_HUGE_PAGE_SIZE) {
+        size = round_up(size, ARENA_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+        /* Páginas enormes reservadas por el administrador (vm.nr_hugepages) */
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge = mem != MAP_FAILED;
+#endif
+    }
+
+    if (mem == MAP_FAILED) {
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        /* Sin páginas reservadas: pedimos páginas enormes transparentes */
+        if ((arena->flags & ARENA_HUGE_PAGES) && size >= ARENA_HUGE_PAGE_SIZE) {
+            huge = madvise(mem, size, MADV_HUGEPAGE) == 0;
+        }
+#endif
+    }
+
+    chunk = (ArenaChunk*)mem;
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = CHUNK_HEADER;
+    chunk->huge = huge;
+    if (huge) {
+        arena->huge_bytes += size;
+    }
+    return chunk;
+}
+
+static void chunk_unmap(Arena* arena, ArenaChunk* chunk) {
+    if (chunk->huge) {
+        arena->huge_bytes -= chunk->size;
+    }
+    munmap(chunk, chunk->size);
+}
+
+Arena* arena_create(size_t initial_bytes, int flags) {
+    Arena* arena = malloc(sizeof(Arena));
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->head = NULL;
+    arena->flags = flags;
+    arena->used = 0;
+    arena->peak = 0;
+    arena->huge_bytes = 0;
+
+    if (initial_bytes > 0) {
+        arena->head = chunk_map(arena, initial_bytes);
+        if (!arena->head) {
+            free(arena);
+            return NULL;
+        }
+    }
+    return arena;
+}
+
+void* arena_alloc(Arena* arena, size_t bytes) {
+    ArenaChunk* chunk = arena->head;
+    size_t offset;
+
+    bytes = round_up(bytes > 0 ? bytes : 1, ARENA_ALIGN);
+
+    /* Si no entra en el trozo actual se abre otro (al menos el doble del anterior) */
+    if (!chunk || chunk->used + bytes > chunk->size) {
+        size_t want = bytes;
+        if (chunk && want < 2 * chunk->size) want = 2 * chunk->size;
+
+        chunk = chunk_map(arena, want);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+
+    offset = chunk->used;
+    chunk->used += bytes;
+    arena->used += bytes;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+    return (char*)chunk + offset;
+}
+
+void arena_reset(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    size_t total = 0;
+
+    if (!chunk) {
+        return;
+    }
+
+    /* Un solo trozo: basta con volver al comienzo (las páginas ya tocadas se reusan) */
+    if (!chunk->next) {
+        chunk->used = CHUNK_HEADER;
+        arena->used = 0;
+        return;
+    }
+
+    /* Varios trozos: se unifican para que la próxima vez todo entre en uno */
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        total += chunk->size - CHUNK_HEADER;
+        chunk_unmap(arena, chunk);
+        chunk = next;
+    }
+    arena->head = chunk_map(arena, total);
+    arena->used = 0;
+}
+
+void arena_destroy(Arena* arena) {
+    ArenaChunk* chunk;
+
+    if (!arena) return;
+    chunk = arena->head;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        chunk_unmap(arena, chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
+size_t arena_used(const Arena* arena) {
+    return arena->used;
+}
+
+size_t arena_peak(const Arena* arena) {
+    return arena->peak;
+}
+
+size_t arena_huge_bytes(const Arena* arena) {
+    return arena->huge_bytes;
+}
@@ -0,0 +1,335 @@
+/* src/autotune.c */
+#include "autotune.h"
+#include "stft.h"
+#include "fft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+/* Frames de la señal sintética con la que se miden las distribuciones */
+#define AUTOTUNE_FRAMES 512
+
+/* FFTs por medición de cada kernel */
+#define AUTOTUNE_FFTS 64
+
+/* Repeticiones de cada medición (se queda la mejor: la menos afectada por ruido) */
+#define AUTOTUNE_REPEATS 3
+
+/* Largo máximo de una línea del archivo wisdom */
+#define WISDOM_LINE 512
+
+static const char* kernel_names[] = { "radix4", "radix2", "inplace" };
+static const char* schedule_names[] = { "cyclic", "dynamic", "block" };
+
+/* Distribuciones candidatas: tipo y tamaño de bloque (block) o chunk mínimo (dynamic) */
+static const struct {
+    sched_t schedule;
+    int size;
+} layouts[] = {
+    { SCHED_CYCLIC, 0 },
+    { SCHED_BLOCK, 8 },
+    { SCHED_BLOCK, 32 },
+    { SCHED_BLOCK, 128 },
+    { SCHED_DYNAMIC, 4 },
+    { SCHED_DYNAMIC, 16 }
+};
+
+#define N_KERNELS ((int)(sizeof(kernel_names) / sizeof(kernel_names[0])))
+#define N_LAYOUTS ((int)(sizeof(layouts) / sizeof(layouts[0])))
+
+void autotune_cpu_model(char* model, size_t size) {
+    char line[WISDOM_LINE];
+    FILE* f = fopen("/proc/cpuinfo", "r");
+
+    strncpy(model, "desconocido", size - 1);
+    model[size - 1] = '\0';
+    if (!f) return;
+
+    while (fgets(line, sizeof(line), f)) {
+        /* x86: "model name"; ARM y otros: "Processor" o "cpu model" */
+        if (strncmp(line, "model name", 10) == 0 || strncmp(line, "Processor", 9) == 0 ||
+            strncmp(line, "cpu model", 9) == 0) {
+            char* value = strchr(line, ':');
+            char* p;
+
+            if (!value) continue;
+            value++;
+            while (*value == ' ' || *value == '\t') value++;
+            value[strcspn(value, "\n")] = '\0';
+
+            /* El ';' separa los campos del archivo wisdom */
+            for (p = value; *p; p++) {
+                if (*p == ';') *p = ',';
+            }
+            strncpy(model, value, size - 1);
+            model[size - 1] = '\0';
+            break;
+        }
+    }
+    fclose(f);
+}
+
+static int name_index(const char* name, const char* const* names, int count) {
+    int i;
+    for (i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * Busca la entrada "cpu;N;hop;procesos;kernel;distribucion;bloque;chunk" de esta máquina
+ * y parámetros (la última, si hay varias).
+ * @return 0 si la encontró, -1 si no
+ */
+static int wisdom_load(const char* path, const char* cpu, const Config* cfg, int procs_number,
+                       TuneChoice* choice) {
+    char line[WISDOM_LINE];
+    FILE* f = fopen(path, "r");
+    int found = -1;
+
+    if (!f) return -1;
+
+    while (fgets(line, sizeof(line), f)) {
+        char* fields[8];
+        char* p = line;
+        int n = 0, kernel, schedule;
+
+        line[strcspn(line, "\n")] = '\0';
+        while (n < 8) {
+            fields[n++] = p;
+            p = strchr(p, ';');
+            if (!p) break;
+            *p++ = '\0';
+        }
+        if (n != 8 || strcmp(fields[0], cpu) != 0 || atoi(fields[1]) != cfg->N ||
+            atoi(fields[2]) != cfg->hop || atoi(fields[3]) != procs_number) {
+            continue;
+        }
+
+        kernel = name_index(fields[4], kernel_names, N_KERNELS);
+        schedule = name_index(fields[5], schedule_names, 3);
+        if (kernel < 0 || schedule < 0 || atoi(fields[6]) < 1 || atoi(fields[7]) < 1) {
+            continue;
+        }
+        choice->fft_kernel = (fft_kernel_t)kernel;
+        choice->schedule = (sched_t)schedule;
+        choice->block_frames = atoi(fields[6]);
+        choice->chunk_min = atoi(fields[7]);
+        found = 0;
+    }
+
+    fclose(f);
+    return found;
+}
+
+/* Agrega la entrada de esta máquina y parámetros al final del archivo */
+static int wisdom_save(const char* path, const char* cpu, const Config* cfg, int procs_number,
+                       const TuneChoice* choice) {
+    FILE* f = fopen(path, "a");
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "%s;%d;%d;%d;%s;%s;%d;%d\n", cpu, cfg->N, cfg->hop, procs_number,
+            kernel_names[choice->fft_kernel], schedule_names[choice->schedule],
+            choice->block_frames, choice->chunk_min);
+    fclose(f);
+    return 0;
+}
+
+/* Señal sintética (ruido pseudoaleatorio, igual en todos los procesos) */
+static void fill_noise(float* signal, size_t n) {
+    unsigned long state = 12345;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        state = state * 1103515245UL + 12345UL;
+        signal[i] = (float)((state >> 16) & 0x7fff) / 16384.0f - 1.0f;
+    }
+}
+
+/* Mejor tiempo local de AUTOTUNE_FFTS transformadas con un kernel */
+static double time_kernel(fft_kernel_t kernel, const float* signal, int N, int hop,
+                          float* re, float* im) {
+    FFTPlan* plan = fft_plan_create_kernel(N, kernel);
+    double best = -1.0;
+    int rep, i, k;
+
+    if (!plan) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para el autotuner\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (rep = 0; rep < AUTOTUNE_REPEATS; rep++) {
+        double t = MPI_Wtime();
+        for (i = 0; i < AUTOTUNE_FFTS; i++) {
+            const float* frame = signal + (size_t)(i % AUTOTUNE_FRAMES) * hop;
+            for (k = 0; k < N; k++) {
+                re[k] = frame[k];
+                im[k] = 0.0f;
+            }
+            fft_execute(plan, re, im);
+        }
+        t = MPI_Wtime() - t;
+        if (best < 0.0 || t < best) best = t;
+    }
+
+    fft_plan_destroy(plan);
+    return best;
+}
+
+/* Tiempo de una distribución: lo que tarda el proceso más lento, mejor de las repeticiones */
+static double time_layout(int l, StftWorkspace* ws, const float* signal, int n_bins,
+                          MPI_Comm comm, float* mag, GrowBuffer* dynamic_mag, FrameChunks* chunks) {
+    int rank, procs_number, rep, local_frames, failed = 0;
+    double best = -1.0;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    for (rep = 0; rep < AUTOTUNE_REPEATS; rep++) {
+        double t, slowest;
+
+        MPI_Barrier(comm);
+        t = MPI_Wtime();
+        if (layouts[l].schedule == SCHED_CYCLIC) {
+            stft_compute_cyclic(ws, signal, rank, procs_number, AUTOTUNE_FRAMES, n_bins, mag);
+        } else if (layouts[l].schedule == SCHED_BLOCK) {
+            failed |= stft_compute_blocks(ws, signal, rank, procs_number, AUTOTUNE_FRAMES, n_bins,
+                                          layouts[l].size, mag, chunks);
+        } else {
+            failed |= compute_stft_dynamic(ws, signal, AUTOTUNE_FRAMES, n_bins, layouts[l].size, 1,
+                                           comm, dynamic_mag, &local_frames, chunks);
+        }
+        t = MPI_Wtime() - t;
+
+        MPI_Allreduce(&t, &slowest, 1, MPI_DOUBLE, MPI_MAX, comm);
+        if (best < 0.0 || slowest < best) best = slowest;
+    }
+
+    if (failed) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para el autotuner\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return best;
+}
+
+void autotune_measure(const Config* cfg, MPI_Comm comm, TuneChoice* choice) {
+    Config tune_cfg = *cfg;
+    FrameChunks chunks = FRAME_CHUNKS_INIT;
+    GrowBuffer dynamic_mag = GROW_BUFFER_INIT;
+    StftWorkspace* ws;
+    size_t n_signal = (size_t)(AUTOTUNE_FRAMES - 1) * cfg->hop + cfg->N;
+    int n_bins = STFT_NBINS(cfg->N), power_of_two = (cfg->N & (cfg->N - 1)) == 0;
+    double local[N_KERNELS], slowest[N_KERNELS], best;
+    float *signal, *re, *im, *mag;
+    int k, l;
+
+    signal = malloc(n_signal * sizeof(float));
+    re = malloc(cfg->N * sizeof(float));
+    im = malloc(cfg->N * sizeof(float));
+    mag = malloc((size_t)AUTOTUNE_FRAMES * n_bins * sizeof(float));
+    if (!signal || !re || !im || !mag) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para el autotuner\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    fill_noise(signal, n_signal);
+
+    /* 1. Kernel de FFT: cada proceso mide en su core, cuenta el más lento.
+          Las variantes radix-2 son iguales al plan normal si N no es potencia de 2 */
+    for (k = 0; k < N_KERNELS; k++) {
+        local[k] = (k == FFT_KERNEL_RADIX4 || power_of_two) ?
+                   time_kernel((fft_kernel_t)k, signal, cfg->N, cfg->hop, re, im) : 1e30;
+    }
+    MPI_Allreduce(local, slowest, N_KERNELS, MPI_DOUBLE, MPI_MAX, comm);
+
+    choice->fft_kernel = FFT_KERNEL_RADIX4;
+    for (k = 1; k < N_KERNELS; k++) {
+        if (slowest[k] < slowest[choice->fft_kernel]) choice->fft_kernel = (fft_kernel_t)k;
+    }
+
+    /* 2. Distribución de frames con el kernel elegido (espectro completo: la banda depende
+          del sample rate de cada archivo) */
+    tune_cfg.fft_kernel = choice->fft_kernel;
+    tune_cfg.bin_lo = 0;
+    tune_cfg.bin_hi = n_bins - 1;
+    ws = stft_workspace_create(&tune_cfg);
+    if (!ws) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para el autotuner\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    choice->schedule = SCHED_CYCLIC;
+    choice->block_frames = cfg->block_frames;
+    choice->chunk_min = cfg->chunk_min;
+    best = -1.0;
+    for (l = 0; l < N_LAYOUTS; l++) {
+        double t = time_layout(l, ws, signal, n_bins, comm, mag, &dynamic_mag, &chunks);
+
+        if (best < 0.0 || t < best) {
+            best = t;
+            choice->schedule = layouts[l].schedule;
+            if (layouts[l].schedule == SCHED_BLOCK) choice->block_frames = layouts[l].size;
+            if (layouts[l].schedule == SCHED_DYNAMIC) choice->chunk_min = layouts[l].size;
+        }
+    }
+
+    stft_workspace_destroy(ws);
+    free_frame_chunks(&chunks);
+    grow_buffer_free(&dynamic_mag);
+    free(mag);
+    free(im);
+    free(re);
+    free(signal);
+}
+
+int autotune_apply(Config* cfg, MPI_Comm comm) {
+    char cpu[256];
+    TuneChoice choice;
+    int rank, procs_number, loaded = 0, packed[5];
+    double t_start = MPI_Wtime();
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    /* 1. Rank 0 busca la entrada de esta máquina en el archivo */
+    if (rank == 0) {
+        autotune_cpu_model(cpu, sizeof(cpu));
+        loaded = wisdom_load(cfg->wisdom_path, cpu, cfg, procs_number, &choice) == 0;
+    }
+    MPI_Bcast(&loaded, 1, MPI_INT, 0, comm);
+
+    /* 2. Si no estaba, se mide entre todos y rank 0 la guarda para la próxima */
+    if (!loaded) {
+        autotune_measure(cfg, comm, &choice);
+        if (rank == 0) {
+            wisdom_save(cfg->wisdom_path, cpu, cfg, procs_number, &choice);
+        }
+    }
+
+    packed[0] = choice.fft_kernel;
+    packed[1] = choice.schedule;
+    packed[2] = choice.block_frames;
+    packed[3] = choice.chunk_min;
+    packed[4] = loaded;
+    MPI_Bcast(packed, 5, MPI_INT, 0, comm);
+    cfg->fft_kernel = (fft_kernel_t)packed[0];
+    cfg->schedule = (sched_t)packed[1];
+    cfg->block_frames = packed[2];
+    cfg->chunk_min = packed[3];
+
+    if (rank == 0) {
+        printf("Autotuner (%s, N=%d, hop=%d, %d procesos): FFT %s, distribucion %s",
+               cpu, cfg->N, cfg->hop, procs_number, kernel_names[cfg->fft_kernel],
+               schedule_names[cfg->schedule]);
+        if (cfg->schedule == SCHED_BLOCK) printf(" (bloques de %d)", cfg->block_frames);
+        if (cfg->schedule == SCHED_DYNAMIC) printf(" (chunk minimo %d)", cfg->chunk_min);
+        printf(" - %s %s (%.3f s)\n", loaded ? "leido de" : "medido y guardado en",
+               cfg->wisdom_path, MPI_Wtime() - t_start);
+    }
+    return loaded;
+}
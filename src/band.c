@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <math.h>
+#include "band.h"
+#include "fft.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct BandPlan {
+    int N;
+    int bin_lo;
+    int n_out;               /* bins de la banda */
+    band_method_t method;
+
+    /* FFT completa */
+    FFTPlan* full;
+    float *re, *im;          /* N */
+
+    /* Goertzel: 2*cos(w_k) de cada bin */
+    double* coeff;
+
+    /* FFT podada: N = L * D */
+    int L, D;
+    FFTPlan* sub;            /* FFT de tamaño L */
+    float *mod_re, *mod_im;  /* e^{-2*pi*i*bin_lo*n/N}: corre la banda a 0 */
+    float *tw_re, *tw_im;    /* W_N^{m*d} en [d * n_out + m] */
+    float *acc_re, *acc_im;  /* n_out */
+};
+
+int band_bins_from_hz(int N, int fs, float f_lo, float f_hi, int* bin_lo, int* bin_hi) {
+    int nyquist_bin = N / 2;
+
+    *bin_lo = (int)ceil((double)f_lo * N / fs);
+    *bin_hi = (f_hi > 0.0f) ? (int)floor((double)f_hi * N / fs) : nyquist_bin;
+
+    if (*bin_lo < 0) *bin_lo = 0;
+    if (*bin_hi > nyquist_bin) *bin_hi = nyquist_bin;
+
+    /* Banda que empieza arriba de Nyquist: no queda ningún bin */
+    if (*bin_lo > nyquist_bin) return -1;
+
+    /* Banda más angosta que un bin: se toma el bin más cercano por arriba */
+    if (*bin_hi < *bin_lo) *bin_hi = *bin_lo;
+    return 0;
+}
+
+/* Divisor más chico de N que sea >= minimo (N si no hay otro) */
+static int smallest_divisor_at_least(int N, int minimo) {
+    int L;
+    for (L = minimo > 1 ? minimo : 1; L < N; L++) {
+        if (N % L == 0) return L;
+    }
+    return N;
+}
+
+void band_plan_destroy(BandPlan* plan) {
+    if (!plan) return;
+    fft_plan_destroy(plan->full);
+    fft_plan_destroy(plan->sub);
+    free(plan->re);
+    free(plan->im);
+    free(plan->coeff);
+    free(plan->mod_re);
+    free(plan->mod_im);
+    free(plan->tw_re);
+    free(plan->tw_im);
+    free(plan->acc_re);
+    free(plan->acc_im);
+    free(plan);
+}
+
+band_method_t band_choose_method(int N, int bin_lo, int bin_hi) {
+    int n_out = bin_hi - bin_lo + 1;
+    int L = smallest_divisor_at_least(N, n_out);
+    int D = N / L;
+    double cost_full, cost_goertzel, cost_pruned;
+
+    /* Estimación de flops por frame de cada método */
+    cost_full = 5.0 * N * (log((double)N) / log(2.0));
+    cost_goertzel = 4.0 * N * n_out;
+    cost_pruned = (L < N)
+        ? 6.0 * N + D * 5.0 * L * (log((double)L) / log(2.0)) + 8.0 * D * n_out
+        : cost_full * 2.0;
+
+    if (cost_goertzel <= cost_full && cost_goertzel <= cost_pruned) {
+        return BAND_GOERTZEL;
+    } else if (cost_pruned < cost_full) {
+        return BAND_PRUNED_FFT;
+    }
+    return BAND_FULL_FFT;
+}
+
+BandPlan* band_plan_create(int N, int bin_lo, int bin_hi) {
+    BandPlan* plan;
+    int n, m, d, k;
+
+    plan = calloc(1, sizeof(BandPlan));
+    if (!plan) return NULL;
+
+    plan->N = N;
+    plan->bin_lo = bin_lo;
+    plan->n_out = bin_hi - bin_lo + 1;
+    plan->L = smallest_divisor_at_least(N, plan->n_out);
+    plan->D = N / plan->L;
+    plan->method = band_choose_method(N, bin_lo, bin_hi);
+
+    switch (plan->method) {
+        case BAND_FULL_FFT:
+            plan->full = fft_plan_create(N);
+            plan->re = malloc(N * sizeof(float));
+            plan->im = malloc(N * sizeof(float));
+            if (!plan->full || !plan->re || !plan->im) break;
+            return plan;
+
+        case BAND_GOERTZEL:
+            plan->coeff = malloc(plan->n_out * sizeof(double));
+            if (!plan->coeff) break;
+            for (k = 0; k < plan->n_out; k++) {
+                plan->coeff[k] = 2.0 * cos(2.0 * M_PI * (bin_lo + k) / N);
+            }
+            return plan;
+
+        case BAND_PRUNED_FFT:
+            plan->sub = fft_plan_create(plan->L);
+            plan->re = malloc(plan->L * sizeof(float));
+            plan->im = malloc(plan->L * sizeof(float));
+            plan->mod_re = malloc(N * sizeof(float));
+            plan->mod_im = malloc(N * sizeof(float));
+            plan->tw_re = malloc((size_t)plan->D * plan->n_out * sizeof(float));
+            plan->tw_im = malloc((size_t)plan->D * plan->n_out * sizeof(float));
+            plan->acc_re = malloc(plan->n_out * sizeof(float));
+            plan->acc_im = malloc(plan->n_out * sizeof(float));
+            if (!plan->sub || !plan->re || !plan->im || !plan->mod_re || !plan->mod_im ||
+                !plan->tw_re || !plan->tw_im || !plan->acc_re || !plan->acc_im) break;
+
+            for (n = 0; n < N; n++) {
+                /* (bin_lo*n) mod N mantiene el ángulo chico y preciso */
+                double ang = -2.0 * M_PI * (double)(((long)bin_lo * n) % N) / N;
+                plan->mod_re[n] = (float)cos(ang);
+                plan->mod_im[n] = (float)sin(ang);
+            }
+            for (d = 0; d < plan->D; d++) {
+                for (m = 0; m < plan->n_out; m++) {
+                    double ang = -2.0 * M_PI * (double)(((long)m * d) % N) / N;
+                    plan->tw_re[d * plan->n_out + m] = (float)cos(ang);
+                    plan->tw_im[d * plan->n_out + m] = (float)sin(ang);
+                }
+            }
+            return plan;
+    }
+
+    band_plan_destroy(plan);
+    return NULL;
+}
+
+/**
+ * FFT podada en la salida. Con y[n] = x[n] * e^{-2*pi*i*bin_lo*n/N} y n = l*D + d:
+ *   X[bin_lo + m] = sum_d W_N^{m*d} * FFT_L( y[d], y[D+d], ..., y[(L-1)*D+d] )[m]
+ * Son D FFTs de tamaño L (L >= ancho de banda) y una pasada de acumulación,
+ * en total ~N*log2(L) en vez de N*log2(N).
+ */
+static void pruned_magnitudes(BandPlan* plan, const float* frame, float* out) {
+    int L = plan->L, D = plan->D, n_out = plan->n_out;
+    int d, l, m;
+
+    for (m = 0; m < n_out; m++) {
+        plan->acc_re[m] = 0.0f;
+        plan->acc_im[m] = 0.0f;
+    }
+
+    for (d = 0; d < D; d++) {
+        const float *twr = plan->tw_re + d * n_out, *twi = plan->tw_im + d * n_out;
+
+        /* Subsecuencia decimada d, ya desplazada en frecuencia */
+        for (l = 0; l < L; l++) {
+            int n = l * D + d;
+            plan->re[l] = frame[n] * plan->mod_re[n];
+            plan->im[l] = frame[n] * plan->mod_im[n];
+        }
+
+        fft_execute(plan->sub, plan->re, plan->im);
+
+        for (m = 0; m < n_out; m++) {
+            plan->acc_re[m] += twr[m] * plan->re[m] - twi[m] * plan->im[m];
+            plan->acc_im[m] += twr[m] * plan->im[m] + twi[m] * plan->re[m];
+        }
+    }
+
+    for (m = 0; m < n_out; m++) {
+        out[m] = (float)sqrt(plan->acc_re[m] * plan->acc_re[m] + plan->acc_im[m] * plan->acc_im[m]);
+    }
+}
+
+/**
+ * Goertzel: recurrencia real de segundo orden por bin, sin tocar los demás.
+ * El estado va en double: cerca de DC el coeficiente tiende a 2 y en float se pierde precisión.
+ */
+static void goertzel_magnitudes(BandPlan* plan, const float* frame, float* out) {
+    int N = plan->N, k, n;
+
+    for (k = 0; k < plan->n_out; k++) {
+        double coeff = plan->coeff[k];
+        double s0, s1 = 0.0, s2 = 0.0;
+        double power;
+
+        for (n = 0; n < N; n++) {
+            s0 = frame[n] + coeff * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+
+        /* |X_k|^2 = s1^2 + s2^2 - 2cos(w) s1 s2 */
+        power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+        out[k] = (float)sqrt(power > 0.0 ? power : 0.0);
+    }
+}
+
+void band_magnitudes(BandPlan* plan, const float* frame, float* out) {
+    int k;
+
+    switch (plan->method) {
+        case BAND_GOERTZEL:
+            goertzel_magnitudes(plan, frame, out);
+            break;
+        case BAND_PRUNED_FFT:
+            pruned_magnitudes(plan, frame, out);
+            break;
+        case BAND_FULL_FFT:
+            for (k = 0; k < plan->N; k++) {
+                plan->re[k] = frame[k];
+                plan->im[k] = 0.0f;
+            }
+            fft_execute(plan->full, plan->re, plan->im);
+            for (k = 0; k < plan->n_out; k++) {
+                float r = plan->re[plan->bin_lo + k], i = plan->im[plan->bin_lo + k];
+                out[k] = (float)sqrt(r * r + i * i);
+            }
+            break;
+    }
+}
+
+band_method_t band_plan_method(const BandPlan* plan) {
+    return plan->method;
+}
+
+const char* band_method_name(band_method_t method) {
+    switch (method) {
+        case BAND_FULL_FFT: return "FFT completa";
+        case BAND_GOERTZEL: return "Goertzel";
+        case BAND_PRUNED_FFT: return "FFT podada";
+    }
+    return "?";
+}
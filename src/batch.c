@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "analyzer.h"
+#include "mpi_utils.h"
+#include "wav.h"
+#include "buffer.h"
+
+/* Campos de cada resultado que los líderes envían a rank 0 */
+#define BATCH_RECORD_FIELDS 5   /* índice en la lista, estado, bpm, segundos, procesos */
+
+/* Archivo de la lista con su largo en frames de STFT */
+typedef struct {
+    int frames;
+    int index;   /* posición en la lista original */
+} BatchEntry;
+
+/* Orden de mayor a menor largo (a igual largo, el orden de la lista) */
+static int compare_entries_desc(const void* a, const void* b) {
+    const BatchEntry* x = (const BatchEntry*)a;
+    const BatchEntry* y = (const BatchEntry*)b;
+    if (x->frames != y->frames) return (x->frames < y->frames) ? 1 : -1;
+    return x->index - y->index;
+}
+
+/**
+ * Dimensiona los grupos recorriendo los archivos de mayor a menor: cada archivo pide la
+ * fracción de procesos proporcional a su parte del trabajo total (así ninguno queda como
+ * cuello de botella), sin bajar de BATCH_MIN_FRAMES_PER_RANK frames por proceso. Si sobran
+ * procesos (pocos archivos) se suman a los grupos más grandes.
+ *
+ * @param frames Largo de cada archivo en frames, de mayor a menor
+ * @return Cantidad de grupos (sizes[0] es el del archivo más largo)
+ */
+static int plan_groups(const int* frames, int n_files, int procs_number, int* sizes) {
+    double total = 0.0;
+    int remaining = procs_number, n_groups = 0, i, need, cap;
+
+    for (i = 0; i < n_files; i++) {
+        total += frames[i];
+    }
+
+    for (i = 0; i < n_files && remaining > 0; i++) {
+        need = (total > 0.0) ? (int)((double)frames[i] * procs_number / total + 0.999999) : 1;
+        cap = frames[i] / BATCH_MIN_FRAMES_PER_RANK;
+        if (need > cap) need = cap;
+        if (need < 1) need = 1;
+        if (need > remaining) need = remaining;
+
+        sizes[n_groups++] = need;
+        remaining -= need;
+    }
+
+    for (i = 0; remaining > 0; i = (i + 1) % n_groups) {
+        sizes[i]++;
+        remaining--;
+    }
+
+    return n_groups;
+}
+
+/* Rank 0: lee la lista, mide cada archivo y la ordena de mayor a menor */
+static char* load_sorted_list(const Config* cfg, int* n_files, size_t* bytes, int** order, int** frames) {
+    char *list, *sorted, *p;
+    char** paths;
+    BatchEntry* entries;
+    size_t used = 0, len;
+    int i, samples, samplerate, n;
+
+    list = load_wav_list_all(cfg->batch_list, n_files, bytes);
+    if (!list) {
+        fprintf(stderr, "Error: No se pudo abrir el archivo %s\n", cfg->batch_list);
+        return NULL;
+    }
+
+    n = *n_files > 0 ? *n_files : 1;
+    paths = malloc(n * sizeof(char*));
+    entries = malloc(n * sizeof(BatchEntry));
+    *order = malloc(n * sizeof(int));
+    *frames = malloc(n * sizeof(int));
+    sorted = malloc(*bytes > 0 ? *bytes : 1);
+    if (!paths || !entries || !*order || !*frames || !sorted) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la lista de audios\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* Solo el encabezado: el largo sale del tamaño del chunk data */
+    for (i = 0, p = list; i < *n_files; i++, p += strlen(p) + 1) {
+        paths[i] = p;
+        entries[i].index = i;
+        entries[i].frames = 0;
+        if (wav_probe(p, &samples, &samplerate) == 0) {
+            entries[i].frames = STFT_NFRAMES(samples, cfg->N, cfg->hop);
+            if (entries[i].frames < 0) entries[i].frames = 0;
+        }
+    }
+
+    qsort(entries, *n_files, sizeof(BatchEntry), compare_entries_desc);
+
+    for (i = 0; i < *n_files; i++) {
+        len = strlen(paths[entries[i].index]) + 1;
+        memcpy(sorted + used, paths[entries[i].index], len);
+        used += len;
+        (*order)[i] = entries[i].index;
+        (*frames)[i] = entries[i].frames;
+    }
+
+    free(paths);
+    free(entries);
+    free(list);
+    return sorted;
+}
+
+/* Rank 0: resumen de todo el lote, en el orden de la lista original */
+static void write_summary(const char* filename, char** paths, const int* order, int n_files,
+                          const double* records, int n_records) {
+    FILE* f;
+    const double** by_pos;
+    int* pos_of;
+    int i, pos;
+
+    by_pos = calloc(n_files, sizeof(double*));
+    pos_of = malloc(n_files * sizeof(int));
+    f = fopen(filename, "w");
+    if (!by_pos || !pos_of || !f) {
+        perror("Error al escribir el resumen del lote");
+        free(by_pos);
+        free(pos_of);
+        if (f) fclose(f);
+        return;
+    }
+
+    /* records[0] es la posición en la lista ordenada; order la lleva a la original */
+    for (i = 0; i < n_records; i++) {
+        by_pos[(int)records[i * BATCH_RECORD_FIELDS]] = &records[i * BATCH_RECORD_FIELDS];
+    }
+    for (pos = 0; pos < n_files; pos++) {
+        pos_of[order[pos]] = pos;
+    }
+
+    fprintf(f, "archivo,bpm,segundos,procesos,estado\n");
+    for (i = 0; i < n_files; i++) {
+        const double* r = by_pos[pos_of[i]];
+        if (!r) continue;
+        fprintf(f, "%s,%.2f,%.6f,%d,%s\n", paths[pos_of[i]], r[2], r[3], (int)r[4],
+                r[1] == 0.0 ? "ok" : "error");
+    }
+
+    fclose(f);
+    free(by_pos);
+    free(pos_of);
+    printf("\nResumen del lote escrito en %s\n", filename);
+}
+
+int batch_run(const Config* cfg, MPI_Comm comm) {
+    int rank, procs_number, group_rank, group_size;
+    int n_files = 0, n_groups = 0, color, i;
+    unsigned long header[2];
+    size_t bytes = 0;
+    char *list = NULL, *p;
+    char** paths;
+    int* order = NULL;
+    int* frames = NULL;
+    int* sizes;
+    MPI_Comm group;
+    WorkCounter counter;
+    Analyzer* analyzer;
+    AnalyzerReport report;
+    GrowBuffer records = GROW_BUFFER_INIT;
+    double* record;
+    int n_records = 0, file, status, failed = 0, any_failed;
+    double t_start = MPI_Wtime();
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    sizes = malloc(procs_number * sizeof(int));
+    if (!sizes) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para los grupos\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* 1. Rank 0 arma la lista ordenada (de mayor a menor) y dimensiona los grupos */
+    if (rank == 0) {
+        list = load_sorted_list(cfg, &n_files, &bytes, &order, &frames);
+        if (!list) {
+            n_files = -1;
+        } else if (n_files > 0) {
+            n_groups = plan_groups(frames, n_files, procs_number, sizes);
+        }
+    }
+
+    header[0] = (unsigned long)(n_files + 1);
+    header[1] = (unsigned long)bytes;
+    MPI_Bcast(header, 2, MPI_UNSIGNED_LONG, 0, comm);
+    n_files = (int)header[0] - 1;
+    bytes = (size_t)header[1];
+
+    if (n_files <= 0) {
+        if (rank == 0 && n_files == 0) {
+            printf("Advertencia: No se encontraron archivos en %s\n", cfg->batch_list);
+        }
+        free(sizes);
+        free(list);
+        free(order);
+        free(frames);
+        return n_files == 0 ? 0 : -1;
+    }
+
+    /* 2. Todos reciben las rutas (ordenadas) y el tamaño de cada grupo */
+    if (rank != 0) {
+        list = malloc(bytes);
+        if (!list) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la lista de audios\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Bcast(list, (int)bytes, MPI_CHAR, 0, comm);
+    MPI_Bcast(&n_groups, 1, MPI_INT, 0, comm);
+    MPI_Bcast(sizes, n_groups, MPI_INT, 0, comm);
+
+    paths = malloc(n_files * sizeof(char*));
+    if (!paths) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la lista de audios\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (i = 0, p = list; i < n_files; i++, p += strlen(p) + 1) {
+        paths[i] = p;
+    }
+
+    if (rank == 0) {
+        printf("Lote: %d archivos en %d grupos (procesos por grupo:", n_files, n_groups);
+        for (i = 0; i < n_groups; i++) printf(" %d", sizes[i]);
+        printf(")\n");
+        fflush(stdout);
+    }
+
+    /* 3. Grupo de este proceso: los primeros sizes[0] ranks forman el grupo 0, etc. */
+    for (color = 0, i = sizes[0]; rank >= i; i += sizes[++color]) {}
+    MPI_Comm_split(comm, color, rank, &group);
+    MPI_Comm_rank(group, &group_rank);
+    MPI_Comm_size(group, &group_size);
+
+    /* Cola de archivos: el grupo g arranca con el archivo g (para el que se dimensionó) y
+       después cada líder reclama el siguiente de un contador en rank 0 */
+    if (work_counter_create(&counter, comm) != 0) {
+        fprintf(stderr, "Error: No se pudo crear la cola de archivos\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    analyzer = analyzer_create(cfg, group);
+    if (!analyzer) {
+        fprintf(stderr, "Error: No se pudo crear el contexto de análisis\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    file = color;
+    for (;;) {
+        MPI_Bcast(&file, 1, MPI_INT, 0, group);
+        if (file >= n_files) {
+            break;
+        }
+
+        status = analyzer_run(analyzer, paths[file], &report);
+
+        if (group_rank == 0) {
+            record = grow_buffer_reserve(&records, (size_t)(n_records + 1) * BATCH_RECORD_FIELDS * sizeof(double));
+            if (!record) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para los resultados\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            record += (size_t)n_records * BATCH_RECORD_FIELDS;
+            record[0] = file;
+            record[1] = status;
+            record[2] = status == 0 ? report.bpm : 0.0;
+            record[3] = status == 0 ? report.t_total : 0.0;
+            record[4] = group_size;
+            n_records++;
+
+            if (status == 0) {
+                printf("Lote [grupo %d, %d procesos]: %s -> BPM %.2f (%.3f s)\n",
+                       color, group_size, paths[file], report.bpm, report.t_total);
+            } else {
+                printf("Lote [grupo %d, %d procesos]: %s -> error\n", color, group_size, paths[file]);
+                failed = 1;
+            }
+            fflush(stdout);
+
+            file = n_groups + work_counter_next(&counter, 1);
+        }
+    }
+
+    analyzer_destroy(analyzer);
+    work_counter_free(&counter);
+
+    /* 4. Rank 0 junta los resultados de todos los líderes y escribe el resumen */
+    {
+        int* counts = NULL;
+        int* displs = NULL;
+        double* all = NULL;
+        int total = 0, send = n_records * BATCH_RECORD_FIELDS;
+
+        if (rank == 0) {
+            counts = malloc(procs_number * sizeof(int));
+            displs = malloc(procs_number * sizeof(int));
+        }
+        MPI_Gather(&send, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+        if (rank == 0) {
+            for (i = 0; i < procs_number; i++) {
+                displs[i] = total;
+                total += counts[i];
+            }
+            all = malloc((total > 0 ? total : 1) * sizeof(double));
+        }
+        MPI_Gatherv(records.data, send, MPI_DOUBLE, all, counts, displs, MPI_DOUBLE, 0, comm);
+
+        if (rank == 0) {
+            /* Con el almacén no hay results/: el resumen queda junto a los registros */
+            char summary_path[MAX_PATH + 32];
+
+            sprintf(summary_path, "%s/batch_summary.csv",
+                    cfg->store_dir[0] != '\0' ? cfg->store_dir : "results");
+            write_summary(summary_path, paths, order, n_files, all, total / BATCH_RECORD_FIELDS);
+            printf("Lote terminado en %f segundos\n", MPI_Wtime() - t_start);
+            free(counts);
+            free(displs);
+            free(all);
+        }
+    }
+
+    MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_MAX, comm);
+
+    MPI_Comm_free(&group);
+    grow_buffer_free(&records);
+    free(paths);
+    free(list);
+    free(sizes);
+    free(order);
+    free(frames);
+    return any_failed ? -1 : 0;
+}
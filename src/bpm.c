@@ -7,23 +7,20 @@
 #include <math.h>
 #include <stddef.h>
 
-/* --- Funciones auxiliares internas (static) --- */
+/* --- Funciones auxiliares (internas salvo el flux, que también se usa por canal) --- */
 
 /**
  * @brief Calcula la curva de "Spectral Flux" (Onset Strength Function).
  * Input: Spectrogram como array 1D lineal: spectrogram[frame * num_bins + bin]
- * Output: float* (tamaño num_frames)
+ * Output: flux_curve (tamaño num_frames, provisto por el llamador)
  */
-static float* calculate_spectral_flux(float* spectrogram, int num_frames, int num_bins) {
-    float* flux_curve;
+void calculate_spectral_flux(float* spectrogram, int num_frames, int num_bins, float* flux_curve) {
     int t, k;
     float sum_of_flux, mag_current, mag_previous, diff;
     
-    /* 1. Alojar memoria para la curva de flux */
-    flux_curve = (float*) calloc(num_frames, sizeof(float));
-    if (!flux_curve) {
-        perror("Error alocando memoria para flux_curve");
-        return NULL;
+    /* 1. El primer frame no tiene anterior: flux nulo */
+    if (num_frames > 0) {
+        flux_curve[0] = 0.0f;
     }
 
     /* 2. Iterar por cada frame (empezando desde el segundo, t=1) */
@@ -49,8 +46,6 @@ static float* calculate_spectral_flux(float* spectrogram, int num_frames, int nu
 
     /* Opcional (pero recomendado): Normalizar la curva [0, 1] */
     /* (Encuentra el max y divide todo por el max) */
-    
-    return flux_curve;
 }
 
 /* src/bpm.c (continuación) */
@@ -58,19 +53,11 @@ static float* calculate_spectral_flux(float* spectrogram, int num_frames, int nu
 /**
  * @brief Calcula la autocorrelación de una señal 1D (la curva de flux).
  * Input: float* (tamaño num_frames)
- * Output: float* (tamaño num_frames)
+ * Output: acf_curve (tamaño num_frames, provisto por el llamador)
  */
-static float* calculate_autocorrelation(float* signal, int signal_len) {
-    float* acf_curve;
+static void calculate_autocorrelation(float* signal, int signal_len, float* acf_curve) {
     int lag, t;
     float sum;
-    
-    /* 1. Alojar smemoria para la curva de autocorrelación */
-    acf_curve = (float*) calloc(signal_len, sizeof(float));
-    if (!acf_curve) {
-        perror("Error alocando memoria para acf_curve");
-        return NULL;
-    }
 
     /* 2. Iterar por cada posible "lag" (desplazamiento) */
     for (lag = 0; lag < signal_len; lag++) {
@@ -85,48 +72,57 @@ static float* calculate_autocorrelation(float* signal, int signal_len) {
     
     /* Opcional (pero recomendado): Normalizar la curva */
     /* (divide todo por acf_curve[0], que es la energía total) */
-
-    return acf_curve;
 }
 
 /* src/bpm.c (continuación) */
 
-/* Declaración de una función auxiliar */
-static float* calculate_spectral_flux(float* spectrogram, int num_frames, int num_bins);
-static float* calculate_autocorrelation(float* signal, int signal_len);
-
-/**
- * @brief Encuentra el pico en la curva de autocorrelación y estima el BPM.
- * * @param acf_curve La curva de autocorrelación.
- * @param acf_len La longitud de la curva.
- * @return float El BPM estimado.
- */
-static float find_bpm_from_acf(float* acf_curve, int acf_len, int sample_rate) {
+void bpm_lag_range(const Config* cfg, int* lag_min, int* lag_max) {
     float flux_sample_rate_hz;
-    int min_bpm, max_bpm, lag_max, lag_min, best_lag, lag;
-    float max_peak_value;
-    float period_in_seconds, estimated_bpm;
-    
-    /* --- 1. Definir el Rango de Búsqueda (¡La parte más importante!) --- */
+    int min_bpm, max_bpm;
+
     /* ¿A cuántos frames (lags) equivale un BPM? */
     
     /* Frecuencia de muestreo de la curva de flux (frames por segundo) */
-    flux_sample_rate_hz = (float)sample_rate / (float)DEFAULT_HOP; /* Ej: 44100 / 512 = 86.13 Hz */
+    flux_sample_rate_hz = (float)cfg->fs / (float)cfg->hop; /* Ej: 44100 / 512 = 86.13 Hz */
 
     /* Convertir BPM a "lag" (índices del array) */
     /* BPM = 60 / (periodo_en_segundos) */
     /* periodo_en_segundos = 60 / BPM */
     /* lag = periodo_en_segundos * flux_sample_rate_hz */
 
-    /* Rango de tempo humano: 60 BPM a 180 BPM (puedes ajustarlo) */
-    min_bpm = DEFAULT_BPM_MIN;
-    max_bpm = DEFAULT_BPM_MAX;
+    /* Rango de tempo humano: por defecto 60 BPM a 200 BPM (se ajusta con --bpm-min/--bpm-max) */
+    min_bpm = cfg->bpm_min;
+    max_bpm = cfg->bpm_max;
 
     /* El lag MÁXIMO corresponde al BPM MÍNIMO */
-    lag_max = (int)floor( (60.0 / min_bpm) * flux_sample_rate_hz );
+    *lag_max = (int)floor( (60.0 / min_bpm) * flux_sample_rate_hz );
     
-    /* El lag MÍNIMO corresponde al BPM MÁXIMO */
-    lag_min = (int)ceil( (60.0 / max_bpm) * flux_sample_rate_hz );
+    /* El lag MÍNIMO corresponde al BPM MÁXIMO (lag 0 no es un período) */
+    *lag_min = (int)ceil( (60.0 / max_bpm) * flux_sample_rate_hz );
+    if (*lag_min < 1) {
+        *lag_min = 1;
+    }
+}
+
+float bpm_from_lag(const Config* cfg, int lag) {
+    float flux_sample_rate_hz = (float)cfg->fs / (float)cfg->hop;
+    float period_in_seconds = (float)lag / flux_sample_rate_hz;
+    return 60.0 / period_in_seconds;
+}
+
+/**
+ * @brief Encuentra el pico en la curva de autocorrelación y estima el BPM.
+ * * @param acf_curve La curva de autocorrelación.
+ * @param acf_len La longitud de la curva.
+ * @param cfg Configuración de la corrida (sample rate, hop y rango de BPM).
+ * @return float El BPM estimado.
+ */
+static float find_bpm_from_acf(float* acf_curve, int acf_len, const Config* cfg) {
+    int lag_max, lag_min, best_lag, lag;
+    float max_peak_value;
+    
+    /* --- 1. Definir el Rango de Búsqueda (¡La parte más importante!) --- */
+    bpm_lag_range(cfg, &lag_min, &lag_max);
     
     /* Asegurarnos de no salirnos de los límites del array */
     if (lag_max >= acf_len) {
@@ -151,16 +147,60 @@ static float find_bpm_from_acf(float* acf_curve, int acf_len, int sample_rate) {
     }
 
     /* --- 3. Convertir el lag ganador (best_lag) de nuevo a BPM --- */
-    period_in_seconds = (float)best_lag / flux_sample_rate_hz;
-    estimated_bpm = 60.0 / period_in_seconds;
-
-    return estimated_bpm;
+    return bpm_from_lag(cfg, best_lag);
 }
 
 /* src/bpm.c (continuación) */
 
 /* Implementación de las funciones públicas */
-AnalysisResults* analyze_features_and_bpm(float* spectrogram, int num_frames, int num_bins, int sample_rate) {
+float analyze_bpm_into(float* spectrogram, int num_frames, int num_bins, const Config* cfg,
+                       float* flux_out, float* acf_scratch) {
+    /* 1. Calcular Flux (Paso 2.1) */
+    calculate_spectral_flux(spectrogram, num_frames, num_bins, flux_out);
+
+    /* 2. Calcular Autocorrelación (Paso 2.2) */
+    calculate_autocorrelation(flux_out, num_frames, acf_scratch);
+
+    /* 3. Estimar BPM (Paso 2.3) */
+    return find_bpm_from_acf(acf_scratch, num_frames, cfg);
+}
+
+float bpm_confidence(const float* flux, int num_frames, float bpm, const Config* cfg) {
+    double mean = 0.0, energy = 0.0, sum = 0.0, confidence;
+    int t, lag;
+
+    if (bpm <= 0.0f || num_frames < 2) {
+        return 0.0f;
+    }
+
+    /* Lag (en frames de flux) del período del BPM */
+    lag = (int)((60.0 / bpm) * cfg->fs / cfg->hop + 0.5);
+    if (lag < 1 || lag >= num_frames) {
+        return 0.0f;
+    }
+
+    for (t = 0; t < num_frames; t++) {
+        mean += flux[t];
+    }
+    mean /= num_frames;
+
+    for (t = 0; t < num_frames; t++) {
+        energy += (flux[t] - mean) * (flux[t] - mean);
+        if (t + lag < num_frames) {
+            sum += (flux[t] - mean) * (flux[t + lag] - mean);
+        }
+    }
+
+    if (energy <= 0.0) {
+        return 0.0f;
+    }
+    confidence = sum / energy;
+    if (confidence < 0.0) confidence = 0.0;
+    if (confidence > 1.0) confidence = 1.0;
+    return (float)confidence;
+}
+
+AnalysisResults* analyze_features_and_bpm(float* spectrogram, int num_frames, int num_bins, const Config* cfg) {
     AnalysisResults* results;
     float* acf_curve;
     
@@ -172,22 +212,33 @@ AnalysisResults* analyze_features_and_bpm(float* spectrogram, int num_frames, in
     }
     results->num_frames = num_frames;
 
-    /* 2. Calcular Flux (Paso 2.1) */
-    results->onset_flux_curve = calculate_spectral_flux(spectrogram, num_frames, num_bins);
-
-    /* 3. Calcular Autocorrelación (Paso 2.2) */
-    acf_curve = calculate_autocorrelation(results->onset_flux_curve, num_frames);
+    /* 2. Alojar flux (parte del resultado) y autocorrelación (intermedia) */
+    results->onset_flux_curve = (float*) malloc((num_frames > 0 ? num_frames : 1) * sizeof(float));
+    acf_curve = (float*) malloc((num_frames > 0 ? num_frames : 1) * sizeof(float));
+    if (!results->onset_flux_curve || !acf_curve) {
+        perror("Error alocando memoria para flux/acf");
+        free(acf_curve);
+        free_analysis_results(results);
+        return NULL;
+    }
 
-    /* 4. Estimar BPM (Paso 2.3) */
-    results->bpm_estimado = find_bpm_from_acf(acf_curve, num_frames, sample_rate);
+    /* 3. Flux, autocorrelación y BPM */
+    results->bpm_estimado = analyze_bpm_into(spectrogram, num_frames, num_bins, cfg,
+                                             results->onset_flux_curve, acf_curve);
 
-    /* 7. Liberar memoria intermedia (solo nos importa el flux y el BPM final) */
+    /* 4. Liberar memoria intermedia (solo nos importa el flux y el BPM final) */
     free(acf_curve);
     
     return results;
 }
 
-void write_results_to_csv(const char* filename, const AnalysisResults* results, int sample_rate) {
+void free_analysis_results(AnalysisResults* results) {
+    if (!results) return;
+    free(results->onset_flux_curve);
+    free(results);
+}
+
+void write_results_to_csv(const char* filename, const AnalysisResults* results, const Config* cfg) {
     FILE* f;
     float flux_sample_rate_hz;
     int t;
@@ -202,7 +253,7 @@ void write_results_to_csv(const char* filename, const AnalysisResults* results,
     /* Escribir cabecera */
     fprintf(f, "tiempo_seg,flux_onset,bpm_estimado\n");
 
-    flux_sample_rate_hz = (float)sample_rate / (float)DEFAULT_HOP;
+    flux_sample_rate_hz = (float)cfg->fs / (float)cfg->hop;
 
     /* Escribir datos */
     for (t = 0; t < results->num_frames; t++) {
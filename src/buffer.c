@@ -0,0 +1,29 @@
+#include <stdlib.h>
+#include "buffer.h"
+
+void* grow_buffer_reserve(GrowBuffer* buffer, size_t bytes) {
+    size_t new_capacity;
+    void* grown;
+
+    if (bytes <= buffer->capacity && buffer->data) {
+        return buffer->data;
+    }
+
+    new_capacity = bytes + bytes / 2;
+    if (new_capacity == 0) new_capacity = 1;
+
+    grown = realloc(buffer->data, new_capacity);
+    if (!grown) {
+        return NULL;
+    }
+
+    buffer->data = grown;
+    buffer->capacity = new_capacity;
+    return grown;
+}
+
+void grow_buffer_free(GrowBuffer* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->capacity = 0;
+}
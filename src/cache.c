@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+/* Archivos de la cache dentro del directorio de resultados del track */
+#define CACHE_SPEC_FILE "spectrogram.cache"
+#define CACHE_ANALYSIS_FILE "analysis.cache"
+
+#define CACHE_MAGIC "PAAC"
+#define CACHE_VERSION 2
+
+/* Tipo de contenido de cada archivo */
+#define CACHE_KIND_SPECTROGRAM 1
+#define CACHE_KIND_ANALYSIS 2
+
+/* Encabezado común de los archivos de cache */
+typedef struct {
+    char magic[4];
+    int version;
+    int kind;
+    int n_frames;
+    int n_bins;     /* 0 en el archivo de análisis */
+    CacheKey key;
+} CacheHeader;
+
+void cache_make_key(CacheKey *key, uint64_t data_hash, int n_samples, const Config *cfg) {
+    memset(key, 0, sizeof(CacheKey));
+    key->data_hash = data_hash;
+    key->n_samples = n_samples;
+    key->fs = cfg->fs;
+    key->N = cfg->N;
+    key->hop = cfg->hop;
+    key->wtype = (int)cfg->wtype;
+    key->bin_lo = cfg->bin_lo;
+    key->bin_hi = cfg->bin_hi;
+    key->bpm_min = cfg->bpm_min;
+    key->bpm_max = cfg->bpm_max;
+}
+
+/* Compara solo la parte de la clave que determina el espectrograma */
+static int spectral_key_equal(const CacheKey *a, const CacheKey *b) {
+    return a->data_hash == b->data_hash &&
+           a->n_samples == b->n_samples &&
+           a->fs == b->fs &&
+           a->N == b->N &&
+           a->hop == b->hop &&
+           a->wtype == b->wtype &&
+           a->bin_lo == b->bin_lo &&
+           a->bin_hi == b->bin_hi;
+}
+
+/* Compara la clave completa (espectrograma + parámetros del BPM) */
+static int full_key_equal(const CacheKey *a, const CacheKey *b) {
+    return spectral_key_equal(a, b) &&
+           a->bpm_min == b->bpm_min &&
+           a->bpm_max == b->bpm_max;
+}
+
+static void cache_file_path(char *out, const char *dir, const char *name) {
+    sprintf(out, "%s/%s", dir, name);
+}
+
+/* Abre un archivo de cache y valida su encabezado. Devuelve el FILE posicionado en los datos. */
+static FILE *open_and_check(const char *path, int kind, CacheHeader *header) {
+    FILE *f;
+
+    f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+
+    if (fread(header, sizeof(CacheHeader), 1, f) != 1 ||
+        memcmp(header->magic, CACHE_MAGIC, 4) != 0 ||
+        header->version != CACHE_VERSION ||
+        header->kind != kind) {
+        fclose(f);
+        return NULL;
+    }
+
+    return f;
+}
+
+/* Escribe encabezado + datos en un temporal y lo renombra sobre el destino */
+static int write_atomic(const char *path, const CacheHeader *header,
+                        const void *data, size_t elem_size, size_t count,
+                        const void *extra, size_t extra_size) {
+    char tmp_path[MAX_PATH + 8];
+    FILE *f;
+    int ok;
+
+    sprintf(tmp_path, "%s.tmp", path);
+    f = fopen(tmp_path, "wb");
+    if (!f) {
+        perror("cache: no se pudo crear el archivo temporal");
+        return -1;
+    }
+
+    ok = fwrite(header, sizeof(CacheHeader), 1, f) == 1;
+    if (ok && extra_size > 0) {
+        ok = fwrite(extra, extra_size, 1, f) == 1;
+    }
+    if (ok && count > 0) {
+        ok = fwrite(data, elem_size, count, f) == count;
+    }
+
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "cache: error escribiendo %s\n", tmp_path);
+        remove(tmp_path);
+        return -1;
+    }
+
+    if (rename(tmp_path, path) != 0) {
+        perror("cache: no se pudo renombrar el archivo temporal");
+        remove(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+cache_status_t cache_lookup(const char *dir, const CacheKey *key) {
+    char path[MAX_PATH];
+    CacheHeader header;
+    FILE *f;
+    int spectrogram_ok;
+
+    /* 1. ¿El espectrograma guardado corresponde a este audio y estos parámetros? */
+    cache_file_path(path, dir, CACHE_SPEC_FILE);
+    f = open_and_check(path, CACHE_KIND_SPECTROGRAM, &header);
+    if (!f) {
+        return CACHE_MISS;
+    }
+    spectrogram_ok = spectral_key_equal(&header.key, key);
+    fclose(f);
+
+    if (!spectrogram_ok) {
+        return CACHE_MISS;
+    }
+
+    /* 2. ¿El análisis guardado se hizo además con el mismo rango de BPM? */
+    cache_file_path(path, dir, CACHE_ANALYSIS_FILE);
+    f = open_and_check(path, CACHE_KIND_ANALYSIS, &header);
+    if (f) {
+        int analysis_ok = full_key_equal(&header.key, key);
+        fclose(f);
+        if (analysis_ok) {
+            return CACHE_HIT_FULL;
+        }
+    }
+
+    return CACHE_HIT_SPECTROGRAM;
+}
+
+int cache_store_spectrogram(const char *dir, const CacheKey *key, const float *mag,
+                            int n_frames, int n_bins) {
+    char path[MAX_PATH];
+    CacheHeader header;
+
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.kind = CACHE_KIND_SPECTROGRAM;
+    header.n_frames = n_frames;
+    header.n_bins = n_bins;
+    header.key = *key;
+
+    cache_file_path(path, dir, CACHE_SPEC_FILE);
+    return write_atomic(path, &header, mag, sizeof(float), (size_t)n_frames * n_bins, NULL, 0);
+}
+
+float *cache_load_spectrogram(const char *dir, const CacheKey *key, int n_frames, int n_bins) {
+    char path[MAX_PATH];
+    CacheHeader header;
+    FILE *f;
+    float *mag;
+    size_t count;
+
+    cache_file_path(path, dir, CACHE_SPEC_FILE);
+    f = open_and_check(path, CACHE_KIND_SPECTROGRAM, &header);
+    if (!f) {
+        return NULL;
+    }
+
+    if (!spectral_key_equal(&header.key, key) ||
+        header.n_frames != n_frames || header.n_bins != n_bins) {
+        fclose(f);
+        return NULL;
+    }
+
+    count = (size_t)n_frames * n_bins;
+    mag = malloc(count * sizeof(float));
+    if (!mag) {
+        fclose(f);
+        return NULL;
+    }
+
+    if (fread(mag, sizeof(float), count, f) != count) {
+        fprintf(stderr, "cache: %s está incompleto\n", path);
+        free(mag);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+    return mag;
+}
+
+int cache_store_analysis(const char *dir, const CacheKey *key, const AnalysisResults *results) {
+    char path[MAX_PATH];
+    CacheHeader header;
+
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.kind = CACHE_KIND_ANALYSIS;
+    header.n_frames = results->num_frames;
+    header.n_bins = 0;
+    header.key = *key;
+
+    cache_file_path(path, dir, CACHE_ANALYSIS_FILE);
+    return write_atomic(path, &header, results->onset_flux_curve, sizeof(float),
+                        (size_t)results->num_frames,
+                        &results->bpm_estimado, sizeof(float));
+}
+
+AnalysisResults *cache_load_analysis(const char *dir, const CacheKey *key) {
+    char path[MAX_PATH];
+    CacheHeader header;
+    FILE *f;
+    AnalysisResults *results;
+
+    cache_file_path(path, dir, CACHE_ANALYSIS_FILE);
+    f = open_and_check(path, CACHE_KIND_ANALYSIS, &header);
+    if (!f) {
+        return NULL;
+    }
+
+    if (!full_key_equal(&header.key, key) || header.n_frames <= 0) {
+        fclose(f);
+        return NULL;
+    }
+
+    results = malloc(sizeof(AnalysisResults));
+    if (!results) {
+        fclose(f);
+        return NULL;
+    }
+    results->num_frames = header.n_frames;
+    results->onset_flux_curve = malloc(header.n_frames * sizeof(float));
+
+    if (!results->onset_flux_curve ||
+        fread(&results->bpm_estimado, sizeof(float), 1, f) != 1 ||
+        fread(results->onset_flux_curve, sizeof(float), header.n_frames, f) != (size_t)header.n_frames) {
+        fprintf(stderr, "cache: %s está incompleto\n", path);
+        free_analysis_results(results);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+    return results;
+}
@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "band.h"
+
+void config_init_defaults(Config *cfg) {
+    cfg->fs = DEFAULT_FS;
+    cfg->N = DEFAULT_N;
+    cfg->hop = DEFAULT_HOP;
+    cfg->wtype = WIN_HANN;
+    cfg->bpm_min = DEFAULT_BPM_MIN;
+    cfg->bpm_max = DEFAULT_BPM_MAX;
+    cfg->use_cache = 1;
+    cfg->schedule = SCHED_CYCLIC;
+    cfg->chunk_min = DEFAULT_CHUNK_MIN;
+    cfg->band_lo_hz = 0.0f;
+    cfg->band_hi_hz = 0.0f;
+    cfg->bin_lo = 0;
+    cfg->bin_hi = STFT_NBINS(DEFAULT_N) - 1;
+    cfg->tempogram = 0;
+    cfg->tempo_window_s = DEFAULT_TEMPO_WINDOW;
+    cfg->tempo_hop_s = DEFAULT_TEMPO_HOP;
+    cfg->pyramid_levels = 0;
+    cfg->resynth = 0;
+    cfg->modulation = 0;
+    cfg->cqt = 0;
+    cfg->stereo = STEREO_OFF;
+    cfg->fft_kernel = FFT_KERNEL_RADIX4;
+    cfg->block_frames = DEFAULT_BLOCK_FRAMES;
+    cfg->tune = 0;
+    strcpy(cfg->wisdom_path, DEFAULT_WISDOM_PATH);
+    cfg->cqt_bins = DEFAULT_CQT_BINS;
+    cfg->cqt_f_min = DEFAULT_CQT_FMIN;
+    cfg->gain_mask[0] = '\0';
+    cfg->affinity = 0;
+    cfg->huge_pages = 0;
+    cfg->profile = 0;
+    cfg->gather = GATHER_AUTO;
+    cfg->node_size = 0;
+    cfg->serve_path[0] = '\0';
+    cfg->batch_list[0] = '\0';
+    cfg->store_dir[0] = '\0';
+    cfg->query_bpm_lo = 0.0f;
+    cfg->query_bpm_hi = 0.0f;
+    cfg->lookup_path[0] = '\0';
+}
+
+/* Lee el valor entero de una opción "--nombre valor" */
+static int parse_int_option(int argc, char *argv[], int *i, int *value) {
+    char *end;
+    long v;
+
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "Error: la opcion %s requiere un valor\n", argv[*i]);
+        return -1;
+    }
+
+    v = strtol(argv[*i + 1], &end, 10);
+    if (*end != '\0') {
+        fprintf(stderr, "Error: valor invalido para %s: %s\n", argv[*i], argv[*i + 1]);
+        return -1;
+    }
+
+    *value = (int)v;
+    (*i)++;
+    return 0;
+}
+
+/* Lee el valor real de una opción "--nombre valor" */
+static int parse_float_option(int argc, char *argv[], int *i, float *value) {
+    char *end;
+    double v;
+
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "Error: la opcion %s requiere un valor\n", argv[*i]);
+        return -1;
+    }
+
+    v = strtod(argv[*i + 1], &end);
+    if (*end != '\0') {
+        fprintf(stderr, "Error: valor invalido para %s: %s\n", argv[*i], argv[*i + 1]);
+        return -1;
+    }
+
+    *value = (float)v;
+    (*i)++;
+    return 0;
+}
+
+int config_parse_args(Config *cfg, int argc, char *argv[]) {
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bpm-min") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->bpm_min) != 0) return -1;
+        } else if (strcmp(argv[i], "--bpm-max") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->bpm_max) != 0) return -1;
+        } else if (strcmp(argv[i], "--N") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->N) != 0) return -1;
+        } else if (strcmp(argv[i], "--hop") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->hop) != 0) return -1;
+        } else if (strcmp(argv[i], "--f-lo") == 0) {
+            if (parse_float_option(argc, argv, &i, &cfg->band_lo_hz) != 0) return -1;
+        } else if (strcmp(argv[i], "--f-hi") == 0) {
+            if (parse_float_option(argc, argv, &i, &cfg->band_hi_hz) != 0) return -1;
+        } else if (strcmp(argv[i], "--tempogram") == 0) {
+            cfg->tempogram = 1;
+        } else if (strcmp(argv[i], "--tempo-window") == 0) {
+            if (parse_float_option(argc, argv, &i, &cfg->tempo_window_s) != 0) return -1;
+            cfg->tempogram = 1;
+        } else if (strcmp(argv[i], "--tempo-hop") == 0) {
+            if (parse_float_option(argc, argv, &i, &cfg->tempo_hop_s) != 0) return -1;
+            cfg->tempogram = 1;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            cfg->use_cache = 0;
+        } else if (strcmp(argv[i], "--schedule") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: la opcion --schedule requiere un valor\n");
+                return -1;
+            }
+            i++;
+            if (strcmp(argv[i], "cyclic") == 0) {
+                cfg->schedule = SCHED_CYCLIC;
+            } else if (strcmp(argv[i], "dynamic") == 0) {
+                cfg->schedule = SCHED_DYNAMIC;
+            } else if (strcmp(argv[i], "block") == 0) {
+                cfg->schedule = SCHED_BLOCK;
+            } else {
+                fprintf(stderr, "Error: distribucion desconocida %s (cyclic|dynamic|block)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--stereo") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: la opcion --stereo requiere un valor\n");
+                return -1;
+            }
+            i++;
+            if (strcmp(argv[i], "lr") == 0) {
+                cfg->stereo = STEREO_LR;
+            } else if (strcmp(argv[i], "ms") == 0) {
+                cfg->stereo = STEREO_MS;
+            } else {
+                fprintf(stderr, "Error: modo estereo desconocido %s (lr|ms)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--block") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->block_frames) != 0) return -1;
+        } else if (strcmp(argv[i], "--fft-kernel") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: la opcion --fft-kernel requiere un valor\n");
+                return -1;
+            }
+            i++;
+            if (strcmp(argv[i], "radix4") == 0) {
+                cfg->fft_kernel = FFT_KERNEL_RADIX4;
+            } else if (strcmp(argv[i], "radix2") == 0) {
+                cfg->fft_kernel = FFT_KERNEL_RADIX2;
+            } else if (strcmp(argv[i], "inplace") == 0) {
+                cfg->fft_kernel = FFT_KERNEL_INPLACE;
+            } else {
+                fprintf(stderr, "Error: kernel de FFT desconocido %s (radix4|radix2|inplace)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--tune") == 0) {
+            cfg->tune = 1;
+        } else if (strcmp(argv[i], "--wisdom") == 0) {
+            if (i + 1 >= argc || strlen(argv[i + 1]) >= sizeof(cfg->wisdom_path)) {
+                fprintf(stderr, "Error: --wisdom requiere la ruta del archivo\n");
+                return -1;
+            }
+            strcpy(cfg->wisdom_path, argv[++i]);
+            cfg->tune = 1;
+        } else if (strcmp(argv[i], "--chunk-min") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->chunk_min) != 0) return -1;
+        } else if (strcmp(argv[i], "--pyramid") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->pyramid_levels) != 0) return -1;
+        } else if (strcmp(argv[i], "--resynth") == 0) {
+            cfg->resynth = 1;
+        } else if (strcmp(argv[i], "--modulation") == 0) {
+            cfg->modulation = 1;
+        } else if (strcmp(argv[i], "--cqt") == 0) {
+            cfg->cqt = 1;
+        } else if (strcmp(argv[i], "--cqt-bins") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->cqt_bins) != 0) return -1;
+            cfg->cqt = 1;
+        } else if (strcmp(argv[i], "--cqt-fmin") == 0) {
+            if (parse_float_option(argc, argv, &i, &cfg->cqt_f_min) != 0) return -1;
+            cfg->cqt = 1;
+        } else if (strcmp(argv[i], "--gain-mask") == 0) {
+            if (i + 1 >= argc || strlen(argv[i + 1]) >= sizeof(cfg->gain_mask)) {
+                fprintf(stderr, "Error: --gain-mask requiere la ruta de la mascara\n");
+                return -1;
+            }
+            strcpy(cfg->gain_mask, argv[++i]);
+            cfg->resynth = 1;
+        } else if (strcmp(argv[i], "--affinity") == 0) {
+            cfg->affinity = 1;
+        } else if (strcmp(argv[i], "--hugepages") == 0) {
+            cfg->huge_pages = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            cfg->profile = 1;
+        } else if (strcmp(argv[i], "--gather") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: la opcion --gather requiere un valor\n");
+                return -1;
+            }
+            i++;
+            if (strcmp(argv[i], "auto") == 0) {
+                cfg->gather = GATHER_AUTO;
+            } else if (strcmp(argv[i], "flat") == 0) {
+                cfg->gather = GATHER_FLAT;
+            } else if (strcmp(argv[i], "node") == 0) {
+                cfg->gather = GATHER_NODE;
+            } else {
+                fprintf(stderr, "Error: recoleccion desconocida %s (auto|flat|node)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--node-size") == 0) {
+            if (parse_int_option(argc, argv, &i, &cfg->node_size) != 0) return -1;
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            if (i + 1 >= argc || strlen(argv[i + 1]) >= sizeof(cfg->serve_path)) {
+                fprintf(stderr, "Error: --serve requiere la ruta del socket\n");
+                return -1;
+            }
+            strcpy(cfg->serve_path, argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            if (i + 1 >= argc || strlen(argv[i + 1]) >= sizeof(cfg->batch_list)) {
+                fprintf(stderr, "Error: --batch requiere la ruta de la lista de audios\n");
+                return -1;
+            }
+            strcpy(cfg->batch_list, argv[++i]);
+        } else if (strcmp(argv[i], "--store") == 0) {
+            if (i + 1 >= argc || strlen(argv[i + 1]) >= sizeof(cfg->store_dir)) {
+                fprintf(stderr, "Error: --store requiere el directorio del almacen\n");
+                return -1;
+            }
+            strcpy(cfg->store_dir, argv[++i]);
+        } else if (strcmp(argv[i], "--query-bpm") == 0) {
+            char* end;
+            double lo, hi = 0.0;
+
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --query-bpm requiere un rango <min>:<max>\n");
+                return -1;
+            }
+            lo = strtod(argv[++i], &end);
+            if (*end == ':') {
+                hi = strtod(end + 1, &end);
+            }
+            if (*end != '\0' || hi <= 0.0) {
+                fprintf(stderr, "Error: rango invalido para --query-bpm: %s (ej. 120:125)\n", argv[i]);
+                return -1;
+            }
+            cfg->query_bpm_lo = (float)lo;
+            cfg->query_bpm_hi = (float)hi;
+        } else if (strcmp(argv[i], "--lookup") == 0) {
+            if (i + 1 >= argc || strlen(argv[i + 1]) >= sizeof(cfg->lookup_path)) {
+                fprintf(stderr, "Error: --lookup requiere la ruta del audio\n");
+                return -1;
+            }
+            strcpy(cfg->lookup_path, argv[++i]);
+        } else {
+            fprintf(stderr, "Error: opcion desconocida %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    /* Validaciones básicas del rango de BPM */
+    if (cfg->bpm_min <= 0 || cfg->bpm_max <= cfg->bpm_min) {
+        fprintf(stderr, "Error: rango de BPM invalido (%d - %d)\n", cfg->bpm_min, cfg->bpm_max);
+        return -1;
+    }
+
+    /* La FFT acepta cualquier tamaño (mixed-radix/Bluestein), solo exigimos algo razonable */
+    if (cfg->N < 2 || cfg->hop < 1) {
+        fprintf(stderr, "Error: tamaño de ventana (%d) o hop (%d) invalido\n", cfg->N, cfg->hop);
+        return -1;
+    }
+
+    if (cfg->band_lo_hz < 0.0f || cfg->band_hi_hz < 0.0f ||
+        (cfg->band_hi_hz > 0.0f && cfg->band_hi_hz < cfg->band_lo_hz)) {
+        fprintf(stderr, "Error: banda invalida (%.1f - %.1f Hz)\n", cfg->band_lo_hz, cfg->band_hi_hz);
+        return -1;
+    }
+
+    if (cfg->tempo_window_s <= 0.0f || cfg->tempo_hop_s <= 0.0f) {
+        fprintf(stderr, "Error: ventana/avance del tempograma invalidos\n");
+        return -1;
+    }
+
+    if (cfg->serve_path[0] != '\0' && cfg->batch_list[0] != '\0') {
+        fprintf(stderr, "Error: --serve y --batch no se pueden combinar\n");
+        return -1;
+    }
+
+    if (cfg->pyramid_levels < 0 || cfg->pyramid_levels > MAX_PYRAMID_LEVELS) {
+        fprintf(stderr, "Error: --pyramid acepta entre 0 y %d niveles\n", MAX_PYRAMID_LEVELS);
+        return -1;
+    }
+
+    if (cfg->cqt_bins < 1 || cfg->cqt_bins > CQT_MAX_BINS || cfg->cqt_f_min <= 0.0f) {
+        fprintf(stderr, "Error: CQT invalida (1 a %d bins por octava, frecuencia minima > 0)\n",
+                CQT_MAX_BINS);
+        return -1;
+    }
+
+    if (cfg->stereo != STEREO_OFF && cfg->resynth) {
+        fprintf(stderr, "Error: --stereo y --resynth no se pueden combinar\n");
+        return -1;
+    }
+
+    if (cfg->chunk_min < 1) {
+        fprintf(stderr, "Error: --chunk-min debe ser al menos 1\n");
+        return -1;
+    }
+
+    if (cfg->block_frames < 1) {
+        fprintf(stderr, "Error: --block debe ser al menos 1\n");
+        return -1;
+    }
+
+    if (cfg->node_size < 0) {
+        fprintf(stderr, "Error: --node-size no puede ser negativo\n");
+        return -1;
+    }
+
+    if ((cfg->query_bpm_hi > 0.0f || cfg->lookup_path[0] != '\0') && cfg->store_dir[0] == '\0') {
+        fprintf(stderr, "Error: --query-bpm y --lookup requieren --store <directorio>\n");
+        return -1;
+    }
+
+    if (cfg->query_bpm_hi != 0.0f && (cfg->query_bpm_lo < 0.0f || cfg->query_bpm_hi < cfg->query_bpm_lo)) {
+        fprintf(stderr, "Error: rango de --query-bpm invalido (%.2f - %.2f)\n",
+                cfg->query_bpm_lo, cfg->query_bpm_hi);
+        return -1;
+    }
+
+    /* Con el almacén los resultados no van a results/<track>/, donde vive la cache */
+    if (cfg->store_dir[0] != '\0') {
+        cfg->use_cache = 0;
+    }
+
+    return 0;
+}
+
+int config_resolve_band(Config *cfg) {
+    if (cfg->band_lo_hz <= 0.0f && cfg->band_hi_hz <= 0.0f) {
+        cfg->bin_lo = 0;
+        cfg->bin_hi = STFT_NBINS(cfg->N) - 1;
+        return 0;
+    }
+
+    if (band_bins_from_hz(cfg->N, cfg->fs, cfg->band_lo_hz, cfg->band_hi_hz,
+                          &cfg->bin_lo, &cfg->bin_hi) != 0) {
+        return -1;
+    }
+    return 1;
+}
+
+void config_print_usage(const char *prog) {
+    printf("Uso: mpirun -np <procesos> %s [opciones]\n", prog);
+    printf("  --N <muestras>    Tamaño de ventana, cualquier valor (default %d)\n", DEFAULT_N);
+    printf("  --hop <muestras>  Avance entre ventanas (default %d)\n", DEFAULT_HOP);
+    printf("  --f-lo <Hz>       Frecuencia minima a calcular (banda limitada)\n");
+    printf("  --f-hi <Hz>       Frecuencia maxima a calcular (default Nyquist)\n");
+    printf("  --bpm-min <bpm>   BPM minimo de la busqueda (default %d)\n", DEFAULT_BPM_MIN);
+    printf("  --bpm-max <bpm>   BPM maximo de la busqueda (default %d)\n", DEFAULT_BPM_MAX);
+    printf("  --tempogram       Calcula el BPM por ventana (tempo variable)\n");
+    printf("  --tempo-window <s> Largo de ventana del tempograma (default %.0f s)\n", DEFAULT_TEMPO_WINDOW);
+    printf("  --tempo-hop <s>   Avance del tempograma (default %.0f s)\n", DEFAULT_TEMPO_HOP);
+    printf("  --pyramid <n>     Escribe ademas una piramide de n niveles (2x, 4x, ...) en tiles para visualizar\n");
+    printf("  --resynth         Vuelve al tiempo con una ISTFT distribuida y escribe resynth.wav\n");
+    printf("  --gain-mask <csv> Aplica una ganancia por frecuencia (frecuencia_hz,ganancia_db) antes de resintetizar\n");
+    printf("  --modulation      Espectro de modulacion de cada bin (como varia su energia en el tiempo)\n");
+    printf("  --cqt             Transformada Q constante (bins espaciados por octava) en cqt.csv\n");
+    printf("  --cqt-bins <n>    Bins por octava de la CQT (default %d)\n", DEFAULT_CQT_BINS);
+    printf("  --cqt-fmin <Hz>   Frecuencia del primer bin de la CQT (default %.2f)\n", DEFAULT_CQT_FMIN);
+    printf("  --stereo <modo>   Espectrogramas y flux por canal: lr (izquierdo/derecho) o ms (medio/lateral)\n");
+    printf("  --no-cache        Ignora la cache de resultados y recalcula todo\n");
+    printf("  --schedule <tipo> Distribucion de frames: cyclic (default), dynamic o block\n");
+    printf("  --block <n>       Frames por bloque con --schedule block (default %d)\n", DEFAULT_BLOCK_FRAMES);
+    printf("  --fft-kernel <k>  Variante de la FFT: radix4 (default), radix2 o inplace\n");
+    printf("  --tune            Elige kernel y distribucion midiendo en esta maquina (o del archivo wisdom)\n");
+    printf("  --wisdom <ruta>   Archivo wisdom del autotuner (default %s)\n", DEFAULT_WISDOM_PATH);
+    printf("  --chunk-min <n>   Bloque minimo de frames en la distribucion dinamica (default %d)\n", DEFAULT_CHUNK_MIN);
+    printf("  --affinity        Fija cada proceso a un core (ordenados por nodo NUMA) y reporta la ubicacion\n");
+    printf("  --hugepages       Buffers de trabajo en paginas enormes (MAP_HUGETLB o THP si no hay reservadas)\n");
+    printf("  --profile         Contadores de hardware por etapa (IPC, fallos de cache y de salto, bytes/FLOP)\n");
+    printf("  --gather <modo>   Recoleccion hacia rank 0: auto (default), flat o node (dos niveles por nodo)\n");
+    printf("  --node-size <n>   Agrupa de a n procesos consecutivos como un nodo (default: memoria compartida)\n");
+    printf("  --batch <lista>   Modo lote: analiza toda la lista, varios archivos a la vez\n");
+    printf("  --serve <socket>  Modo servicio: atiende trabajos por un socket Unix sin relanzar MPI\n");
+    printf("  --store <dir>     Guarda BPM, confianza y flux en un almacen binario indexado (sin CSV por track)\n");
+    printf("  --query-bpm <a>:<b> Lista los tracks del almacen con BPM entre a y b\n");
+    printf("  --lookup <ruta>   Muestra el resultado guardado de un audio y su curva de flux\n");
+}
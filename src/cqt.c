@@ -0,0 +1,291 @@
+/* src/cqt.c */
+#include "cqt.h"
+#include "fft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Coeficientes del kernel por debajo de esta fracción del pico del bin se descartan */
+#define CQT_SPARSITY 0.0054f
+
+/* Filtro de media banda para decimar por 2 (impar; la mitad de los coeficientes son 0) */
+#define CQT_DECIMATION_TAPS 63
+
+/* Frecuencia más alta de la octava de arriba, relativa a fs (margen para el filtro) */
+#define CQT_MAX_RELATIVE_FREQ 0.4
+
+struct CqtKernel {
+    int fs;
+    int bins_per_octave;
+    float f_min;
+    int n_octaves;
+    int fft_size;       /* potencia de 2 que contiene el kernel más largo de la octava */
+    int* start;         /* coeficientes del bin b: [start[b], start[b + 1]) */
+    int* index;         /* bin de la FFT de cada coeficiente */
+    float* k_re;        /* conj(kernel) / fft_size, parte real */
+    float* k_im;        /* conj(kernel) / fft_size, parte imaginaria */
+    float* re;          /* buffers de un frame (fft_size) */
+    float* im;
+    float decimation[CQT_DECIMATION_TAPS];
+};
+
+int cqt_octaves(int fs, float f_min) {
+    int n = 0;
+
+    if (f_min <= 0.0f) return 0;
+    while (f_min * pow(2.0, n + 1) <= CQT_MAX_RELATIVE_FREQ * fs) {
+        n++;
+    }
+    return n;
+}
+
+void cqt_kernel_destroy(CqtKernel* kernel) {
+    if (!kernel) return;
+    free(kernel->start);
+    free(kernel->index);
+    free(kernel->k_re);
+    free(kernel->k_im);
+    free(kernel->re);
+    free(kernel->im);
+    free(kernel);
+}
+
+/* Sinc con ventana Blackman, corte en fs / 4: pasa lo que la octava de abajo necesita */
+static void design_decimation_filter(float* h) {
+    int center = CQT_DECIMATION_TAPS / 2, t;
+    double sum = 0.0;
+
+    for (t = 0; t < CQT_DECIMATION_TAPS; t++) {
+        int n = t - center;
+        double sinc = (n == 0) ? 0.5 : sin(0.5 * M_PI * n) / (M_PI * n);
+        double w = 0.42 - 0.5 * cos(2.0 * M_PI * t / (CQT_DECIMATION_TAPS - 1)) +
+                   0.08 * cos(4.0 * M_PI * t / (CQT_DECIMATION_TAPS - 1));
+        h[t] = (float)(sinc * w);
+        sum += h[t];
+    }
+    for (t = 0; t < CQT_DECIMATION_TAPS; t++) {
+        h[t] = (float)(h[t] / sum);
+    }
+}
+
+CqtKernel* cqt_kernel_create(int fs, int bins_per_octave, float f_min) {
+    CqtKernel* kernel;
+    double q = 1.0 / (pow(2.0, 1.0 / bins_per_octave) - 1.0);
+    double f_top;
+    int longest, capacity, used = 0, b, j, n;
+
+    if (bins_per_octave < 1 || cqt_octaves(fs, f_min) < 1) {
+        return NULL;
+    }
+
+    kernel = calloc(1, sizeof(CqtKernel));
+    if (!kernel) return NULL;
+
+    kernel->fs = fs;
+    kernel->bins_per_octave = bins_per_octave;
+    kernel->f_min = f_min;
+    kernel->n_octaves = cqt_octaves(fs, f_min);
+    design_decimation_filter(kernel->decimation);
+
+    /* La octava de arriba se calcula a fs; su primer bin tiene el kernel más largo */
+    f_top = f_min * pow(2.0, kernel->n_octaves - 1);
+    longest = (int)ceil(q * fs / f_top);
+    kernel->fft_size = 1;
+    while (kernel->fft_size < longest) {
+        kernel->fft_size *= 2;
+    }
+
+    capacity = bins_per_octave * kernel->fft_size;
+    kernel->start = malloc((bins_per_octave + 1) * sizeof(int));
+    kernel->index = malloc(capacity * sizeof(int));
+    kernel->k_re = malloc(capacity * sizeof(float));
+    kernel->k_im = malloc(capacity * sizeof(float));
+    kernel->re = malloc(kernel->fft_size * sizeof(float));
+    kernel->im = malloc(kernel->fft_size * sizeof(float));
+    if (!kernel->start || !kernel->index || !kernel->k_re || !kernel->k_im ||
+        !kernel->re || !kernel->im) {
+        cqt_kernel_destroy(kernel);
+        return NULL;
+    }
+
+    for (b = 0; b < bins_per_octave; b++) {
+        double freq = f_top * pow(2.0, (double)b / bins_per_octave);
+        int len = (int)ceil(q * fs / freq);
+        int offset = kernel->fft_size / 2 - len / 2;
+        double w_sum = 0.0;
+        float peak = 0.0f;
+
+        if (len > kernel->fft_size) len = kernel->fft_size;
+        if (len < 2) len = 2;
+
+        /* Sinusoide compleja con ventana Hann, centrada en el medio del buffer */
+        for (j = 0; j < kernel->fft_size; j++) {
+            kernel->re[j] = 0.0f;
+            kernel->im[j] = 0.0f;
+        }
+        for (n = 0; n < len; n++) {
+            w_sum += 0.5 * (1.0 - cos(2.0 * M_PI * n / (len - 1)));
+        }
+        for (n = 0; n < len; n++) {
+            double w = 0.5 * (1.0 - cos(2.0 * M_PI * n / (len - 1))) / w_sum;
+            double phase = 2.0 * M_PI * freq * (n - len / 2) / fs;
+            kernel->re[offset + n] = (float)(w * cos(phase));
+            kernel->im[offset + n] = (float)(w * sin(phase));
+        }
+
+        fft_inplace(kernel->re, kernel->im, kernel->fft_size);
+
+        /* Solo quedan los coeficientes cerca de la frecuencia del bin */
+        for (j = 0; j < kernel->fft_size; j++) {
+            float mag = (float)sqrt(kernel->re[j] * kernel->re[j] + kernel->im[j] * kernel->im[j]);
+            if (mag > peak) peak = mag;
+        }
+
+        kernel->start[b] = used;
+        for (j = 0; j < kernel->fft_size; j++) {
+            float mag = (float)sqrt(kernel->re[j] * kernel->re[j] + kernel->im[j] * kernel->im[j]);
+            if (mag >= CQT_SPARSITY * peak) {
+                kernel->index[used] = j;
+                kernel->k_re[used] = kernel->re[j] / kernel->fft_size;
+                kernel->k_im[used] = -kernel->im[j] / kernel->fft_size;
+                used++;
+            }
+        }
+    }
+    kernel->start[bins_per_octave] = used;
+
+    return kernel;
+}
+
+int cqt_kernel_matches(const CqtKernel* kernel, int fs, int bins_per_octave, float f_min) {
+    return kernel->fs == fs && kernel->bins_per_octave == bins_per_octave && kernel->f_min == f_min;
+}
+
+int cqt_n_bins(const CqtKernel* kernel) {
+    return kernel->n_octaves * kernel->bins_per_octave;
+}
+
+float cqt_bin_frequency(const CqtKernel* kernel, int k) {
+    return (float)(kernel->f_min * pow(2.0, (double)k / kernel->bins_per_octave));
+}
+
+/* Filtra y se queda con una muestra de cada dos (fase cero: out[i] corresponde a in[2i]).
+   Los coeficientes pares fuera del centro del filtro de media banda son 0: se saltean */
+static void decimate(const float* in, int len, const float* h, float* out) {
+    int center = CQT_DECIMATION_TAPS / 2, out_len = (len + 1) / 2, i, t;
+
+    for (i = 0; i < out_len; i++) {
+        int n0 = 2 * i - center;
+        float acc = h[center] * in[2 * i];
+
+        if (n0 >= 0 && n0 + CQT_DECIMATION_TAPS <= len) {
+            for (t = (center & 1) ? 0 : 1; t < CQT_DECIMATION_TAPS; t += 2) {
+                acc += h[t] * in[n0 + t];
+            }
+        } else {
+            for (t = (center & 1) ? 0 : 1; t < CQT_DECIMATION_TAPS; t += 2) {
+                if (n0 + t >= 0 && n0 + t < len) acc += h[t] * in[n0 + t];
+            }
+        }
+        out[i] = acc;
+    }
+}
+
+int cqt_compute_cyclic(CqtKernel* kernel, const float* samples, int n_samples, int rank,
+                       int procs_number, int n_frames, const Config* cfg, float* cq_local) {
+    int B = kernel->bins_per_octave, n_cq = cqt_n_bins(kernel), size = kernel->fft_size;
+    float** levels;
+    int* lengths;
+    int d, f, b, j, local = 0;
+
+    levels = malloc(kernel->n_octaves * sizeof(float*));
+    lengths = malloc(kernel->n_octaves * sizeof(int));
+    if (!levels || !lengths) {
+        free(levels);
+        free(lengths);
+        return -1;
+    }
+
+    /* 1. Señal decimada por octava: nivel d a fs / 2^d (el nivel 0 es la señal original) */
+    levels[0] = (float*)samples;
+    lengths[0] = n_samples;
+    for (d = 1; d < kernel->n_octaves; d++) {
+        lengths[d] = (lengths[d - 1] + 1) / 2;
+        levels[d] = malloc(((size_t)lengths[d] + 1) * sizeof(float));
+        if (!levels[d]) {
+            while (--d > 0) free(levels[d]);
+            free(levels);
+            free(lengths);
+            return -1;
+        }
+        decimate(levels[d - 1], lengths[d - 1], kernel->decimation, levels[d]);
+    }
+
+    /* 2. Frames propios (distribución cíclica): una FFT chica por octava y kernels ralos */
+    for (f = rank; f < n_frames; f += procs_number) {
+        float* out = cq_local + (size_t)local * n_cq;
+        long center = (long)f * cfg->hop + cfg->N / 2;
+
+        for (d = 0; d < kernel->n_octaves; d++) {
+            /* El nivel d da la octava d-ésima contando desde arriba */
+            int octave = kernel->n_octaves - 1 - d;
+            long first = (center >> d) - size / 2;
+
+            for (j = 0; j < size; j++) {
+                long n = first + j;
+                kernel->re[j] = (n >= 0 && n < lengths[d]) ? levels[d][n] : 0.0f;
+                kernel->im[j] = 0.0f;
+            }
+            fft_inplace(kernel->re, kernel->im, size);
+
+            for (b = 0; b < B; b++) {
+                double acc_re = 0.0, acc_im = 0.0;
+                int c;
+                for (c = kernel->start[b]; c < kernel->start[b + 1]; c++) {
+                    float xr = kernel->re[kernel->index[c]], xi = kernel->im[kernel->index[c]];
+                    acc_re += xr * kernel->k_re[c] - xi * kernel->k_im[c];
+                    acc_im += xr * kernel->k_im[c] + xi * kernel->k_re[c];
+                }
+                out[octave * B + b] = (float)sqrt(acc_re * acc_re + acc_im * acc_im);
+            }
+        }
+        local++;
+    }
+
+    for (d = 1; d < kernel->n_octaves; d++) {
+        free(levels[d]);
+    }
+    free(levels);
+    free(lengths);
+    return 0;
+}
+
+int write_cqt_csv(const char* filename, const float* cq, int n_frames, const CqtKernel* kernel) {
+    FILE* f = fopen(filename, "w");
+    int n_cq = cqt_n_bins(kernel), i, k;
+
+    if (!f) {
+        perror(filename);
+        return -1;
+    }
+
+    for (k = 0; k < n_cq; k++) {
+        fprintf(f, "%s%.2f", k == 0 ? "" : ",", cqt_bin_frequency(kernel, k));
+    }
+    fprintf(f, "\n");
+
+    for (i = 0; i < n_frames; i++) {
+        for (k = 0; k < n_cq; k++) {
+            fprintf(f, "%s%.6f", k == 0 ? "" : ",", cq[(size_t)i * n_cq + k]);
+        }
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+    return 0;
+}
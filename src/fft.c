@@ -1,4 +1,6 @@
 #include "fft.h"
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 /* Si M_PI no está definido */
@@ -48,12 +50,12 @@ static void bitrev(float *re, float *im, int n){
 }
 
 /**
- * alcula la Transformada Rápida de Fourier (FFT) "in-place".
+ * Calcula la Transformada Rápida de Fourier (FFT) Radix-2 "in-place".
  * @param re Array de partes reales (entrada/salida).
  * @param im Array de partes imaginarias (entrada/salida).
  * @param n  Número de muestras (debe ser potencia de 2).
  */
-void fft_inplace(float *re, float *im, int n){
+static void fft_radix2_inplace(float *re, float *im, int n){
     int len, i, j, half;
     float ang, c, s, wr, wi, ur, ui, tr, ti, tmp;
 
@@ -108,6 +110,485 @@ void fft_inplace(float *re, float *im, int n){
     }
 }
 
+/* ------------------------------------------------------------------------- */
+/* FFT de tamaño arbitrario: Stockham mixed-radix + Bluestein                 */
+/* ------------------------------------------------------------------------- */
+
+#define FFT_MAX_FACTORS 32   /* alcanza para cualquier n de 32 bits */
+#define FFT_MAX_RADIX 13     /* primo más grande que se resuelve con una etapa directa */
+
+struct FFTPlan {
+    int n;
+    int inplace;                     /* 1 = radix-2 in-place con bit-reversal (sin etapas) */
+    int n_factors;
+    int factors[FFT_MAX_FACTORS];
+    float *tw_re[FFT_MAX_FACTORS];   /* twiddles de cada etapa: m * (r-1) */
+    float *tw_im[FFT_MAX_FACTORS];
+    float *root_re[FFT_MAX_FACTORS]; /* raíces de la DFT de r puntos (solo etapas genéricas) */
+    float *root_im[FFT_MAX_FACTORS];
+    float *work_re, *work_im;        /* buffer ping-pong de tamaño n */
+
+    /* Bluestein (solo si n tiene un factor primo > FFT_MAX_RADIX) */
+    FFTPlan *sub;                    /* FFT potencia de 2 de tamaño m >= 2n-1 */
+    int m;
+    float *chirp_re, *chirp_im;      /* w_k = exp(-i*pi*k^2/n) */
+    float *kernel_re, *kernel_im;    /* FFT de conj(w) extendido circularmente */
+    float *buf_re, *buf_im;          /* buffers de tamaño m */
+};
+
+static int is_power_of_two(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+/**
+ * Etapa de Stockham (auto-ordenada, decimación en frecuencia) de radix r.
+ * Para cada p < m = n_cur/r y cada q < s toma a_j = x[q + s*(p + j*m)] y escribe
+ * y[q + s*(r*p + k)] = DFT_r(a)_k * W_{n_cur}^{p*k}. Después de todas las etapas
+ * la salida queda en orden natural sin bit-reversal.
+ */
+static void stage_r2(int n_cur, int s, const float *xr, const float *xi,
+                     float *yr, float *yi, const float *twr, const float *twi) {
+    int m = n_cur / 2, p, q;
+
+    for (p = 0; p < m; p++) {
+        float wr = twr[p], wi = twi[p];
+        const float *x0r = xr + s * p, *x0i = xi + s * p;
+        const float *x1r = xr + s * (p + m), *x1i = xi + s * (p + m);
+        float *y0r = yr + s * 2 * p, *y0i = yi + s * 2 * p;
+        float *y1r = y0r + s, *y1i = y0i + s;
+
+        for (q = 0; q < s; q++) {
+            float ar = x0r[q], ai = x0i[q];
+            float br = x1r[q], bi = x1i[q];
+            float dr = ar - br, di = ai - bi;
+            y0r[q] = ar + br;
+            y0i[q] = ai + bi;
+            y1r[q] = dr * wr - di * wi;
+            y1i[q] = dr * wi + di * wr;
+        }
+    }
+}
+
+static void stage_r3(int n_cur, int s, const float *xr, const float *xi,
+                     float *yr, float *yi, const float *twr, const float *twi) {
+    const float h = 0.86602540378443864676f; /* sin(2*pi/3) */
+    int m = n_cur / 3, p, q;
+
+    for (p = 0; p < m; p++) {
+        float w1r = twr[2 * p], w1i = twi[2 * p];
+        float w2r = twr[2 * p + 1], w2i = twi[2 * p + 1];
+
+        for (q = 0; q < s; q++) {
+            int i0 = q + s * p, i1 = i0 + s * m, i2 = i1 + s * m;
+            int o = q + s * 3 * p;
+            float tr = xr[i1] + xr[i2], ti = xi[i1] + xi[i2];
+            float cr = xr[i0] - 0.5f * tr, ci = xi[i0] - 0.5f * ti;
+            float dr = h * (xr[i1] - xr[i2]), di = h * (xi[i1] - xi[i2]);
+            /* y1 = c - i*d ; y2 = c + i*d */
+            float y1r = cr + di, y1i = ci - dr;
+            float y2r = cr - di, y2i = ci + dr;
+
+            yr[o] = xr[i0] + tr;
+            yi[o] = xi[i0] + ti;
+            yr[o + s] = y1r * w1r - y1i * w1i;
+            yi[o + s] = y1r * w1i + y1i * w1r;
+            yr[o + 2 * s] = y2r * w2r - y2i * w2i;
+            yi[o + 2 * s] = y2r * w2i + y2i * w2r;
+        }
+    }
+}
+
+static void stage_r4(int n_cur, int s, const float *xr, const float *xi,
+                     float *yr, float *yi, const float *twr, const float *twi) {
+    int m = n_cur / 4, p, q;
+
+    for (p = 0; p < m; p++) {
+        float w1r = twr[3 * p], w1i = twi[3 * p];
+        float w2r = twr[3 * p + 1], w2i = twi[3 * p + 1];
+        float w3r = twr[3 * p + 2], w3i = twi[3 * p + 2];
+
+        for (q = 0; q < s; q++) {
+            int i0 = q + s * p, i1 = i0 + s * m, i2 = i1 + s * m, i3 = i2 + s * m;
+            int o = q + s * 4 * p;
+            float s02r = xr[i0] + xr[i2], s02i = xi[i0] + xi[i2];
+            float d02r = xr[i0] - xr[i2], d02i = xi[i0] - xi[i2];
+            float s13r = xr[i1] + xr[i3], s13i = xi[i1] + xi[i3];
+            float d13r = xr[i1] - xr[i3], d13i = xi[i1] - xi[i3];
+            /* y1 = d02 - i*d13 ; y3 = d02 + i*d13 */
+            float y1r = d02r + d13i, y1i = d02i - d13r;
+            float y2r = s02r - s13r, y2i = s02i - s13i;
+            float y3r = d02r - d13i, y3i = d02i + d13r;
+
+            yr[o] = s02r + s13r;
+            yi[o] = s02i + s13i;
+            yr[o + s] = y1r * w1r - y1i * w1i;
+            yi[o + s] = y1r * w1i + y1i * w1r;
+            yr[o + 2 * s] = y2r * w2r - y2i * w2i;
+            yi[o + 2 * s] = y2r * w2i + y2i * w2r;
+            yr[o + 3 * s] = y3r * w3r - y3i * w3i;
+            yi[o + 3 * s] = y3r * w3i + y3i * w3r;
+        }
+    }
+}
+
+static void stage_r5(int n_cur, int s, const float *xr, const float *xi,
+                     float *yr, float *yi, const float *twr, const float *twi) {
+    const float c1 = 0.30901699437494742410f;  /* cos(2*pi/5) */
+    const float c2 = -0.80901699437494742410f; /* cos(4*pi/5) */
+    const float s1 = 0.95105651629515357212f;  /* sin(2*pi/5) */
+    const float s2 = 0.58778525229247312917f;  /* sin(4*pi/5) */
+    int m = n_cur / 5, p, q, k;
+
+    for (p = 0; p < m; p++) {
+        const float *wr = twr + 4 * p, *wi = twi + 4 * p;
+
+        for (q = 0; q < s; q++) {
+            int i0 = q + s * p, i1 = i0 + s * m, i2 = i1 + s * m, i3 = i2 + s * m, i4 = i3 + s * m;
+            int o = q + s * 5 * p;
+            float b1r = xr[i1] + xr[i4], b1i = xi[i1] + xi[i4];
+            float b2r = xr[i2] + xr[i3], b2i = xi[i2] + xi[i3];
+            float d1r = xr[i1] - xr[i4], d1i = xi[i1] - xi[i4];
+            float d2r = xr[i2] - xr[i3], d2i = xi[i2] - xi[i3];
+            float ar = xr[i0] + c1 * b1r + c2 * b2r, ai = xi[i0] + c1 * b1i + c2 * b2i;
+            float br = xr[i0] + c2 * b1r + c1 * b2r, bi = xi[i0] + c2 * b1i + c1 * b2i;
+            float er = s1 * d1r + s2 * d2r, ei = s1 * d1i + s2 * d2i;
+            float fr = s2 * d1r - s1 * d2r, fi = s2 * d1i - s1 * d2i;
+            float outr[5], outi[5];
+
+            /* y1 = a - i*e ; y4 = a + i*e ; y2 = b - i*f ; y3 = b + i*f */
+            outr[1] = ar + ei; outi[1] = ai - er;
+            outr[4] = ar - ei; outi[4] = ai + er;
+            outr[2] = br + fi; outi[2] = bi - fr;
+            outr[3] = br - fi; outi[3] = bi + fr;
+
+            yr[o] = xr[i0] + b1r + b2r;
+            yi[o] = xi[i0] + b1i + b2i;
+            for (k = 1; k < 5; k++) {
+                yr[o + k * s] = outr[k] * wr[k - 1] - outi[k] * wi[k - 1];
+                yi[o + k * s] = outr[k] * wi[k - 1] + outi[k] * wr[k - 1];
+            }
+        }
+    }
+}
+
+/**
+ * Etapa genérica para primos chicos (7, 11, 13). Aprovecha la simetría de la DFT real:
+ * con b_j = a_j + a_{r-j} y d_j = a_j - a_{r-j}, las salidas k y r-k comparten
+ * A_k = a_0 + sum cos(2*pi*j*k/r) b_j  y  E_k = sum sin(2*pi*j*k/r) d_j:
+ * y_k = A_k - i*E_k,  y_{r-k} = A_k + i*E_k  (la mitad de multiplicaciones que la DFT directa).
+ */
+static void stage_generic(int r, int n_cur, int s, const float *xr, const float *xi,
+                          float *yr, float *yi, const float *twr, const float *twi,
+                          const float *wr_r, const float *wi_r) {
+    float br[FFT_MAX_RADIX], bi[FFT_MAX_RADIX], dr[FFT_MAX_RADIX], di[FFT_MAX_RADIX];
+    float outr[FFT_MAX_RADIX], outi[FFT_MAX_RADIX];
+    int m = n_cur / r, h = (r - 1) / 2, p, q, j, k;
+
+    for (p = 0; p < m; p++) {
+        const float *tr = twr + p * (r - 1), *ti = twi + p * (r - 1);
+
+        for (q = 0; q < s; q++) {
+            int i0 = q + s * p;
+            int o = q + s * r * p;
+            float a0r = xr[i0], a0i = xi[i0];
+            float sumr = a0r, sumi = a0i;
+
+            for (j = 1; j <= h; j++) {
+                int ij = i0 + s * j * m, irj = i0 + s * (r - j) * m;
+                br[j] = xr[ij] + xr[irj]; bi[j] = xi[ij] + xi[irj];
+                dr[j] = xr[ij] - xr[irj]; di[j] = xi[ij] - xi[irj];
+                sumr += br[j];
+                sumi += bi[j];
+            }
+
+            for (k = 1; k <= h; k++) {
+                float Ar = a0r, Ai = a0i, Er = 0.0f, Ei = 0.0f;
+                int idx = 0;
+                for (j = 1; j <= h; j++) {
+                    idx += k;
+                    if (idx >= r) idx -= r;
+                    /* wr_r = cos(2*pi*idx/r), wi_r = -sin(2*pi*idx/r) */
+                    Ar += wr_r[idx] * br[j]; Ai += wr_r[idx] * bi[j];
+                    Er -= wi_r[idx] * dr[j]; Ei -= wi_r[idx] * di[j];
+                }
+                outr[k] = Ar + Ei;     outi[k] = Ai - Er;
+                outr[r - k] = Ar - Ei; outi[r - k] = Ai + Er;
+            }
+
+            yr[o] = sumr;
+            yi[o] = sumi;
+            for (k = 1; k < r; k++) {
+                yr[o + k * s] = outr[k] * tr[k - 1] - outi[k] * ti[k - 1];
+                yi[o + k * s] = outr[k] * ti[k - 1] + outi[k] * tr[k - 1];
+            }
+        }
+    }
+}
+
+/* Descompone n en radices soportadas. Devuelve lo que no se pudo factorizar (1 si todo).
+   Con only_radix2 las potencias de 2 se resuelven en etapas de 2 en vez de 4. */
+static int factorize(int n, int *factors, int *n_factors, int only_radix2) {
+    static const int radices[] = {4, 2, 3, 5, 7, 11, 13};
+    int i;
+
+    *n_factors = 0;
+    for (i = only_radix2 ? 1 : 0; i < (int)(sizeof(radices) / sizeof(radices[0])); i++) {
+        while (n % radices[i] == 0 && n > 1) {
+            factors[(*n_factors)++] = radices[i];
+            n /= radices[i];
+        }
+    }
+    return n;
+}
+
+/* Libera todo lo que tenga el plan (tolera campos a NULL) */
+void fft_plan_destroy(FFTPlan* plan) {
+    int i;
+
+    if (!plan) return;
+    for (i = 0; i < plan->n_factors; i++) {
+        free(plan->tw_re[i]);
+        free(plan->tw_im[i]);
+        free(plan->root_re[i]);
+        free(plan->root_im[i]);
+    }
+    free(plan->work_re);
+    free(plan->work_im);
+    fft_plan_destroy(plan->sub);
+    free(plan->chirp_re);
+    free(plan->chirp_im);
+    free(plan->kernel_re);
+    free(plan->kernel_im);
+    free(plan->buf_re);
+    free(plan->buf_im);
+    free(plan);
+}
+
+/* Prepara el camino de Bluestein: chirp y kernel transformado */
+static int bluestein_init(FFTPlan* plan) {
+    int n = plan->n, m = 1, k;
+
+    while (m < 2 * n - 1) m <<= 1;
+    plan->m = m;
+
+    plan->sub = fft_plan_create(m);
+    plan->chirp_re = malloc(n * sizeof(float));
+    plan->chirp_im = malloc(n * sizeof(float));
+    plan->kernel_re = calloc(m, sizeof(float));
+    plan->kernel_im = calloc(m, sizeof(float));
+    plan->buf_re = malloc(m * sizeof(float));
+    plan->buf_im = malloc(m * sizeof(float));
+    if (!plan->sub || !plan->chirp_re || !plan->chirp_im || !plan->kernel_re ||
+        !plan->kernel_im || !plan->buf_re || !plan->buf_im) {
+        return -1;
+    }
+
+    for (k = 0; k < n; k++) {
+        /* k^2 mod 2n evita perder precisión en el ángulo para k grandes */
+        long k2 = ((long)k * k) % (2L * n);
+        double ang = M_PI * (double)k2 / (double)n;
+        plan->chirp_re[k] = (float)cos(ang);
+        plan->chirp_im[k] = (float)-sin(ang);
+    }
+
+    /* Kernel b_k = conj(w_k), extendido circularmente (b_{m-k} = b_k) */
+    plan->kernel_re[0] = plan->chirp_re[0];
+    plan->kernel_im[0] = -plan->chirp_im[0];
+    for (k = 1; k < n; k++) {
+        plan->kernel_re[k] = plan->kernel_re[m - k] = plan->chirp_re[k];
+        plan->kernel_im[k] = plan->kernel_im[m - k] = -plan->chirp_im[k];
+    }
+    fft_execute(plan->sub, plan->kernel_re, plan->kernel_im);
+    return 0;
+}
+
+FFTPlan* fft_plan_create(int n) {
+    return fft_plan_create_kernel(n, FFT_KERNEL_RADIX4);
+}
+
+FFTPlan* fft_plan_create_kernel(int n, fft_kernel_t kernel) {
+    FFTPlan* plan;
+    int rest, f, n_cur, r, p, k;
+
+    if (n < 1) return NULL;
+
+    plan = calloc(1, sizeof(FFTPlan));
+    if (!plan) return NULL;
+    plan->n = n;
+
+    /* El radix-2 in-place no necesita twiddles precalculados ni buffer de trabajo */
+    if (kernel == FFT_KERNEL_INPLACE && is_power_of_two(n)) {
+        plan->inplace = 1;
+        return plan;
+    }
+
+    rest = factorize(n, plan->factors, &plan->n_factors, kernel == FFT_KERNEL_RADIX2);
+
+    /* Factor primo grande: Bluestein sobre una FFT potencia de 2 */
+    if (rest > 1) {
+        plan->n_factors = 0;
+        if (bluestein_init(plan) != 0) {
+            fft_plan_destroy(plan);
+            return NULL;
+        }
+        return plan;
+    }
+
+    plan->work_re = malloc(n * sizeof(float));
+    plan->work_im = malloc(n * sizeof(float));
+    if (!plan->work_re || !plan->work_im) {
+        fft_plan_destroy(plan);
+        return NULL;
+    }
+
+    /* Twiddles de cada etapa: W_{n_cur}^{p*k}, p < n_cur/r, 1 <= k < r (en double) */
+    n_cur = n;
+    for (f = 0; f < plan->n_factors; f++) {
+        int m;
+        r = plan->factors[f];
+        m = n_cur / r;
+
+        plan->tw_re[f] = malloc((size_t)m * (r - 1) * sizeof(float) + sizeof(float));
+        plan->tw_im[f] = malloc((size_t)m * (r - 1) * sizeof(float) + sizeof(float));
+        if (!plan->tw_re[f] || !plan->tw_im[f]) {
+            plan->n_factors = f + 1;
+            fft_plan_destroy(plan);
+            return NULL;
+        }
+
+        if (r > 5) {
+            plan->root_re[f] = malloc(r * sizeof(float));
+            plan->root_im[f] = malloc(r * sizeof(float));
+            if (!plan->root_re[f] || !plan->root_im[f]) {
+                plan->n_factors = f + 1;
+                fft_plan_destroy(plan);
+                return NULL;
+            }
+            for (k = 0; k < r; k++) {
+                plan->root_re[f][k] = (float)cos(-2.0 * M_PI * k / r);
+                plan->root_im[f][k] = (float)sin(-2.0 * M_PI * k / r);
+            }
+        }
+
+        for (p = 0; p < m; p++) {
+            for (k = 1; k < r; k++) {
+                double ang = -2.0 * M_PI * (double)p * k / (double)n_cur;
+                plan->tw_re[f][p * (r - 1) + k - 1] = (float)cos(ang);
+                plan->tw_im[f][p * (r - 1) + k - 1] = (float)sin(ang);
+            }
+        }
+        n_cur = m;
+    }
+
+    return plan;
+}
+
+int fft_plan_size(const FFTPlan* plan) {
+    return plan->n;
+}
+
+/* Bluestein: X_k = w_k * IFFT( FFT(x * w) . FFT(conj w) )_k */
+static void bluestein_execute(FFTPlan* plan, float* re, float* im) {
+    int n = plan->n, m = plan->m, k;
+    float *br = plan->buf_re, *bi = plan->buf_im;
+
+    for (k = 0; k < n; k++) {
+        br[k] = re[k] * plan->chirp_re[k] - im[k] * plan->chirp_im[k];
+        bi[k] = re[k] * plan->chirp_im[k] + im[k] * plan->chirp_re[k];
+    }
+    memset(br + n, 0, (m - n) * sizeof(float));
+    memset(bi + n, 0, (m - n) * sizeof(float));
+
+    fft_execute(plan->sub, br, bi);
+    for (k = 0; k < m; k++) {
+        float tr = br[k] * plan->kernel_re[k] - bi[k] * plan->kernel_im[k];
+        float ti = br[k] * plan->kernel_im[k] + bi[k] * plan->kernel_re[k];
+        br[k] = tr;
+        bi[k] = ti;
+    }
+    fft_execute_inverse(plan->sub, br, bi);
+
+    for (k = 0; k < n; k++) {
+        re[k] = br[k] * plan->chirp_re[k] - bi[k] * plan->chirp_im[k];
+        im[k] = br[k] * plan->chirp_im[k] + bi[k] * plan->chirp_re[k];
+    }
+}
+
+void fft_execute(FFTPlan* plan, float* re, float* im) {
+    float *xr = re, *xi = im, *yr = plan->work_re, *yi = plan->work_im, *t;
+    int f, n_cur = plan->n, s = 1;
+
+    if (plan->sub) {
+        bluestein_execute(plan, re, im);
+        return;
+    }
+    if (plan->inplace) {
+        fft_radix2_inplace(re, im, plan->n);
+        return;
+    }
+
+    /* Etapas ping-pong entre (re, im) y el buffer de trabajo */
+    for (f = 0; f < plan->n_factors; f++) {
+        int r = plan->factors[f];
+        const float *twr = plan->tw_re[f], *twi = plan->tw_im[f];
+
+        switch (r) {
+            case 2: stage_r2(n_cur, s, xr, xi, yr, yi, twr, twi); break;
+            case 3: stage_r3(n_cur, s, xr, xi, yr, yi, twr, twi); break;
+            case 4: stage_r4(n_cur, s, xr, xi, yr, yi, twr, twi); break;
+            case 5: stage_r5(n_cur, s, xr, xi, yr, yi, twr, twi); break;
+            default:
+                stage_generic(r, n_cur, s, xr, xi, yr, yi, twr, twi,
+                              plan->root_re[f], plan->root_im[f]);
+                break;
+        }
+
+        n_cur /= r;
+        s *= r;
+        t = xr; xr = yr; yr = t;
+        t = xi; xi = yi; yi = t;
+    }
+
+    /* Con una cantidad impar de etapas el resultado quedó en el buffer de trabajo */
+    if (xr != re) {
+        memcpy(re, xr, plan->n * sizeof(float));
+        memcpy(im, xi, plan->n * sizeof(float));
+    }
+}
+
+void fft_execute_inverse(FFTPlan* plan, float* re, float* im) {
+    int k, n = plan->n;
+    float inv_n = 1.0f / (float)n;
+
+    /* Misma propiedad que ifft_inplace: conj(FFT(conj(x))) / n */
+    for (k = 0; k < n; ++k) {
+        im[k] = -im[k];
+    }
+    fft_execute(plan, re, im);
+    for (k = 0; k < n; ++k) {
+        re[k] *= inv_n;
+        im[k] = -im[k] * inv_n;
+    }
+}
+
+/**
+ * Calcula la FFT "in-place" para cualquier n.
+ * Las potencias de 2 van por el Radix-2 de siempre; el resto arma un plan temporal
+ * (para transformar muchos bloques del mismo tamaño conviene fft_plan_create).
+ */
+void fft_inplace(float *re, float *im, int n){
+    FFTPlan *plan;
+
+    if (is_power_of_two(n)) {
+        fft_radix2_inplace(re, im, n);
+        return;
+    }
+
+    plan = fft_plan_create(n);
+    if (!plan) return;
+    fft_execute(plan, re, im);
+    fft_plan_destroy(plan);
+}
 
 /**
  * Calcula la FFT Inversa (IFFT) "in-place".
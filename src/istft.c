@@ -0,0 +1,206 @@
+/* src/istft.c */
+#include "istft.h"
+#include "fft.h"
+#include "window.h"
+#include "mpi_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <mpi.h>
+
+/* Máximo de puntos de una máscara de ganancia */
+#define GAIN_MASK_MAX_POINTS 1024
+
+int istft_block_frames(int n_frames, int procs_number, int N, int hop, int align) {
+    int min_frames = (N > hop) ? (N - hop + hop - 1) / hop : 1;
+    int block = (n_frames + procs_number - 1) / procs_number;
+
+    if (block < min_frames) block = min_frames;
+    if (block < 1) block = 1;
+    if (align > 1) block = ((block + align - 1) / align) * align;
+    return block;
+}
+
+int load_gain_mask(const char* path, int N, int fs, float* gain) {
+    double hz[GAIN_MASK_MAX_POINTS], db[GAIN_MASK_MAX_POINTS];
+    char line[256];
+    FILE* f = fopen(path, "r");
+    int n_points = 0, n_full = STFT_NBINS(N), k, p = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        char *s = line, *end;
+        double freq, level;
+
+        while (isspace((unsigned char)*s)) s++;
+        if (!isdigit((unsigned char)*s) && *s != '.') continue;
+
+        freq = strtod(s, &end);
+        while (isspace((unsigned char)*end)) end++;
+        if (*end != ',') continue;
+        level = strtod(end + 1, &s);
+        if (s == end + 1) continue;
+
+        if (n_points == GAIN_MASK_MAX_POINTS || (n_points > 0 && freq <= hz[n_points - 1])) {
+            fprintf(stderr, "Error: mascara %s: las frecuencias deben ser crecientes (max %d puntos)\n",
+                    path, GAIN_MASK_MAX_POINTS);
+            fclose(f);
+            return -1;
+        }
+        hz[n_points] = freq;
+        db[n_points] = level;
+        n_points++;
+    }
+    fclose(f);
+
+    if (n_points == 0) {
+        fprintf(stderr, "Error: la mascara %s no tiene puntos (frecuencia_hz,ganancia_db)\n", path);
+        return -1;
+    }
+
+    /* Interpolación lineal en dB sobre la frecuencia de cada bin */
+    for (k = 0; k < n_full; k++) {
+        double freq = (double)k * fs / N, level;
+
+        while (p + 1 < n_points && hz[p + 1] <= freq) p++;
+        if (freq <= hz[0]) {
+            level = db[0];
+        } else if (p + 1 >= n_points) {
+            level = db[n_points - 1];
+        } else {
+            level = db[p] + (db[p + 1] - db[p]) * (freq - hz[p]) / (hz[p + 1] - hz[p]);
+        }
+        gain[k] = (float)pow(10.0, level / 20.0);
+    }
+    return 0;
+}
+
+/* Suma de la ventana al cuadrado sobre todos los frames que cubren la muestra n */
+static double window_overlap(const float* window, int N, int hop, int n_frames, long n) {
+    long m_first = (n - N + 1 > 0) ? (n - N + 1 + hop - 1) / hop : 0;
+    long m_last = n / hop;
+    double sum = 0.0;
+    long m;
+
+    if (m_last > n_frames - 1) m_last = n_frames - 1;
+    for (m = m_first; m <= m_last; m++) {
+        float w = window[n - m * hop];
+        sum += (double)w * w;
+    }
+    return sum;
+}
+
+void istft_overlap_add(const float* spec_re, const float* spec_im, int first, int count,
+                       int n_frames, int n_samples, const float* gain, const Config* cfg,
+                       MPI_Comm comm, float* out) {
+    int N = cfg->N, hop = cfg->hop, n_full = STFT_NBINS(cfg->N);
+    int halo = (N > hop) ? N - hop : 0;
+    int rank, procs_number, prev, next, owned_len, f, k;
+    int *counts = NULL;
+    long region_start = (long)first * hop;
+    size_t region_len = (count > 0) ? (size_t)(count - 1) * hop + N : 0;
+    float *window, *re, *im, *region, *owned, *halo_in;
+    FFTPlan* plan;
+    size_t i;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    plan = fft_plan_create(N);
+    window = malloc(N * sizeof(float));
+    re = malloc(N * sizeof(float));
+    im = malloc(N * sizeof(float));
+    region = calloc(region_len + 1, sizeof(float));
+    halo_in = calloc(halo + 1, sizeof(float));
+    counts = malloc(procs_number * sizeof(int));
+    if (!plan || !window || !re || !im || !region || !halo_in || !counts) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la ISTFT\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* Ventana de síntesis = ventana de análisis (coeficientes: aplicarla sobre unos) */
+    for (k = 0; k < N; k++) {
+        window[k] = 1.0f;
+    }
+    window_apply(window, N, cfg->wtype);
+
+    /* 1. Cada frame: máscara, espectro completo (simetría conjugada) y FFT inversa */
+    for (f = 0; f < count; f++) {
+        const float* fr = spec_re + (size_t)f * n_full;
+        const float* fi = spec_im + (size_t)f * n_full;
+        float* dst = region + (size_t)f * hop;
+
+        for (k = 0; k < n_full; k++) {
+            float g = gain ? gain[k] : 1.0f;
+            re[k] = fr[k] * g;
+            im[k] = fi[k] * g;
+        }
+        for (k = n_full; k < N; k++) {
+            re[k] = re[N - k];
+            im[k] = -im[N - k];
+        }
+
+        fft_execute_inverse(plan, re, im);
+
+        /* 2. Ventana de síntesis y suma en la región propia */
+        for (k = 0; k < N; k++) {
+            dst[k] += re[k] * window[k];
+        }
+    }
+
+    /* 3. Vecinos: quién tiene frames (los bloques son contiguos desde rank 0) */
+    MPI_Allgather(&count, 1, MPI_INT, counts, 1, MPI_INT, comm);
+    prev = (count > 0 && rank > 0) ? rank - 1 : MPI_PROC_NULL;
+    next = (count > 0 && rank + 1 < procs_number && counts[rank + 1] > 0) ? rank + 1 : MPI_PROC_NULL;
+
+    /* 4. Halo: la cola (N - hop samples) va al siguiente, la del anterior se suma al comienzo */
+    MPI_Sendrecv(region + (size_t)count * hop, next != MPI_PROC_NULL ? halo : 0, MPI_FLOAT, next, 0,
+                 halo_in, prev != MPI_PROC_NULL ? halo : 0, MPI_FLOAT, prev, 0,
+                 comm, MPI_STATUS_IGNORE);
+    if (prev != MPI_PROC_NULL) {
+        for (k = 0; k < halo; k++) {
+            region[k] += halo_in[k];
+        }
+    }
+
+    /* 5. Región propia: hasta el primer frame del siguiente (el último llega hasta el final) */
+    if (count == 0) {
+        owned_len = 0;
+    } else if (next != MPI_PROC_NULL) {
+        owned_len = count * hop;
+    } else {
+        owned_len = n_samples - (int)region_start;
+    }
+
+    owned = malloc(((size_t)owned_len + 1) * sizeof(float));
+    if (!owned) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la ISTFT\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* Normalización por la suma de ventanas al cuadrado (reconstrucción exacta sin máscara) */
+    for (i = 0; i < (size_t)owned_len; i++) {
+        double norm = window_overlap(window, N, hop, n_frames, region_start + (long)i);
+        float value = (i < region_len) ? region[i] : 0.0f;
+        owned[i] = (norm > 1e-10) ? (float)(value / norm) : 0.0f;
+    }
+
+    /* 6. Rank 0 junta las regiones (ya están en orden temporal) */
+    gather_ordered(owned, owned_len, comm, out);
+
+    free(owned);
+    free(counts);
+    free(halo_in);
+    free(region);
+    free(im);
+    free(re);
+    free(window);
+    fft_plan_destroy(plan);
+}
@@ -0,0 +1,153 @@
+/* src/modulation.c */
+#include "modulation.h"
+#include "fft.h"
+#include "window.h"
+#include "mpi_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <mpi.h>
+
+/**
+ * @brief Espectro de modulación de una serie: promedio de |FFT| de los segmentos.
+ * @param out n_mod = segment / 2 + 1 magnitudes
+ */
+static void series_spectrum(const float* series, int n_frames, int segment, FFTPlan* plan,
+                            const float* window, float window_sum, float* re, float* im, float* out) {
+    int n_mod = segment / 2 + 1;
+    int hop = segment / 2 > 0 ? segment / 2 : 1;
+    int n_segments = 1 + (n_frames - segment) / hop;
+    double mean = 0.0;
+    int s, t, m;
+
+    for (t = 0; t < n_frames; t++) {
+        mean += series[t];
+    }
+    mean /= n_frames;
+
+    for (m = 0; m < n_mod; m++) {
+        out[m] = 0.0f;
+    }
+
+    for (s = 0; s < n_segments; s++) {
+        const float* x = series + (size_t)s * hop;
+
+        for (t = 0; t < segment; t++) {
+            re[t] = (float)(x[t] - mean) * window[t];
+            im[t] = 0.0f;
+        }
+        fft_execute(plan, re, im);
+
+        for (m = 0; m < n_mod; m++) {
+            out[m] += (float)sqrt(re[m] * re[m] + im[m] * im[m]);
+        }
+    }
+
+    /* Promedio entre segmentos, normalizado por la ventana (amplitud de la modulación) */
+    for (m = 0; m < n_mod; m++) {
+        out[m] = out[m] / n_segments * 2.0f / window_sum;
+    }
+}
+
+ModulationSpectrum* compute_modulation_parallel(const float* series, int local_bins, int n_bins,
+                                                int n_frames, const Config* cfg, MPI_Comm comm) {
+    ModulationSpectrum* spectrum = NULL;
+    int segment = n_frames < MODULATION_SEGMENT ? n_frames : MODULATION_SEGMENT;
+    int n_mod = segment / 2 + 1;
+    int rank, procs_number, k, local_count;
+    float *window, *re, *im, *local;
+    float window_sum = 0.0f;
+    FFTPlan* plan;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    plan = fft_plan_create(segment);
+    window = malloc(segment * sizeof(float));
+    re = malloc(segment * sizeof(float));
+    im = malloc(segment * sizeof(float));
+    local = malloc(((size_t)local_bins * n_mod + 1) * sizeof(float));
+    if (!plan || !window || !re || !im || !local) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para el espectro de modulacion\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (k = 0; k < segment; k++) {
+        window[k] = 1.0f;
+    }
+    window_apply(window, segment, WIN_HANN);
+    for (k = 0; k < segment; k++) {
+        window_sum += window[k];
+    }
+    /* La negación también atrapa NaN */
+    if (!(window_sum > 0.0f && window_sum <= FLT_MAX)) window_sum = 1.0f;
+
+    /* 1. Cada proceso: sus bins, cada serie contigua en memoria */
+    for (k = 0; k < local_bins; k++) {
+        series_spectrum(series + (size_t)k * n_frames, n_frames, segment, plan, window, window_sum,
+                        re, im, local + (size_t)k * n_mod);
+    }
+
+    /* 2. Rank 0 recolecta las filas (los bins de cada proceso son contiguos y en orden) */
+    if (rank == 0) {
+        spectrum = malloc(sizeof(ModulationSpectrum));
+        if (spectrum) {
+            spectrum->values = malloc((size_t)n_bins * n_mod * sizeof(float));
+        }
+        if (!spectrum || !spectrum->values) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para el espectro de modulacion\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        spectrum->n_bins = n_bins;
+        spectrum->n_mod = n_mod;
+        spectrum->mod_step_hz = (float)cfg->fs / cfg->hop / segment;
+    }
+
+    local_count = local_bins * n_mod;
+    gather_ordered(local, local_count, comm, rank == 0 ? spectrum->values : NULL);
+
+    free(local);
+    free(im);
+    free(re);
+    free(window);
+    fft_plan_destroy(plan);
+    return spectrum;
+}
+
+int write_modulation_csv(const char* filename, const ModulationSpectrum* spectrum, const Config* cfg) {
+    FILE* f = fopen(filename, "w");
+    int k, m;
+
+    if (!f) {
+        perror(filename);
+        return -1;
+    }
+
+    /* Encabezado: frecuencia del bin y cada frecuencia de modulación en Hz */
+    fprintf(f, "frecuencia_hz");
+    for (m = 0; m < spectrum->n_mod; m++) {
+        fprintf(f, ",%.3f", m * spectrum->mod_step_hz);
+    }
+    fprintf(f, "\n");
+
+    for (k = 0; k < spectrum->n_bins; k++) {
+        const float* row = spectrum->values + (size_t)k * spectrum->n_mod;
+
+        fprintf(f, "%.2f", (float)(cfg->bin_lo + k) * cfg->fs / cfg->N);
+        for (m = 0; m < spectrum->n_mod; m++) {
+            fprintf(f, ",%.6f", row[m]);
+        }
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+    return 0;
+}
+
+void free_modulation_spectrum(ModulationSpectrum* spectrum) {
+    if (!spectrum) return;
+    free(spectrum->values);
+    free(spectrum);
+}
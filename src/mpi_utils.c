@@ -1,25 +1,263 @@
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <mpi.h>
 #include "mpi_utils.h"
 #include "stft.h"
 
-float* gather_and_reorder_spectrogram(float* mag_local, int local_frames, int n_frames, 
-                                       int n_bins, int rank, int procs_number) {
-    
-    float *mag_global = NULL;
-    float *mag_temp = NULL;
+/* Procesos agrupados por nodo (atributo del comunicador, ver node_topology_attach) */
+typedef struct {
+    MPI_Comm node;      /* procesos del mismo nodo; el líder es el rank 0 local */
+    MPI_Comm leaders;   /* un proceso por nodo (MPI_COMM_NULL en los que no son líderes) */
+    int n_nodes;
+    int contiguous;     /* 1 si cada nodo tiene ranks consecutivos, en orden de nodo */
+    int* node_of;       /* nodo (rank en leaders de su líder) de cada rank de comm */
+    int* local_of;      /* rank dentro de su nodo de cada rank de comm */
+    int* node_procs;    /* procesos de cada nodo */
+} NodeTopology;
+
+static int topology_keyval = MPI_KEYVAL_INVALID;
+
+/* Se llama al liberar el comunicador que tiene la topología */
+static int topology_delete(MPI_Comm comm, int keyval, void* value, void* extra) {
+    NodeTopology* topo = (NodeTopology*)value;
+
+    (void)comm;
+    (void)keyval;
+    (void)extra;
+    MPI_Comm_free(&topo->node);
+    if (topo->leaders != MPI_COMM_NULL) {
+        MPI_Comm_free(&topo->leaders);
+    }
+    free(topo->node_of);
+    free(topo->local_of);
+    free(topo->node_procs);
+    free(topo);
+    return MPI_SUCCESS;
+}
+
+/* Topología de comm o NULL si la recolección es plana */
+static NodeTopology* topology_of(MPI_Comm comm) {
+    void* value;
+    int flag = 0;
+
+    if (topology_keyval == MPI_KEYVAL_INVALID) return NULL;
+    MPI_Comm_get_attr(comm, topology_keyval, &value, &flag);
+    return flag ? (NodeTopology*)value : NULL;
+}
+
+int node_topology_attach(MPI_Comm comm, gather_t mode, int node_size) {
+    NodeTopology* topo;
+    int mine[2], *all;
+    int rank, procs_number, node_rank, r;
+
+    if (mode == GATHER_FLAT) return 0;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    topo = calloc(1, sizeof(NodeTopology));
+    all = malloc(2 * procs_number * sizeof(int));
+    if (topo) {
+        topo->node_of = malloc(procs_number * sizeof(int));
+        topo->local_of = malloc(procs_number * sizeof(int));
+        topo->node_procs = calloc(procs_number, sizeof(int));
+    }
+    if (!topo || !all || !topo->node_of || !topo->local_of || !topo->node_procs) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la topologia de nodos\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* Clave = rank: rank 0 es el líder de su nodo y el líder 0 */
+    if (node_size > 0) {
+        MPI_Comm_split(comm, rank / node_size, rank, &topo->node);
+    } else {
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &topo->node);
+    }
+    MPI_Comm_rank(topo->node, &node_rank);
+    MPI_Comm_split(comm, node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &topo->leaders);
+
+    /* Cada proceso conoce el nodo y la posición local de todos */
+    mine[0] = 0;
+    if (topo->leaders != MPI_COMM_NULL) {
+        MPI_Comm_rank(topo->leaders, &mine[0]);
+    }
+    MPI_Bcast(&mine[0], 1, MPI_INT, 0, topo->node);
+    mine[1] = node_rank;
+    MPI_Allgather(mine, 2, MPI_INT, all, 2, MPI_INT, comm);
+
+    topo->contiguous = 1;
+    for (r = 0; r < procs_number; r++) {
+        topo->node_of[r] = all[2 * r];
+        topo->local_of[r] = all[2 * r + 1];
+        topo->node_procs[topo->node_of[r]]++;
+        if (topo->node_of[r] + 1 > topo->n_nodes) {
+            topo->n_nodes = topo->node_of[r] + 1;
+        }
+        if (r > 0 && topo->node_of[r] < topo->node_of[r - 1]) {
+            topo->contiguous = 0;
+        }
+    }
+    free(all);
+
+    /* Un solo nodo o un proceso por nodo: el nivel extra no ahorra mensajes */
+    if (mode == GATHER_AUTO && (topo->n_nodes == 1 || topo->n_nodes == procs_number)) {
+        topology_delete(comm, MPI_KEYVAL_INVALID, topo, NULL);
+        return 0;
+    }
+
+    if (topology_keyval == MPI_KEYVAL_INVALID) {
+        MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, topology_delete, &topology_keyval, NULL);
+    }
+    MPI_Comm_set_attr(comm, topology_keyval, topo);
+    return topo->n_nodes;
+}
+
+/* Prefijos de un array de cantidades */
+static void prefix_displs(const int* counts, int n, int* displs) {
+    int i;
+
+    for (i = 0; i < n; i++) {
+        displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+    }
+}
+
+/**
+ * Recolección cíclica en dos niveles: cada líder intercala los frames de su nodo en orden
+ * temporal y manda ese único bloque a rank 0, que intercala los bloques de los nodos.
+ */
+static void gather_cyclic_by_node(const NodeTopology* topo, float* mag_local, int local_frames,
+                                  int n_frames, int n_bins, MPI_Comm comm,
+                                  float* mag_temp, float* mag_global) {
+    int *counts = NULL, *displs = NULL, *cursor = NULL;
+    int *node_counts = NULL, *node_displs = NULL;
+    float *node_recv = NULL, *node_block = NULL;
+    int rank, procs_number, node_rank, node_procs, my_node;
+    int r, i;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+    MPI_Comm_rank(topo->node, &node_rank);
+    MPI_Comm_size(topo->node, &node_procs);
+    my_node = topo->node_of[rank];
+
+    if (node_rank == 0) {
+        int node_frames = 0;
+
+        counts = malloc(node_procs * sizeof(int));
+        displs = malloc(node_procs * sizeof(int));
+        cursor = calloc(node_procs, sizeof(int));
+        if (!counts || !displs || !cursor) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (r = 0; r < procs_number; r++) {
+            if (topo->node_of[r] == my_node) {
+                counts[topo->local_of[r]] = calculate_local_frames(r, n_frames, procs_number) * n_bins;
+                node_frames += calculate_local_frames(r, n_frames, procs_number);
+            }
+        }
+        prefix_displs(counts, node_procs, displs);
+
+        /* Rank 0 usa sus dos buffers de salida como intermedios */
+        if (rank == 0) {
+            node_recv = mag_temp;
+            node_block = mag_global;
+        } else {
+            node_recv = malloc(((size_t)node_frames * n_bins + 1) * sizeof(float));
+            node_block = malloc(((size_t)node_frames * n_bins + 1) * sizeof(float));
+            if (!node_recv || !node_block) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+
+    /* 1. Dentro del nodo: cada proceso le manda sus frames al líder */
+    MPI_Gatherv(mag_local, local_frames * n_bins, MPI_FLOAT, node_recv,
+                counts, displs, MPI_FLOAT, 0, topo->node);
+
+    if (node_rank == 0) {
+        size_t out = 0;
+
+        /* Frames del nodo en orden temporal (los de cada proceso llegan en orden) */
+        for (i = 0; i < n_frames; i++) {
+            int owner = i % procs_number;
+            int m;
+
+            if (topo->node_of[owner] != my_node) continue;
+            m = topo->local_of[owner];
+            memcpy(node_block + out, node_recv + displs[m] + (size_t)cursor[m] * n_bins,
+                   n_bins * sizeof(float));
+            cursor[m]++;
+            out += n_bins;
+        }
+
+        if (rank == 0) {
+            node_counts = calloc(topo->n_nodes, sizeof(int));
+            node_displs = malloc(topo->n_nodes * sizeof(int));
+            if (!node_counts || !node_displs) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            for (r = 0; r < procs_number; r++) {
+                node_counts[topo->node_of[r]] += calculate_local_frames(r, n_frames, procs_number) * n_bins;
+            }
+            prefix_displs(node_counts, topo->n_nodes, node_displs);
+        }
+
+        /* 2. Entre nodos: un mensaje por líder */
+        MPI_Gatherv(node_block, (int)out, MPI_FLOAT, mag_temp,
+                    node_counts, node_displs, MPI_FLOAT, 0, topo->leaders);
+
+        if (rank != 0) {
+            free(node_recv);
+            free(node_block);
+        }
+        free(counts);
+        free(displs);
+        free(cursor);
+    }
+
+    /* 3. Intercalar los bloques de los nodos */
+    if (rank == 0) {
+        int* node_cursor = calloc(topo->n_nodes, sizeof(int));
+
+        if (!node_cursor) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (i = 0; i < n_frames; i++) {
+            int node = topo->node_of[i % procs_number];
+            memcpy(mag_global + (size_t)i * n_bins, mag_temp + node_displs[node] + node_cursor[node],
+                   n_bins * sizeof(float));
+            node_cursor[node] += n_bins;
+        }
+        free(node_cursor);
+        free(node_counts);
+        free(node_displs);
+    }
+}
+
+void gather_spectrogram_into(float* mag_local, int local_frames, int n_frames, int n_bins,
+                             MPI_Comm comm, float* mag_temp, float* mag_global) {
     int* recvcounts = NULL;
     int* displs = NULL;
-    int r, i, k;
+    int rank, procs_number;
+    int r, i;
+    NodeTopology* topo = topology_of(comm);
+
+    if (topo) {
+        gather_cyclic_by_node(topo, mag_local, local_frames, n_frames, n_bins, comm,
+                              mag_temp, mag_global);
+        return;
+    }
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
     
     if (rank == 0) {
         int number_local_frames;
-        
-        /* Buffer global para los datos ordenados */
-        mag_global = malloc(sizeof(float) * n_bins * n_frames);
-        
-        /* Buffer temporal para recibir los datos */
-        mag_temp = malloc(sizeof(float) * n_bins * n_frames);
 
         /* Calcular cuántos datos envía cada proceso */
         displs = malloc(procs_number * sizeof(int)); 
@@ -34,28 +272,644 @@ float* gather_and_reorder_spectrogram(float* mag_local, int local_frames, int n_
 
     /* Recibir los datos en el buffer temporal */
     MPI_Gatherv(mag_local, local_frames * n_bins, MPI_FLOAT, mag_temp, 
-                recvcounts, displs, MPI_FLOAT, 0, MPI_COMM_WORLD); 
+                recvcounts, displs, MPI_FLOAT, 0, comm); 
     
-    /* Reordenar los datos de cíclico a secuencial */
+    /* Reordenar los datos de cíclico a secuencial (una fila de n_bins por frame) */
     if (rank == 0) {
         for (i = 0; i < n_frames; i++) {
             int round_displacement = i / procs_number; 
-
-            for (k = 0; k < n_bins; k++) {
-                int node = i % procs_number;
-                int frame_displacement = displs[node] / n_bins;
-                int temp_index = (frame_displacement + round_displacement) * n_bins + k;
-                int global_index = i * n_bins + k;
-                
-                mag_global[global_index] = mag_temp[temp_index];
-            }
+            int node = i % procs_number;
+            int frame_displacement = displs[node] / n_bins;
+            size_t temp_index = (size_t)(frame_displacement + round_displacement) * n_bins;
+            
+            memcpy(mag_global + (size_t)i * n_bins, mag_temp + temp_index, n_bins * sizeof(float));
         }
         
         /* Liberar buffers temporales */
-        free(mag_temp);
         free(recvcounts);
         free(displs);
     }
+}
 
+float* gather_and_reorder_spectrogram(float* mag_local, int local_frames, int n_frames, 
+                                       int n_bins, int rank, int procs_number) {
+    
+    float *mag_global = NULL;
+    float *mag_temp = NULL;
+    
+    if (rank == 0) {
+        /* Buffer global para los datos ordenados */
+        mag_global = malloc(sizeof(float) * n_bins * n_frames + sizeof(float));
+        
+        /* Buffer temporal para recibir los datos */
+        mag_temp = malloc(sizeof(float) * n_bins * n_frames + sizeof(float));
+    }
+
+    gather_spectrogram_into(mag_local, local_frames, n_frames, n_bins, MPI_COMM_WORLD,
+                            mag_temp, mag_global);
+
+    free(mag_temp);
     return mag_global;
 }
+
+/* Bloques que llegaron a rank 0 de un comunicador, concatenados en orden de rank */
+typedef struct {
+    int n_chunks;       /* bloques de todos los procesos */
+    int* starts;
+    int* counts;
+    int* rank_chunks;   /* bloques de cada proceso */
+    int* rank_frames;   /* frames de cada proceso */
+} ChunkList;
+
+/**
+ * Junta en rank 0 de comm los bloques de cada proceso y sus magnitudes, sin ubicarlas.
+ * Si *recv es NULL, rank 0 aloja el buffer de recepción (lo libera el llamador).
+ */
+static void collect_chunks(const float* mag_local, int local_frames, const FrameChunks* chunks,
+                           int n_bins, MPI_Comm comm, float** recv, ChunkList* list) {
+    int *chunk_displs = NULL, *recvcounts = NULL, *displs = NULL;
+    int rank, procs_number, total_frames = 0;
+    int r, c;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+    memset(list, 0, sizeof(ChunkList));
+
+    /* 1. Cuántos bloques calculó cada proceso */
+    if (rank == 0) {
+        list->rank_chunks = malloc(procs_number * sizeof(int));
+        list->rank_frames = malloc(procs_number * sizeof(int));
+        chunk_displs = malloc(procs_number * sizeof(int));
+        recvcounts = malloc(procs_number * sizeof(int));
+        displs = malloc(procs_number * sizeof(int));
+        if (!list->rank_chunks || !list->rank_frames || !chunk_displs || !recvcounts || !displs) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por bloques\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    MPI_Gather((void*)&chunks->n_chunks, 1, MPI_INT, list->rank_chunks, 1, MPI_INT, 0, comm);
+
+    if (rank == 0) {
+        prefix_displs(list->rank_chunks, procs_number, chunk_displs);
+        list->n_chunks = chunk_displs[procs_number - 1] + list->rank_chunks[procs_number - 1];
+        list->starts = malloc((list->n_chunks > 0 ? list->n_chunks : 1) * sizeof(int));
+        list->counts = malloc((list->n_chunks > 0 ? list->n_chunks : 1) * sizeof(int));
+        if (!list->starts || !list->counts) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por bloques\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    /* 2. Qué frames calculó cada proceso (ubicación de cada bloque) */
+    MPI_Gatherv(chunks->starts, chunks->n_chunks, MPI_INT, list->starts,
+                list->rank_chunks, chunk_displs, MPI_INT, 0, comm);
+    MPI_Gatherv(chunks->counts, chunks->n_chunks, MPI_INT, list->counts,
+                list->rank_chunks, chunk_displs, MPI_INT, 0, comm);
+
+    if (rank == 0) {
+        for (r = 0; r < procs_number; r++) {
+            list->rank_frames[r] = 0;
+            for (c = 0; c < list->rank_chunks[r]; c++) {
+                list->rank_frames[r] += list->counts[chunk_displs[r] + c];
+            }
+            recvcounts[r] = list->rank_frames[r] * n_bins;
+            total_frames += list->rank_frames[r];
+        }
+        prefix_displs(recvcounts, procs_number, displs);
+
+        if (*recv == NULL) {
+            *recv = malloc(((size_t)total_frames * n_bins + 1) * sizeof(float));
+            if (*recv == NULL) {
+                fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por bloques\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+
+    /* 3. Magnitudes: bloques concatenados de cada proceso */
+    MPI_Gatherv((void*)mag_local, local_frames * n_bins, MPI_FLOAT, rank == 0 ? *recv : NULL,
+                recvcounts, displs, MPI_FLOAT, 0, comm);
+
+    free(chunk_displs);
+    free(recvcounts);
+    free(displs);
+}
+
+/* Copia cada bloque recolectado (frames consecutivos) a su posición temporal */
+static void place_chunks(const float* src, const ChunkList* list, int n_bins, float* mag_global) {
+    int c;
+
+    for (c = 0; c < list->n_chunks; c++) {
+        memcpy(mag_global + (size_t)list->starts[c] * n_bins, src,
+               (size_t)list->counts[c] * n_bins * sizeof(float));
+        src += (size_t)list->counts[c] * n_bins;
+    }
+}
+
+static void free_chunk_list(ChunkList* list) {
+    free(list->starts);
+    free(list->counts);
+    free(list->rank_chunks);
+    free(list->rank_frames);
+}
+
+/* Un bloque recibido por el líder y dónde quedó en su buffer */
+typedef struct {
+    int start;
+    int count;
+    size_t offset;
+} ChunkRef;
+
+static int compare_chunk_start(const void* a, const void* b) {
+    const ChunkRef* x = (const ChunkRef*)a;
+    const ChunkRef* y = (const ChunkRef*)b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+/**
+ * Recolección por bloques en dos niveles: el líder ordena por inicio los bloques de su
+ * nodo, une los que quedan contiguos (con la distribución por bloques los de ranks vecinos
+ * lo son) y manda a rank 0 esa lista corta con un único buffer de magnitudes.
+ */
+static void gather_chunks_by_node(const NodeTopology* topo, float* mag_local, int local_frames,
+                                  const FrameChunks* chunks, int n_bins, MPI_Comm comm,
+                                  float* mag_temp, float* mag_global, const char* label) {
+    ChunkList members, nodes;
+    FrameChunks merged = FRAME_CHUNKS_INIT;
+    ChunkRef* refs = NULL;
+    float *node_recv = NULL, *node_block = NULL;
+    int *stats = NULL, *all_stats = NULL, *stat_counts = NULL, *stat_displs = NULL;
+    int rank, procs_number, node_rank, node_procs, node_frames = 0;
+    int r, c;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+    MPI_Comm_rank(topo->node, &node_rank);
+    MPI_Comm_size(topo->node, &node_procs);
+
+    /* 1. Dentro del nodo (rank 0 recibe en mag_temp y ordena en mag_global) */
+    if (rank == 0) {
+        node_recv = mag_temp;
+    }
+    collect_chunks(mag_local, local_frames, chunks, n_bins, topo->node, &node_recv, &members);
+    if (node_rank != 0) return;
+
+    refs = malloc((members.n_chunks > 0 ? members.n_chunks : 1) * sizeof(ChunkRef));
+    merged.starts = malloc((members.n_chunks > 0 ? members.n_chunks : 1) * sizeof(int));
+    merged.counts = malloc((members.n_chunks > 0 ? members.n_chunks : 1) * sizeof(int));
+    if (!refs || !merged.starts || !merged.counts) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (c = 0; c < members.n_chunks; c++) {
+        refs[c].start = members.starts[c];
+        refs[c].count = members.counts[c];
+        refs[c].offset = (size_t)node_frames * n_bins;
+        node_frames += members.counts[c];
+    }
+    qsort(refs, members.n_chunks, sizeof(ChunkRef), compare_chunk_start);
+
+    if (rank == 0) {
+        node_block = mag_global;
+    } else {
+        node_block = malloc(((size_t)node_frames * n_bins + 1) * sizeof(float));
+        if (!node_block) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    /* Frames del nodo en orden temporal; bloques contiguos se unen */
+    node_frames = 0;
+    for (c = 0; c < members.n_chunks; c++) {
+        memcpy(node_block + (size_t)node_frames * n_bins, node_recv + refs[c].offset,
+               (size_t)refs[c].count * n_bins * sizeof(float));
+        node_frames += refs[c].count;
+        if (merged.n_chunks > 0 &&
+            merged.starts[merged.n_chunks - 1] + merged.counts[merged.n_chunks - 1] == refs[c].start) {
+            merged.counts[merged.n_chunks - 1] += refs[c].count;
+        } else {
+            merged.starts[merged.n_chunks] = refs[c].start;
+            merged.counts[merged.n_chunks] = refs[c].count;
+            merged.n_chunks++;
+        }
+    }
+
+    /* 2. Entre nodos: cada líder manda la lista unida y un solo bloque de magnitudes */
+    collect_chunks(node_block, node_frames, &merged, n_bins, topo->leaders, &mag_temp, &nodes);
+
+    /* El reporte por proceso viaja con los líderes: (frames, bloques) de cada miembro */
+    if (label) {
+        stats = malloc(2 * node_procs * sizeof(int));
+        if (rank == 0) {
+            all_stats = malloc(2 * procs_number * sizeof(int));
+            stat_counts = malloc(topo->n_nodes * sizeof(int));
+            stat_displs = malloc(topo->n_nodes * sizeof(int));
+        }
+        if (!stats || (rank == 0 && (!all_stats || !stat_counts || !stat_displs))) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (r = 0; r < node_procs; r++) {
+            stats[2 * r] = members.rank_frames[r];
+            stats[2 * r + 1] = members.rank_chunks[r];
+        }
+        if (rank == 0) {
+            for (r = 0; r < topo->n_nodes; r++) {
+                stat_counts[r] = 2 * topo->node_procs[r];
+            }
+            prefix_displs(stat_counts, topo->n_nodes, stat_displs);
+        }
+        MPI_Gatherv(stats, 2 * node_procs, MPI_INT, all_stats, stat_counts, stat_displs,
+                    MPI_INT, 0, topo->leaders);
+        if (rank == 0) {
+            for (r = 0; r < procs_number; r++) {
+                const int* s = all_stats + stat_displs[topo->node_of[r]] + 2 * topo->local_of[r];
+                printf("%s: rank %d -> %d frames en %d bloques\n", label, r, s[0], s[1]);
+            }
+        }
+        free(stats);
+        free(all_stats);
+        free(stat_counts);
+        free(stat_displs);
+    }
+
+    if (rank == 0) {
+        place_chunks(mag_temp, &nodes, n_bins, mag_global);
+    } else {
+        free(node_recv);
+        free(node_block);
+    }
+
+    free_chunk_list(&members);
+    free_chunk_list(&nodes);
+    free(merged.starts);
+    free(merged.counts);
+    free(refs);
+}
+
+/**
+ * Recolección por bloques de frames consecutivos (común a la distribución dinámica, a la
+ * de bloques y a los niveles de la pirámide). Con label != NULL rank 0 informa cuántos
+ * frames y bloques calculó cada proceso.
+ */
+static void gather_chunks(float* mag_local, int local_frames, const FrameChunks* chunks,
+                          int n_frames, int n_bins, MPI_Comm comm,
+                          float* mag_temp, float* mag_global, const char* label) {
+    ChunkList list;
+    NodeTopology* topo = topology_of(comm);
+    int rank, procs_number, r;
+
+    if (topo) {
+        gather_chunks_by_node(topo, mag_local, local_frames, chunks, n_bins, comm,
+                              mag_temp, mag_global, label);
+        return;
+    }
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+    collect_chunks(mag_local, local_frames, chunks, n_bins, comm, &mag_temp, &list);
+
+    if (rank == 0) {
+        for (r = 0; label && r < procs_number; r++) {
+            printf("%s: rank %d -> %d frames en %d bloques\n",
+                   label, r, list.rank_frames[r], list.rank_chunks[r]);
+        }
+        place_chunks(mag_temp, &list, n_bins, mag_global);
+    }
+    free_chunk_list(&list);
+}
+
+void gather_dynamic_spectrogram(float* mag_local, int local_frames, const FrameChunks* chunks,
+                                int n_frames, int n_bins, MPI_Comm comm,
+                                float* mag_temp, float* mag_global) {
+    gather_chunks(mag_local, local_frames, chunks, n_frames, n_bins, comm,
+                  mag_temp, mag_global, "Distribucion dinamica");
+}
+
+void gather_chunked_spectrogram(float* mag_local, int local_frames, const FrameChunks* chunks,
+                                int n_frames, int n_bins, MPI_Comm comm,
+                                float* mag_temp, float* mag_global) {
+    gather_chunks(mag_local, local_frames, chunks, n_frames, n_bins, comm,
+                  mag_temp, mag_global, NULL);
+}
+
+/**
+ * Concatenación en dos niveles: el líder junta los datos de su nodo y manda a rank 0 las
+ * cantidades de cada miembro y un solo bloque. Si los nodos tienen ranks consecutivos los
+ * bloques llegan directamente en su lugar de out.
+ */
+static void gather_ordered_by_node(const NodeTopology* topo, const float* local, int count,
+                                   MPI_Comm comm, float* out) {
+    int *counts = NULL, *displs = NULL, *all_counts = NULL, *member_displs = NULL;
+    int *node_counts = NULL, *node_displs = NULL;
+    float *node_block = NULL, *recv = NULL;
+    int rank, procs_number, node_rank, node_procs, node_total = 0;
+    int r;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+    MPI_Comm_rank(topo->node, &node_rank);
+    MPI_Comm_size(topo->node, &node_procs);
+
+    if (node_rank == 0) {
+        counts = malloc(node_procs * sizeof(int));
+        displs = malloc(node_procs * sizeof(int));
+        if (!counts || !displs) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    /* 1. Dentro del nodo (los miembros están en orden de rank) */
+    MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, topo->node);
+    if (node_rank == 0) {
+        prefix_displs(counts, node_procs, displs);
+        node_total = displs[node_procs - 1] + counts[node_procs - 1];
+    }
+
+    if (rank == 0) {
+        all_counts = malloc(procs_number * sizeof(int));
+        member_displs = malloc(topo->n_nodes * sizeof(int));
+        node_counts = malloc(topo->n_nodes * sizeof(int));
+        node_displs = malloc(topo->n_nodes * sizeof(int));
+        if (!all_counts || !member_displs || !node_counts || !node_displs) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    /* 2. Cantidades de cada miembro, agrupadas por nodo */
+    if (node_rank == 0) {
+        if (rank == 0) {
+            prefix_displs(topo->node_procs, topo->n_nodes, member_displs);
+        }
+        MPI_Gatherv(counts, node_procs, MPI_INT, all_counts, topo->node_procs, member_displs,
+                    MPI_INT, 0, topo->leaders);
+    }
+
+    /* Rank 0: total de cada nodo y buffer donde quedan los bloques */
+    if (rank == 0) {
+        int total = 0;
+
+        for (r = 0; r < topo->n_nodes; r++) {
+            int m;
+            node_counts[r] = 0;
+            for (m = 0; m < topo->node_procs[r]; m++) {
+                node_counts[r] += all_counts[member_displs[r] + m];
+            }
+            total += node_counts[r];
+        }
+        prefix_displs(node_counts, topo->n_nodes, node_displs);
+
+        recv = topo->contiguous ? out : malloc(((size_t)total + 1) * sizeof(float));
+        if (!recv) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        node_block = recv;   /* el nodo 0 va primero: el nivel 2 es en el lugar */
+    } else if (node_rank == 0) {
+        node_block = malloc(((size_t)node_total + 1) * sizeof(float));
+        if (!node_block) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    MPI_Gatherv((void*)local, count, MPI_FLOAT, node_block, counts, displs, MPI_FLOAT, 0, topo->node);
+
+    /* 3. Entre nodos: un bloque por líder */
+    if (node_rank == 0) {
+        if (rank == 0) {
+            MPI_Gatherv(MPI_IN_PLACE, node_total, MPI_FLOAT, recv, node_counts, node_displs,
+                        MPI_FLOAT, 0, topo->leaders);
+        } else {
+            MPI_Gatherv(node_block, node_total, MPI_FLOAT, NULL, NULL, NULL,
+                        MPI_FLOAT, 0, topo->leaders);
+            free(node_block);
+        }
+    }
+
+    /* Nodos con ranks salteados: los datos de cada rank se toman de su nodo en orden */
+    if (rank == 0 && !topo->contiguous) {
+        int* cursor = calloc(topo->n_nodes, sizeof(int));
+        size_t pos = 0;
+
+        if (!cursor) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion por nodo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (r = 0; r < procs_number; r++) {
+            int node = topo->node_of[r];
+            int len = all_counts[member_displs[node] + topo->local_of[r]];
+            memcpy(out + pos, recv + node_displs[node] + cursor[node], len * sizeof(float));
+            cursor[node] += len;
+            pos += len;
+        }
+        free(cursor);
+        free(recv);
+    }
+
+    free(counts);
+    free(displs);
+    free(all_counts);
+    free(member_displs);
+    free(node_counts);
+    free(node_displs);
+}
+
+void gather_ordered(const float* local, int count, MPI_Comm comm, float* out) {
+    int *recvcounts = NULL, *displs = NULL;
+    int rank, procs_number;
+    NodeTopology* topo = topology_of(comm);
+
+    if (topo) {
+        gather_ordered_by_node(topo, local, count, comm, out);
+        return;
+    }
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+    if (rank == 0) {
+        recvcounts = malloc(procs_number * sizeof(int));
+        displs = malloc(procs_number * sizeof(int));
+        if (!recvcounts || !displs) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la recoleccion\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(&count, 1, MPI_INT, recvcounts, 1, MPI_INT, 0, comm);
+    if (rank == 0) {
+        prefix_displs(recvcounts, procs_number, displs);
+    }
+    MPI_Gatherv((void*)local, count, MPI_FLOAT, out, recvcounts, displs, MPI_FLOAT, 0, comm);
+
+    free(recvcounts);
+    free(displs);
+}
+
+void reduce_by_node(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type,
+                    MPI_Op op, MPI_Comm comm) {
+    NodeTopology* topo = topology_of(comm);
+    int rank;
+
+    if (!topo) {
+        MPI_Reduce((void*)sendbuf, recvbuf, count, type, op, 0, comm);
+        return;
+    }
+
+    /* 1. Parcial de cada nodo en su líder; 2. entre líderes hacia rank 0 */
+    MPI_Comm_rank(comm, &rank);
+    MPI_Reduce((void*)sendbuf, recvbuf, count, type, op, 0, topo->node);
+    if (topo->leaders != MPI_COMM_NULL) {
+        MPI_Reduce(rank == 0 ? MPI_IN_PLACE : recvbuf, rank == 0 ? recvbuf : NULL, count, type, op, 0,
+                   topo->leaders);
+    }
+}
+
+/* Lado de los bloques del empaquetado: 64 x 64 floats (16 KB) entran en L1/L2 */
+#define TRANSPOSE_BLOCK 64
+
+int transpose_bin_first(int rank, int n_bins, int procs_number) {
+    return (int)((long)rank * n_bins / procs_number);
+}
+
+void transpose_frames_to_bins(const float* mag_local, const int* frame_index, int local_frames,
+                              int n_frames, int n_bins, MPI_Comm comm, float* out) {
+    int *sendcounts, *sdispls, *recvcounts, *rdispls;
+    int *frame_counts, *frame_displs, *all_index;
+    float *sendbuf, *recvbuf;
+    int rank, procs_number, my_first, my_bins, r;
+    size_t offset;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+    my_first = transpose_bin_first(rank, n_bins, procs_number);
+    my_bins = transpose_bin_first(rank + 1, n_bins, procs_number) - my_first;
+
+    sendcounts = malloc(procs_number * sizeof(int));
+    sdispls = malloc(procs_number * sizeof(int));
+    recvcounts = malloc(procs_number * sizeof(int));
+    rdispls = malloc(procs_number * sizeof(int));
+    frame_counts = malloc(procs_number * sizeof(int));
+    frame_displs = malloc(procs_number * sizeof(int));
+    all_index = malloc(((size_t)n_frames + 1) * sizeof(int));
+    sendbuf = malloc(((size_t)local_frames * n_bins + 1) * sizeof(float));
+    recvbuf = malloc(((size_t)my_bins * n_frames + 1) * sizeof(float));
+    if (!sendcounts || !sdispls || !recvcounts || !rdispls || !frame_counts ||
+        !frame_displs || !all_index || !sendbuf || !recvbuf) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la transposicion\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* 1. Qué frames tiene cada proceso (para ubicar lo que llega de cada uno) */
+    MPI_Allgather(&local_frames, 1, MPI_INT, frame_counts, 1, MPI_INT, comm);
+    for (r = 0; r < procs_number; r++) {
+        frame_displs[r] = (r == 0) ? 0 : frame_displs[r - 1] + frame_counts[r - 1];
+    }
+    MPI_Allgatherv((void*)frame_index, local_frames, MPI_INT, all_index,
+                   frame_counts, frame_displs, MPI_INT, comm);
+
+    /* 2. Empaquetar: para cada destino, sus bins uno tras otro con mis frames en orden.
+          Se recorre por bloques para que las lecturas con paso n_bins queden en cache */
+    offset = 0;
+    for (r = 0; r < procs_number; r++) {
+        int first = transpose_bin_first(r, n_bins, procs_number);
+        int bins = transpose_bin_first(r + 1, n_bins, procs_number) - first;
+        float* dst = sendbuf + offset;
+        int j0, k0, j, k;
+
+        for (j0 = 0; j0 < local_frames; j0 += TRANSPOSE_BLOCK) {
+            int j1 = (j0 + TRANSPOSE_BLOCK < local_frames) ? j0 + TRANSPOSE_BLOCK : local_frames;
+            for (k0 = 0; k0 < bins; k0 += TRANSPOSE_BLOCK) {
+                int k1 = (k0 + TRANSPOSE_BLOCK < bins) ? k0 + TRANSPOSE_BLOCK : bins;
+                for (k = k0; k < k1; k++) {
+                    const float* src = mag_local + first + k;
+                    float* row = dst + (size_t)k * local_frames;
+                    for (j = j0; j < j1; j++) {
+                        row[j] = src[(size_t)j * n_bins];
+                    }
+                }
+            }
+        }
+
+        sendcounts[r] = local_frames * bins;
+        sdispls[r] = (int)offset;
+        offset += (size_t)local_frames * bins;
+    }
+
+    for (r = 0; r < procs_number; r++) {
+        recvcounts[r] = frame_counts[r] * my_bins;
+        rdispls[r] = (r == 0) ? 0 : rdispls[r - 1] + recvcounts[r - 1];
+    }
+
+    /* 3. Intercambio: cada proceso manda a cada otro solo los bins que le tocan */
+    MPI_Alltoallv(sendbuf, sendcounts, sdispls, MPI_FLOAT,
+                  recvbuf, recvcounts, rdispls, MPI_FLOAT, comm);
+
+    /* 4. Desempaquetar: cada fila recibida va a su serie, en la posición de cada frame */
+    for (r = 0; r < procs_number; r++) {
+        const int* index = all_index + frame_displs[r];
+        const float* src = recvbuf + rdispls[r];
+        int k, j;
+
+        for (k = 0; k < my_bins; k++) {
+            float* series = out + (size_t)k * n_frames;
+            const float* row = src + (size_t)k * frame_counts[r];
+            for (j = 0; j < frame_counts[r]; j++) {
+                series[index[j]] = row[j];
+            }
+        }
+    }
+
+    free(sendcounts);
+    free(sdispls);
+    free(recvcounts);
+    free(rdispls);
+    free(frame_counts);
+    free(frame_displs);
+    free(all_index);
+    free(sendbuf);
+    free(recvbuf);
+}
+
+int work_counter_create(WorkCounter* counter, MPI_Comm comm) {
+    int rank;
+    MPI_Aint size;
+
+    MPI_Comm_rank(comm, &rank);
+
+    /* Solo rank 0 aloja memoria para el contador */
+    size = (rank == 0) ? (MPI_Aint)sizeof(int) : 0;
+    if (MPI_Win_allocate(size, sizeof(int), MPI_INFO_NULL, comm, &counter->base, &counter->win) != MPI_SUCCESS) {
+        return -1;
+    }
+
+    /* Época de acceso pasiva abierta hacia todos mientras dure el reparto */
+    MPI_Win_lock_all(0, counter->win);
+
+    /* La escritura local en la ventana se hace visible a los accesos RMA con MPI_Win_sync */
+    if (rank == 0) {
+        *counter->base = 0;
+        MPI_Win_sync(counter->win);
+    }
+
+    /* Nadie reclama antes de que el contador esté en 0 */
+    MPI_Barrier(comm);
+    return 0;
+}
+
+int work_counter_next(WorkCounter* counter, int amount) {
+    int previous = 0;
+
+    MPI_Fetch_and_op(&amount, &previous, MPI_INT, 0, 0, MPI_SUM, counter->win);
+    MPI_Win_flush(0, counter->win);
+    return previous;
+}
+
+void work_counter_free(WorkCounter* counter) {
+    MPI_Win_unlock_all(counter->win);
+    MPI_Win_free(&counter->win);
+    counter->base = NULL;
+}
@@ -0,0 +1,470 @@
+#include <string.h>
+#include <stdint.h>
+#include "pcm.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PCM_USE_SSE2 1
+#endif
+
+/* Escalas para llevar cada formato entero a [-1,1] */
+#define SCALE_S16 (1.0f / 32768.0f)
+#define SCALE_S24 (1.0f / 8388608.0f)
+#define SCALE_S32 (1.0f / 2147483648.0f)
+
+int pcm_format_from_wav(int audio_format, int bits_per_sample, pcm_format_t *out) {
+    if (audio_format == WAVE_FORMAT_PCM) {
+        if (bits_per_sample == 16) { *out = PCM_S16; return 0; }
+        if (bits_per_sample == 24) { *out = PCM_S24; return 0; }
+        if (bits_per_sample == 32) { *out = PCM_S32; return 0; }
+    } else if (audio_format == WAVE_FORMAT_IEEE_FLOAT) {
+        if (bits_per_sample == 32) { *out = PCM_F32; return 0; }
+    }
+    return -1;
+}
+
+int pcm_bytes_per_sample(pcm_format_t fmt) {
+    switch (fmt) {
+        case PCM_S16: return 2;
+        case PCM_S24: return 3;
+        case PCM_S32: return 4;
+        case PCM_F32: return 4;
+    }
+    return 0;
+}
+
+/* Lee una muestra de 24 bits little endian con signo */
+static int32_t load_s24(const unsigned char *p) {
+    /* Armamos el valor en los 24 bits altos y desplazamos para extender el signo */
+    return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 8;
+}
+
+/**
+ * Un canal (muestras separadas por stride bytes) a float [-1,1]. El formato se resuelve
+ * una vez por llamada y cada bucle queda sin ramas. Con accumulate se suma a out.
+ */
+static void convert_channel(const unsigned char *p, int stride, int frames, pcm_format_t fmt,
+                            float *out, int accumulate) {
+    int i;
+    int16_t s16;
+    int32_t s32;
+    float v;
+
+    switch (fmt) {
+        case PCM_S16:
+            for (i = 0; i < frames; i++, p += stride) {
+                memcpy(&s16, p, 2);
+                v = s16 * SCALE_S16;
+                out[i] = accumulate ? out[i] + v : v;
+            }
+            break;
+        case PCM_S24:
+            for (i = 0; i < frames; i++, p += stride) {
+                v = (float)load_s24(p) * SCALE_S24;
+                out[i] = accumulate ? out[i] + v : v;
+            }
+            break;
+        case PCM_S32:
+            for (i = 0; i < frames; i++, p += stride) {
+                memcpy(&s32, p, 4);
+                v = (float)s32 * SCALE_S32;
+                out[i] = accumulate ? out[i] + v : v;
+            }
+            break;
+        case PCM_F32:
+            for (i = 0; i < frames; i++, p += stride) {
+                memcpy(&v, p, 4);
+                out[i] = accumulate ? out[i] + v : v;
+            }
+            break;
+    }
+}
+
+/**
+ * Camino escalar genérico: cualquier formato y cantidad de canales. Se acumula canal por
+ * canal en float sobre la salida (el bloque entra en cache) y al final se divide.
+ * Se usa para los frames que sobran de los kernels vectoriales y sin SSE2.
+ */
+static void decode_generic(const unsigned char *src, float *dst, int frames, int channels,
+                           pcm_format_t fmt) {
+    int bps = pcm_bytes_per_sample(fmt);
+    float inv_channels = 1.0f / (float)channels;
+    int i, c;
+
+    for (c = 0; c < channels; c++) {
+        convert_channel(src + (size_t)c * bps, bps * channels, frames, fmt, dst, c > 0);
+    }
+    if (channels > 1) {
+        for (i = 0; i < frames; i++) {
+            dst[i] *= inv_channels;
+        }
+    }
+}
+
+/* 24 bits mono/estéreo: sin shuffle de bytes en SSE2, pero el bucle es simple y sin ramas */
+static int decode_s24_12(const unsigned char *src, float *dst, int frames, int channels) {
+    int i;
+
+    if (channels == 1) {
+        for (i = 0; i < frames; i++) {
+            dst[i] = (float)load_s24(src + 3 * i) * SCALE_S24;
+        }
+    } else {
+        for (i = 0; i < frames; i++) {
+            dst[i] = (float)(load_s24(src + 6 * i) + load_s24(src + 6 * i + 3)) * (0.5f * SCALE_S24);
+        }
+    }
+    return frames;
+}
+
+#ifdef PCM_USE_SSE2
+
+/* Separa dos vectores intercalados (L0 R0 L1 R1 | L2 R2 L3 R3) en L0..L3 y R0..R3 */
+static void split_pairs_ps(__m128 a, __m128 b, __m128 *even, __m128 *odd) {
+    *even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    *odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+/* Suma de pares adyacentes (L+R) de dos vectores de 4 floats intercalados */
+static __m128 sum_pairs_ps(__m128 a, __m128 b) {
+    __m128 even, odd;
+
+    split_pairs_ps(a, b, &even, &odd);
+    return _mm_add_ps(even, odd);
+}
+
+/* Kernels SSE2: devuelven cuántos frames decodificaron (múltiplo del ancho del vector) */
+
+static int decode_s16_sse2(const unsigned char *src, float *dst, int frames, int channels) {
+    int i = 0;
+
+    if (channels == 1) {
+        __m128 scale = _mm_set1_ps(SCALE_S16);
+        for (; i + 8 <= frames; i += 8) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            /* Extensión de signo 16 -> 32 bits: duplicamos y desplazamos aritméticamente */
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+    } else if (channels == 2) {
+        /* pmaddwd con unos suma L+R directamente en 32 bits */
+        __m128i ones = _mm_set1_epi16(1);
+        __m128 scale = _mm_set1_ps(0.5f * SCALE_S16);
+        for (; i + 8 <= frames; i += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(src + 4 * i + 16));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_madd_epi16(a, ones)), scale));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_madd_epi16(b, ones)), scale));
+        }
+    }
+    return i;
+}
+
+static int decode_s32_sse2(const unsigned char *src, float *dst, int frames, int channels) {
+    int i = 0;
+
+    if (channels == 1) {
+        __m128 scale = _mm_set1_ps(SCALE_S32);
+        for (; i + 4 <= frames; i += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+        }
+    } else if (channels == 2) {
+        __m128 scale = _mm_set1_ps(0.5f * SCALE_S32);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + 8 * i)));
+            __m128 b = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + 8 * i + 16)));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(sum_pairs_ps(a, b), scale));
+        }
+    }
+    return i;
+}
+
+static int decode_f32_sse2(const unsigned char *src, float *dst, int frames, int channels) {
+    int i = 0;
+
+    if (channels == 1) {
+        memcpy(dst, src, (size_t)frames * sizeof(float));
+        return frames;
+    } else if (channels == 2) {
+        __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps((const float *)(src + 8 * i));
+            __m128 b = _mm_loadu_ps((const float *)(src + 8 * i + 16));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(sum_pairs_ps(a, b), half));
+        }
+    }
+    return i;
+}
+
+/* 4 muestras de un canal separadas por stride bytes (SSE2 no tiene gather: cargas escalares) */
+static __m128i gather_s16(const unsigned char *p, int stride) {
+    int16_t s[4];
+
+    memcpy(&s[0], p, 2);
+    memcpy(&s[1], p + stride, 2);
+    memcpy(&s[2], p + 2 * stride, 2);
+    memcpy(&s[3], p + 3 * stride, 2);
+    return _mm_set_epi32(s[3], s[2], s[1], s[0]);
+}
+
+static __m128i gather_s24(const unsigned char *p, int stride) {
+    return _mm_set_epi32(load_s24(p + 3 * stride), load_s24(p + 2 * stride),
+                         load_s24(p + stride), load_s24(p));
+}
+
+static __m128i gather_s32(const unsigned char *p, int stride) {
+    int32_t s[4];
+
+    memcpy(&s[0], p, 4);
+    memcpy(&s[1], p + stride, 4);
+    memcpy(&s[2], p + 2 * stride, 4);
+    memcpy(&s[3], p + 3 * stride, 4);
+    return _mm_set_epi32(s[3], s[2], s[1], s[0]);
+}
+
+static __m128 gather_f32(const unsigned char *p, int stride) {
+    float f[4];
+
+    memcpy(&f[0], p, 4);
+    memcpy(&f[1], p + stride, 4);
+    memcpy(&f[2], p + 2 * stride, 4);
+    memcpy(&f[3], p + 3 * stride, 4);
+    return _mm_set_ps(f[3], f[2], f[1], f[0]);
+}
+
+/**
+ * Más de dos canales: 4 frames por vector, cada canal se convierte y se suma a un
+ * acumulador (entero exacto en 16 bits, float en el resto). Un bucle por formato.
+ */
+static int decode_multi_sse2(const unsigned char *src, float *dst, int frames, int channels,
+                             pcm_format_t fmt) {
+    int stride = pcm_bytes_per_sample(fmt) * channels;
+    float inv_channels = 1.0f / (float)channels;
+    const unsigned char *p;
+    int i = 0, c;
+
+    switch (fmt) {
+        case PCM_S16: {
+            /* 65535 canales * 32768 todavía entra en 32 bits */
+            __m128 scale = _mm_set1_ps(SCALE_S16 * inv_channels);
+            for (; i + 4 <= frames; i += 4) {
+                __m128i acc = _mm_setzero_si128();
+                p = src + (size_t)i * stride;
+                for (c = 0; c < channels; c++, p += 2) {
+                    acc = _mm_add_epi32(acc, gather_s16(p, stride));
+                }
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(acc), scale));
+            }
+            break;
+        }
+        case PCM_S24: {
+            __m128 scale = _mm_set1_ps(SCALE_S24 * inv_channels);
+            for (; i + 4 <= frames; i += 4) {
+                __m128 acc = _mm_setzero_ps();
+                p = src + (size_t)i * stride;
+                for (c = 0; c < channels; c++, p += 3) {
+                    acc = _mm_add_ps(acc, _mm_cvtepi32_ps(gather_s24(p, stride)));
+                }
+                _mm_storeu_ps(dst + i, _mm_mul_ps(acc, scale));
+            }
+            break;
+        }
+        case PCM_S32: {
+            __m128 scale = _mm_set1_ps(SCALE_S32 * inv_channels);
+            for (; i + 4 <= frames; i += 4) {
+                __m128 acc = _mm_setzero_ps();
+                p = src + (size_t)i * stride;
+                for (c = 0; c < channels; c++, p += 4) {
+                    acc = _mm_add_ps(acc, _mm_cvtepi32_ps(gather_s32(p, stride)));
+                }
+                _mm_storeu_ps(dst + i, _mm_mul_ps(acc, scale));
+            }
+            break;
+        }
+        case PCM_F32: {
+            __m128 scale = _mm_set1_ps(inv_channels);
+            for (; i + 4 <= frames; i += 4) {
+                __m128 acc = _mm_setzero_ps();
+                p = src + (size_t)i * stride;
+                for (c = 0; c < channels; c++, p += 4) {
+                    acc = _mm_add_ps(acc, gather_f32(p, stride));
+                }
+                _mm_storeu_ps(dst + i, _mm_mul_ps(acc, scale));
+            }
+            break;
+        }
+    }
+    return i;
+}
+
+/* Guarda 4 frames como L/R o M/S y, si se pidió, la mezcla mono (el medio) */
+static void store_pair_ps(__m128 l, __m128 r, float *a, float *b, float *mono, int mid_side) {
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 mid = _mm_mul_ps(_mm_add_ps(l, r), half);
+
+    if (mid_side) {
+        _mm_storeu_ps(a, mid);
+        _mm_storeu_ps(b, _mm_mul_ps(_mm_sub_ps(l, r), half));
+    } else {
+        _mm_storeu_ps(a, l);
+        _mm_storeu_ps(b, r);
+    }
+    if (mono) {
+        _mm_storeu_ps(mono, mid);
+    }
+}
+
+/**
+ * Los dos primeros canales por separado, 4 frames por vector. En estéreo se cargan los
+ * frames contiguos y se separan con los shuffles de sum_pairs_ps; con 1 o más de 2
+ * canales, cargas salteadas. Un bucle por formato.
+ */
+static int decode_pair_sse2(const unsigned char *src, float *a, float *b, float *mono, int frames,
+                            int channels, pcm_format_t fmt, int mid_side) {
+    int bps = pcm_bytes_per_sample(fmt);
+    int stride = bps * channels;
+    int second = (channels > 1) ? bps : 0;
+    const unsigned char *p;
+    __m128 l, r;
+    int i = 0;
+
+    switch (fmt) {
+        case PCM_S16: {
+            __m128 scale = _mm_set1_ps(SCALE_S16);
+            for (; i + 4 <= frames; i += 4) {
+                p = src + (size_t)i * stride;
+                if (channels == 2) {
+                    __m128i x = _mm_loadu_si128((const __m128i *)p);
+                    split_pairs_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)),
+                                   _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)),
+                                   &l, &r);
+                } else {
+                    l = _mm_cvtepi32_ps(gather_s16(p, stride));
+                    r = _mm_cvtepi32_ps(gather_s16(p + second, stride));
+                }
+                store_pair_ps(_mm_mul_ps(l, scale), _mm_mul_ps(r, scale), a + i, b + i,
+                              mono ? mono + i : NULL, mid_side);
+            }
+            break;
+        }
+        case PCM_S24: {
+            __m128 scale = _mm_set1_ps(SCALE_S24);
+            for (; i + 4 <= frames; i += 4) {
+                p = src + (size_t)i * stride;
+                l = _mm_cvtepi32_ps(gather_s24(p, stride));
+                r = _mm_cvtepi32_ps(gather_s24(p + second, stride));
+                store_pair_ps(_mm_mul_ps(l, scale), _mm_mul_ps(r, scale), a + i, b + i,
+                              mono ? mono + i : NULL, mid_side);
+            }
+            break;
+        }
+        case PCM_S32: {
+            __m128 scale = _mm_set1_ps(SCALE_S32);
+            for (; i + 4 <= frames; i += 4) {
+                p = src + (size_t)i * stride;
+                if (channels == 2) {
+                    split_pairs_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)p)),
+                                   _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(p + 16))),
+                                   &l, &r);
+                } else {
+                    l = _mm_cvtepi32_ps(gather_s32(p, stride));
+                    r = _mm_cvtepi32_ps(gather_s32(p + second, stride));
+                }
+                store_pair_ps(_mm_mul_ps(l, scale), _mm_mul_ps(r, scale), a + i, b + i,
+                              mono ? mono + i : NULL, mid_side);
+            }
+            break;
+        }
+        case PCM_F32:
+            for (; i + 4 <= frames; i += 4) {
+                p = src + (size_t)i * stride;
+                if (channels == 2) {
+                    split_pairs_ps(_mm_loadu_ps((const float *)p), _mm_loadu_ps((const float *)(p + 16)),
+                                   &l, &r);
+                } else {
+                    l = gather_f32(p, stride);
+                    r = gather_f32(p + second, stride);
+                }
+                store_pair_ps(l, r, a + i, b + i, mono ? mono + i : NULL, mid_side);
+            }
+            break;
+    }
+    return i;
+}
+
+#endif /* PCM_USE_SSE2 */
+
+void pcm_decode_downmix(const void *src, float *dst, int frames, int channels, pcm_format_t fmt) {
+    const unsigned char *bytes = (const unsigned char *)src;
+    int done = 0;
+
+    /* 1. Kernel especializado para los casos comunes (mono y estéreo) */
+    if (channels == 1 || channels == 2) {
+        switch (fmt) {
+#ifdef PCM_USE_SSE2
+            case PCM_S16: done = decode_s16_sse2(bytes, dst, frames, channels); break;
+            case PCM_S32: done = decode_s32_sse2(bytes, dst, frames, channels); break;
+            case PCM_F32: done = decode_f32_sse2(bytes, dst, frames, channels); break;
+#endif
+            case PCM_S24: done = decode_s24_12(bytes, dst, frames, channels); break;
+            default: break;
+        }
+    }
+#ifdef PCM_USE_SSE2
+    else {
+        /* Multicanal (5.1, 7.1, ...): todos los canales en una pasada, 4 frames por vector */
+        done = decode_multi_sse2(bytes, dst, frames, channels, fmt);
+    }
+#endif
+
+    /* 2. El resto (cola del vector o >2 canales) por el camino genérico */
+    if (done < frames) {
+        decode_generic(bytes + (size_t)done * channels * pcm_bytes_per_sample(fmt),
+                       dst + done, frames - done, channels, fmt);
+    }
+}
+
+/* Camino escalar de pcm_decode_pair (cola del vector o sin SSE2) */
+static void decode_pair_generic(const unsigned char *src, float *a, float *b, float *mono,
+                                int frames, int channels, pcm_format_t fmt, int mid_side) {
+    int bps = pcm_bytes_per_sample(fmt);
+    int i;
+
+    convert_channel(src, bps * channels, frames, fmt, a, 0);
+    convert_channel(src + (channels > 1 ? bps : 0), bps * channels, frames, fmt, b, 0);
+    for (i = 0; i < frames; i++) {
+        float left = a[i], right = b[i];
+        float mid = (left + right) * 0.5f;
+
+        if (mono) mono[i] = mid;
+        if (mid_side) {
+            a[i] = mid;
+            b[i] = (left - right) * 0.5f;
+        }
+    }
+}
+
+void pcm_decode_pair(const void *src, float *a, float *b, float *mono, int frames, int channels,
+                     pcm_format_t fmt, int mid_side) {
+    const unsigned char *bytes = (const unsigned char *)src;
+    /* Con 1 o 2 canales la mezcla mono es el medio: sale en la misma pasada */
+    float *pair_mono = (channels <= 2) ? mono : NULL;
+    int done = 0;
+
+#ifdef PCM_USE_SSE2
+    done = decode_pair_sse2(bytes, a, b, pair_mono, frames, channels, fmt, mid_side);
+#endif
+    if (done < frames) {
+        decode_pair_generic(bytes + (size_t)done * channels * pcm_bytes_per_sample(fmt),
+                            a + done, b + done, pair_mono ? pair_mono + done : NULL,
+                            frames - done, channels, fmt, mid_side);
+    }
+
+    /* Con más canales la mezcla incluye a todos: pasada aparte por el kernel multicanal */
+    if (mono && channels > 2) {
+        pcm_decode_downmix(src, mono, frames, channels, fmt);
+    }
+}
@@ -0,0 +1,246 @@
+/* src/profile.c */
+#define _GNU_SOURCE
+#include "profile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "mpi_utils.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* Bytes que trae de memoria cada fallo de LLC (una línea de caché) */
+#define PROFILE_LINE_BYTES 64.0
+
+static const char* counter_names[PROFILE_COUNTERS] = {
+    "ciclos", "instrucciones", "fallos L1d", "fallos LLC", "saltos mal predichos", "task-clock"
+};
+
+static const char* stage_names[PROFILE_STAGES] = { "stft", "bpm" };
+
+struct Profile {
+    int fd[PROFILE_COUNTERS];                        /* -1 = no disponible */
+    int open_errno;                                  /* motivo del primer contador que falló */
+    double start[PROFILE_COUNTERS];                  /* lectura de profile_begin */
+    double t_start;
+    double values[PROFILE_STAGES][PROFILE_COUNTERS];
+    double frames[PROFILE_STAGES];
+    double flops[PROFILE_STAGES];
+    double seconds[PROFILE_STAGES];
+};
+
+#ifdef __linux__
+/* Abre un contador del proceso (todas las CPUs en las que corra, solo espacio de usuario) */
+static int open_counter(int counter) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    /* Si el kernel multiplexa los contadores, las lecturas se escalan por el tiempo activo */
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+    case COUNTER_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case COUNTER_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case COUNTER_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case COUNTER_LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case COUNTER_BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_TASK_CLOCK;
+        break;
+    }
+
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Valor escalado de un contador (-1 si no se pudo leer) */
+static double read_counter(int fd) {
+    unsigned long long data[3];   /* valor, tiempo habilitado, tiempo contando */
+
+    if (fd < 0 || read(fd, data, sizeof(data)) != (ssize_t)sizeof(data)) {
+        return -1.0;
+    }
+    if (data[2] == 0) {
+        return 0.0;
+    }
+    return (double)data[0] * ((double)data[1] / (double)data[2]);
+}
+#else
+static int open_counter(int counter) {
+    (void)counter;
+    errno = ENOSYS;
+    return -1;
+}
+
+static double read_counter(int fd) {
+    (void)fd;
+    return -1.0;
+}
+#endif
+
+Profile* profile_create(void) {
+    Profile* profile = calloc(1, sizeof(Profile));
+    int c;
+
+    if (!profile) return NULL;
+
+    for (c = 0; c < PROFILE_COUNTERS; c++) {
+        profile->fd[c] = open_counter(c);
+        if (profile->fd[c] < 0 && profile->open_errno == 0) {
+            profile->open_errno = errno;
+        }
+    }
+    return profile;
+}
+
+void profile_reset(Profile* profile) {
+    if (!profile) return;
+    memset(profile->values, 0, sizeof(profile->values));
+    memset(profile->frames, 0, sizeof(profile->frames));
+    memset(profile->flops, 0, sizeof(profile->flops));
+    memset(profile->seconds, 0, sizeof(profile->seconds));
+}
+
+void profile_begin(Profile* profile) {
+    int c;
+
+    if (!profile) return;
+    for (c = 0; c < PROFILE_COUNTERS; c++) {
+        profile->start[c] = read_counter(profile->fd[c]);
+    }
+    profile->t_start = MPI_Wtime();
+}
+
+void profile_end(Profile* profile, profile_stage_t stage, double frames, double flops) {
+    int c;
+
+    if (!profile) return;
+    profile->seconds[stage] += MPI_Wtime() - profile->t_start;
+    for (c = 0; c < PROFILE_COUNTERS; c++) {
+        double now = read_counter(profile->fd[c]);
+        if (now >= 0.0 && profile->start[c] >= 0.0) {
+            profile->values[stage][c] += now - profile->start[c];
+        }
+    }
+    profile->frames[stage] += frames;
+    profile->flops[stage] += flops;
+}
+
+/* Imprime una métrica o "n/d" si falta alguno de sus contadores */
+static void print_metric(int available, double value, const char* format) {
+    if (available) {
+        printf(format, value);
+    } else {
+        printf("%12s", "n/d");
+    }
+}
+
+void profile_report(Profile* profile, MPI_Comm comm) {
+    /* Por etapa: contadores, frames, flops y si el proceso participó (se suman) */
+    double local_sum[PROFILE_STAGES][PROFILE_COUNTERS + 3], sum[PROFILE_STAGES][PROFILE_COUNTERS + 3];
+    /* Por etapa: tiempo de CPU y segundos del proceso más lento */
+    double local_max[PROFILE_STAGES][2], max[PROFILE_STAGES][2];
+    int local_available[PROFILE_COUNTERS], available[PROFILE_COUNTERS];
+    int rank, procs_number, s, c, missing = 0;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    for (s = 0; s < PROFILE_STAGES; s++) {
+        for (c = 0; c < PROFILE_COUNTERS; c++) {
+            local_sum[s][c] = profile->values[s][c];
+        }
+        local_sum[s][PROFILE_COUNTERS] = profile->frames[s];
+        local_sum[s][PROFILE_COUNTERS + 1] = profile->flops[s];
+        local_sum[s][PROFILE_COUNTERS + 2] = profile->frames[s] > 0.0 ? 1.0 : 0.0;
+        local_max[s][0] = profile->values[s][COUNTER_TASK_CLOCK];
+        local_max[s][1] = profile->seconds[s];
+    }
+    for (c = 0; c < PROFILE_COUNTERS; c++) {
+        local_available[c] = profile->fd[c] >= 0;
+    }
+
+    /* Un contador cuenta solo si todos los procesos lo tienen */
+    reduce_by_node(local_sum, sum, PROFILE_STAGES * (PROFILE_COUNTERS + 3), MPI_DOUBLE, MPI_SUM, comm);
+    reduce_by_node(local_max, max, PROFILE_STAGES * 2, MPI_DOUBLE, MPI_MAX, comm);
+    reduce_by_node(local_available, available, PROFILE_COUNTERS, MPI_INT, MPI_MIN, comm);
+
+    if (rank != 0) return;
+
+    printf("\nPerfil de contadores (%d procesos, sumados):\n", procs_number);
+    printf("%-6s%10s%10s%12s%12s%12s%12s%12s%12s%12s%12s\n", "etapa", "frames", "seg max",
+           "cpu ms", "IPC", "ciclos/fr", "L1d/fr", "LLC/fr", "saltos %", "bytes/FLOP", "desbalance");
+
+    for (s = 0; s < PROFILE_STAGES; s++) {
+        const double* v = sum[s];
+        double frames = v[PROFILE_COUNTERS], flops = v[PROFILE_COUNTERS + 1];
+        double ranks = v[PROFILE_COUNTERS + 2];
+
+        if (frames <= 0.0) continue;
+
+        printf("%-6s%10.0f%10.4f", stage_names[s], frames, max[s][1]);
+        print_metric(available[COUNTER_TASK_CLOCK], v[COUNTER_TASK_CLOCK] / 1e6, "%12.2f");
+        print_metric(available[COUNTER_CYCLES] && available[COUNTER_INSTRUCTIONS] && v[COUNTER_CYCLES] > 0.0,
+                     v[COUNTER_INSTRUCTIONS] / v[COUNTER_CYCLES], "%12.2f");
+        print_metric(available[COUNTER_CYCLES], v[COUNTER_CYCLES] / frames, "%12.0f");
+        print_metric(available[COUNTER_L1D_MISSES], v[COUNTER_L1D_MISSES] / frames, "%12.1f");
+        print_metric(available[COUNTER_LLC_MISSES], v[COUNTER_LLC_MISSES] / frames, "%12.2f");
+        print_metric(available[COUNTER_BRANCH_MISSES] && available[COUNTER_INSTRUCTIONS] &&
+                     v[COUNTER_INSTRUCTIONS] > 0.0,
+                     100.0 * v[COUNTER_BRANCH_MISSES] / v[COUNTER_INSTRUCTIONS], "%12.3f");
+        print_metric(available[COUNTER_LLC_MISSES] && flops > 0.0,
+                     v[COUNTER_LLC_MISSES] * PROFILE_LINE_BYTES / flops, "%12.4f");
+        /* Tiempo de CPU del proceso más lento sobre el promedio de los que participaron */
+        print_metric(available[COUNTER_TASK_CLOCK] && v[COUNTER_TASK_CLOCK] > 0.0,
+                     max[s][0] * ranks / v[COUNTER_TASK_CLOCK], "%12.2f");
+        printf("\n");
+    }
+
+    for (c = 0; c < PROFILE_COUNTERS; c++) {
+        if (!available[c]) {
+            printf("%s%s", missing++ ? ", " : "Contadores no disponibles: ", counter_names[c]);
+        }
+    }
+    if (missing && profile->open_errno != 0) {
+        printf(" (perf_event_open: %s; sin PMU virtualizada o kernel.perf_event_paranoid alto)",
+               strerror(profile->open_errno));
+    }
+    if (missing) {
+        printf("\n");
+    }
+}
+
+void profile_destroy(Profile* profile) {
+    int c;
+
+    if (!profile) return;
+    for (c = 0; c < PROFILE_COUNTERS; c++) {
+        if (profile->fd[c] >= 0) close(profile->fd[c]);
+    }
+    free(profile);
+}
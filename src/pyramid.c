@@ -0,0 +1,329 @@
+/* src/pyramid.c */
+#include "pyramid.h"
+#include "mpi_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <mpi.h>
+
+/* ceil(value / 2^level) */
+static int reduced(int value, int level) {
+    return (value + (1 << level) - 1) >> level;
+}
+
+int pyramid_block_frames(int levels) {
+    int align = PYRAMID_ALIGN(levels);
+    return ((PYRAMID_BLOCK_FRAMES + align - 1) / align) * align;
+}
+
+/**
+ * @brief Reduce un bloque de frames consecutivos del nivel level-1 al nivel level:
+ * cada celda de destino junta hasta 2x2 celdas de origen. El máximo es directo; el
+ * promedio pondera cada celda de origen por cuántas celdas del espectrograma cubre
+ * (las de los bordes cubren menos), así que es el promedio exacto de las originales.
+ *
+ * @param src_max Máximos del nivel anterior (para level 1, el espectrograma)
+ * @param src_mean Promedios del nivel anterior (para level 1, el espectrograma)
+ * @param count Frames del espectrograma que cubre el bloque
+ * @param n_bins Bins del espectrograma
+ * @param level Nivel de destino (>= 1)
+ */
+static void pool_block(const float* src_max, const float* src_mean, int count, int n_bins,
+                       int level, float* dst_max, float* dst_mean) {
+    int span = 1 << (level - 1);           /* celdas originales por lado en el origen */
+    int src_frames = reduced(count, level - 1);
+    int src_bins = reduced(n_bins, level - 1);
+    int dst_frames = reduced(count, level);
+    int dst_bins = reduced(n_bins, level);
+    int t, b, dt, db;
+
+    for (t = 0; t < dst_frames; t++) {
+        for (b = 0; b < dst_bins; b++) {
+            double sum = 0.0, weight = 0.0;
+            float peak = 0.0f;
+
+            for (dt = 0; dt < 2 && 2 * t + dt < src_frames; dt++) {
+                int j = 2 * t + dt;
+                int wt = (count - j * span < span) ? count - j * span : span;
+
+                for (db = 0; db < 2 && 2 * b + db < src_bins; db++) {
+                    int c = 2 * b + db;
+                    int wb = (n_bins - c * span < span) ? n_bins - c * span : span;
+                    size_t src = (size_t)j * src_bins + c;
+
+                    if (src_max[src] > peak) peak = src_max[src];
+                    sum += (double)src_mean[src] * wt * wb;
+                    weight += (double)wt * wb;
+                }
+            }
+
+            dst_max[(size_t)t * dst_bins + b] = peak;
+            dst_mean[(size_t)t * dst_bins + b] = (float)(sum / weight);
+        }
+    }
+}
+
+/**
+ * @brief Reduce nivel por nivel cada bloque de un proceso. Los niveles locales guardan
+ * los bloques concatenados en el mismo orden que mag.
+ */
+static void build_levels(const float* mag, const FrameChunks* chunks, int n_bins, int levels,
+                         float** max, float** mean) {
+    int level, c;
+
+    for (level = 1; level <= levels; level++) {
+        const float* src_max = (level == 1) ? mag : max[level - 1];
+        const float* src_mean = (level == 1) ? mag : mean[level - 1];
+        size_t src_offset = 0, dst_offset = 0;
+
+        for (c = 0; c < chunks->n_chunks; c++) {
+            int count = chunks->counts[c];
+
+            pool_block(src_max + src_offset, src_mean + src_offset, count, n_bins, level,
+                       max[level] + dst_offset, mean[level] + dst_offset);
+            src_offset += (size_t)reduced(count, level - 1) * reduced(n_bins, level - 1);
+            dst_offset += (size_t)reduced(count, level) * reduced(n_bins, level);
+        }
+    }
+}
+
+/* Reserva los niveles de una pirámide de n_frames x n_bins */
+static Pyramid* pyramid_alloc(int n_frames, int n_bins, int levels) {
+    Pyramid* pyramid = calloc(1, sizeof(Pyramid));
+    int level;
+
+    if (!pyramid) {
+        return NULL;
+    }
+
+    pyramid->levels = levels;
+    pyramid->n_frames[0] = n_frames;
+    pyramid->n_bins[0] = n_bins;
+    for (level = 1; level <= levels; level++) {
+        size_t cells;
+
+        pyramid->n_frames[level] = reduced(n_frames, level);
+        pyramid->n_bins[level] = reduced(n_bins, level);
+        cells = (size_t)pyramid->n_frames[level] * pyramid->n_bins[level];
+        pyramid->max[level] = malloc(cells * sizeof(float));
+        pyramid->mean[level] = malloc(cells * sizeof(float));
+        if (!pyramid->max[level] || !pyramid->mean[level]) {
+            free_pyramid(pyramid);
+            return NULL;
+        }
+    }
+    return pyramid;
+}
+
+Pyramid* compute_pyramid(const float* spectrogram, int n_frames, int n_bins, int levels) {
+    Pyramid* pyramid = pyramid_alloc(n_frames, n_bins, levels);
+    FrameChunks whole = FRAME_CHUNKS_INIT;
+    int start = 0;
+
+    if (!pyramid) {
+        return NULL;
+    }
+
+    /* Todo el espectrograma es un único bloque */
+    whole.starts = &start;
+    whole.counts = &n_frames;
+    whole.n_chunks = 1;
+    build_levels(spectrogram, &whole, n_bins, levels, pyramid->max, pyramid->mean);
+    return pyramid;
+}
+
+Pyramid* compute_pyramid_parallel(const float* mag_local, const FrameChunks* chunks,
+                                  int n_frames, int n_bins, int levels, MPI_Comm comm) {
+    Pyramid* pyramid = NULL;
+    float* local_max[MAX_PYRAMID_LEVELS + 1];
+    float* local_mean[MAX_PYRAMID_LEVELS + 1];
+    float* temp = NULL;
+    FrameChunks scaled = FRAME_CHUNKS_INIT;
+    int local_frames[MAX_PYRAMID_LEVELS + 1];
+    int n_chunks = chunks->n_chunks > 0 ? chunks->n_chunks : 1;
+    int rank, level, c;
+
+    MPI_Comm_rank(comm, &rank);
+
+    /* 1. Niveles locales: cada proceso reduce sus propios bloques */
+    for (level = 1; level <= levels; level++) {
+        local_frames[level] = 0;
+        for (c = 0; c < chunks->n_chunks; c++) {
+            local_frames[level] += reduced(chunks->counts[c], level);
+        }
+        local_max[level] = malloc(((size_t)local_frames[level] * reduced(n_bins, level) + 1) * sizeof(float));
+        local_mean[level] = malloc(((size_t)local_frames[level] * reduced(n_bins, level) + 1) * sizeof(float));
+        if (!local_max[level] || !local_mean[level]) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la piramide\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    build_levels(mag_local, chunks, n_bins, levels, local_max, local_mean);
+
+    /* 2. Rank 0 recibe cada nivel en orden temporal (buffer del nivel 1, el más grande) */
+    if (rank == 0) {
+        pyramid = pyramid_alloc(n_frames, n_bins, levels);
+        temp = malloc((size_t)reduced(n_frames, 1) * reduced(n_bins, 1) * sizeof(float));
+        if (!pyramid || !temp) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para la piramide\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    scaled.starts = malloc(n_chunks * sizeof(int));
+    scaled.counts = malloc(n_chunks * sizeof(int));
+    if (!scaled.starts || !scaled.counts) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para la piramide\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    scaled.n_chunks = chunks->n_chunks;
+    scaled.capacity = n_chunks;
+
+    for (level = 1; level <= levels; level++) {
+        /* Los bloques empiezan alineados: en el nivel k ocupan [start/2^k, ...) */
+        for (c = 0; c < chunks->n_chunks; c++) {
+            scaled.starts[c] = chunks->starts[c] >> level;
+            scaled.counts[c] = reduced(chunks->counts[c], level);
+        }
+
+        gather_chunked_spectrogram(local_max[level], local_frames[level], &scaled,
+                                   reduced(n_frames, level), reduced(n_bins, level), comm,
+                                   temp, rank == 0 ? pyramid->max[level] : NULL);
+        gather_chunked_spectrogram(local_mean[level], local_frames[level], &scaled,
+                                   reduced(n_frames, level), reduced(n_bins, level), comm,
+                                   temp, rank == 0 ? pyramid->mean[level] : NULL);
+
+        free(local_max[level]);
+        free(local_mean[level]);
+    }
+
+    free_frame_chunks(&scaled);
+    free(temp);
+    return pyramid;
+}
+
+/**
+ * @brief Escribe un nivel como tiles de PYRAMID_TILE x PYRAMID_TILE (relleno con 0).
+ * @return 0 si se escribió, -1 si no
+ */
+static int write_tiles(const char* filename, const float* data, int n_frames, int n_bins,
+                       float* tile) {
+    FILE* f = fopen(filename, "wb");
+    int tiles_t = (n_frames + PYRAMID_TILE - 1) / PYRAMID_TILE;
+    int tiles_b = (n_bins + PYRAMID_TILE - 1) / PYRAMID_TILE;
+    int tt, tb, t, width, height;
+
+    if (!f) {
+        perror(filename);
+        return -1;
+    }
+
+    for (tt = 0; tt < tiles_t; tt++) {
+        height = n_frames - tt * PYRAMID_TILE;
+        if (height > PYRAMID_TILE) height = PYRAMID_TILE;
+
+        for (tb = 0; tb < tiles_b; tb++) {
+            width = n_bins - tb * PYRAMID_TILE;
+            if (width > PYRAMID_TILE) width = PYRAMID_TILE;
+
+            memset(tile, 0, (size_t)PYRAMID_TILE * PYRAMID_TILE * sizeof(float));
+            for (t = 0; t < height; t++) {
+                memcpy(tile + (size_t)t * PYRAMID_TILE,
+                       data + (size_t)(tt * PYRAMID_TILE + t) * n_bins + tb * PYRAMID_TILE,
+                       width * sizeof(float));
+            }
+            if (fwrite(tile, sizeof(float), (size_t)PYRAMID_TILE * PYRAMID_TILE, f)
+                    != (size_t)PYRAMID_TILE * PYRAMID_TILE) {
+                perror(filename);
+                fclose(f);
+                return -1;
+            }
+        }
+    }
+
+    if (fclose(f) != 0) {
+        perror(filename);
+        return -1;
+    }
+    return 0;
+}
+
+int write_pyramid(const char* dir, const Pyramid* pyramid, const float* spectrogram,
+                  const Config* cfg) {
+    char pyramid_dir[MAX_PATH], index_path[MAX_PATH + 32], path[MAX_PATH + 32];
+    char max_name[32], mean_name[32];
+    float* tile;
+    FILE* index;
+    int level, status = 0;
+
+    sprintf(pyramid_dir, "%s/pyramid", dir);
+    mkdir(pyramid_dir, 0755);
+
+    tile = malloc((size_t)PYRAMID_TILE * PYRAMID_TILE * sizeof(float));
+    if (!tile) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para los tiles de la piramide\n");
+        return -1;
+    }
+
+    sprintf(index_path, "%s/index.csv", pyramid_dir);
+    index = fopen(index_path, "w");
+    if (!index) {
+        perror(index_path);
+        free(tile);
+        return -1;
+    }
+
+    fprintf(index, "nivel,factor,frames,bins,tile_frames,tile_bins,tiles_tiempo,tiles_frecuencia,"
+                   "segundos_por_frame,hz_por_bin,bin_inicial,archivo_max,archivo_mean\n");
+
+    for (level = 0; level <= pyramid->levels && status == 0; level++) {
+        int n_frames = pyramid->n_frames[level];
+        int n_bins = pyramid->n_bins[level];
+
+        /* El nivel 0 es el espectrograma: máximo y promedio coinciden */
+        if (level == 0) {
+            strcpy(max_name, "nivel0.f32");
+            strcpy(mean_name, max_name);
+            sprintf(path, "%s/%s", pyramid_dir, max_name);
+            status = write_tiles(path, spectrogram, n_frames, n_bins, tile);
+        } else {
+            sprintf(max_name, "nivel%d_max.f32", level);
+            sprintf(mean_name, "nivel%d_mean.f32", level);
+            sprintf(path, "%s/%s", pyramid_dir, max_name);
+            status = write_tiles(path, pyramid->max[level], n_frames, n_bins, tile);
+            if (status == 0) {
+                sprintf(path, "%s/%s", pyramid_dir, mean_name);
+                status = write_tiles(path, pyramid->mean[level], n_frames, n_bins, tile);
+            }
+        }
+
+        fprintf(index, "%d,%d,%d,%d,%d,%d,%d,%d,%.6f,%.6f,%d,%s,%s\n",
+                level, 1 << level, n_frames, n_bins, PYRAMID_TILE, PYRAMID_TILE,
+                (n_frames + PYRAMID_TILE - 1) / PYRAMID_TILE,
+                (n_bins + PYRAMID_TILE - 1) / PYRAMID_TILE,
+                (double)cfg->hop * (1 << level) / cfg->fs,
+                (double)cfg->fs * (1 << level) / cfg->N,
+                cfg->bin_lo, max_name, mean_name);
+    }
+
+    if (fclose(index) != 0) {
+        perror(index_path);
+        status = -1;
+    }
+    free(tile);
+    return status;
+}
+
+void free_pyramid(Pyramid* pyramid) {
+    int level;
+
+    if (!pyramid) return;
+    for (level = 1; level <= pyramid->levels; level++) {
+        free(pyramid->max[level]);
+        free(pyramid->mean[level]);
+    }
+    free(pyramid);
+}
@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "service.h"
+#include "analyzer.h"
+#include "config.h"
+
+/* Mensajes de rank 0 a los demás procesos */
+#define SERVICE_CMD_JOB 1
+#define SERVICE_CMD_SHUTDOWN 2
+
+/* Opciones por trabajo (ruta incluida) */
+#define SERVICE_MAX_ARGS 64
+
+/* Lectura por líneas de una conexión */
+typedef struct {
+    int fd;
+    char data[SERVICE_LINE_MAX];
+    size_t len;
+} LineReader;
+
+/**
+ * Lee la próxima línea (sin el '\n' ni un '\r' final).
+ * @return 1 si hay línea, 0 si la conexión se cerró, -1 si la línea no entra en el buffer
+ */
+static int read_line(LineReader* reader, char* line) {
+    char* newline;
+    ssize_t n;
+
+    for (;;) {
+        newline = memchr(reader->data, '\n', reader->len);
+        if (newline) {
+            size_t line_len = (size_t)(newline - reader->data);
+
+            memcpy(line, reader->data, line_len);
+            line[line_len] = '\0';
+            if (line_len > 0 && line[line_len - 1] == '\r') {
+                line[line_len - 1] = '\0';
+            }
+
+            reader->len -= line_len + 1;
+            memmove(reader->data, newline + 1, reader->len);
+            return 1;
+        }
+
+        if (reader->len == sizeof(reader->data)) {
+            return -1;
+        }
+
+        n = read(reader->fd, reader->data + reader->len, sizeof(reader->data) - reader->len);
+        if (n <= 0) {
+            return 0;
+        }
+        reader->len += (size_t)n;
+    }
+}
+
+/* Envía una línea completa al cliente (si se fue, se ignora) */
+static void reply(int fd, const char* text) {
+    size_t done = 0, len = strlen(text);
+    ssize_t n;
+
+    while (done < len) {
+        n = write(fd, text + done, len - done);
+        if (n <= 0) {
+            return;
+        }
+        done += (size_t)n;
+    }
+}
+
+/* Parte la línea en palabras (en el mismo buffer); devuelve la cantidad */
+static int split_args(char* line, char* argv[], int max_args) {
+    int argc = 0;
+    char* p = line;
+
+    while (*p && argc < max_args) {
+        while (*p == ' ' || *p == '\t') *p++ = '\0';
+        if (!*p) break;
+        argv[argc++] = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+    }
+    return argc;
+}
+
+/*
+ * Opciones que el servicio fija al arrancar (contexto, topología, perfil, afinidad, ajuste)
+ * o que main atiende antes de analizar: en un trabajo no tendrían efecto.
+ * @return el nombre de la opción cambiada, o NULL si el trabajo solo cambia opciones por archivo
+ */
+static const char* job_fixed_option(const Config* base, const Config* job) {
+    if (strcmp(job->serve_path, base->serve_path) != 0) return "--serve";
+    if (strcmp(job->batch_list, base->batch_list) != 0) return "--batch";
+    if (job->profile != base->profile) return "--profile";
+    if (job->huge_pages != base->huge_pages) return "--hugepages";
+    if (job->gather != base->gather) return "--gather";
+    if (job->node_size != base->node_size) return "--node-size";
+    if (job->affinity != base->affinity) return "--affinity";
+    if (job->tune != base->tune || strcmp(job->wisdom_path, base->wisdom_path) != 0) return "--tune";
+    if (job->query_bpm_lo != base->query_bpm_lo || job->query_bpm_hi != base->query_bpm_hi) return "--query-bpm";
+    if (strcmp(job->lookup_path, base->lookup_path) != 0) return "--lookup";
+    return NULL;
+}
+
+/*
+ * Configuración de un trabajo: las opciones de la línea se aplican sobre la base.
+ * @return 0 si es válida, -1 si las opciones son inválidas, -2 si cambia una opción fija
+ *         (su nombre queda en *fixed)
+ */
+static int job_config(const Config* base, char* line, Config* job, char* argv[], int* argc,
+                      const char** fixed) {
+    *argc = split_args(line, argv, SERVICE_MAX_ARGS);
+    if (*argc == 0) {
+        return -1;
+    }
+
+    *job = *base;
+    if (config_parse_args(job, *argc, argv) != 0) {
+        return -1;
+    }
+
+    *fixed = job_fixed_option(base, job);
+    if (*fixed) {
+        fprintf(stderr, "Error: %s no se permite dentro de un trabajo\n", *fixed);
+        return -2;
+    }
+    return 0;
+}
+
+static int open_listen_socket(const char* path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: ruta de socket demasiado larga (%s)\n", path);
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* Un socket viejo de una corrida anterior impide el bind */
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Rank 0: atiende conexiones hasta "shutdown"; cada trabajo válido se difunde y se analiza */
+static void serve_root(Analyzer* analyzer, const Config* cfg, int listen_fd, MPI_Comm comm) {
+    LineReader reader;
+    char line[SERVICE_LINE_MAX];
+    char job_line[SERVICE_LINE_MAX];
+    char response[SERVICE_LINE_MAX + 128];
+    char* argv[SERVICE_MAX_ARGS];
+    int header[2];
+    int argc, got, valid, shutdown = 0, jobs = 0;
+    const char* fixed;
+    Config job;
+    AnalyzerReport report;
+
+    while (!shutdown) {
+        reader.fd = accept(listen_fd, NULL, NULL);
+        reader.len = 0;
+        if (reader.fd < 0) {
+            perror("accept");
+            break;
+        }
+
+        while ((got = read_line(&reader, line)) != 0) {
+            if (got < 0) {
+                reply(reader.fd, "ERROR - linea demasiado larga\n");
+                break;
+            }
+
+            if (strcmp(line, "ping") == 0) {
+                reply(reader.fd, "OK pong\n");
+                continue;
+            }
+            if (strcmp(line, "quit") == 0) {
+                break;
+            }
+            if (strcmp(line, "shutdown") == 0) {
+                reply(reader.fd, "OK shutdown\n");
+                shutdown = 1;
+                break;
+            }
+
+            /* Validamos en rank 0: a los demás solo les llegan trabajos correctos */
+            strcpy(job_line, line);
+            valid = job_config(cfg, line, &job, argv, &argc, &fixed);
+            if (valid == -2) {
+                sprintf(response, "ERROR %s opcion no permitida en un trabajo (%s)\n", argv[0], fixed);
+                reply(reader.fd, response);
+                continue;
+            }
+            if (valid != 0) {
+                sprintf(response, "ERROR %s opciones invalidas\n", argc > 0 ? argv[0] : "-");
+                reply(reader.fd, response);
+                continue;
+            }
+
+            header[0] = SERVICE_CMD_JOB;
+            header[1] = (int)strlen(job_line) + 1;
+            MPI_Bcast(header, 2, MPI_INT, 0, comm);
+            MPI_Bcast(job_line, header[1], MPI_CHAR, 0, comm);
+
+            printf("\nServicio: trabajo %d -> %s\n", ++jobs, argv[0]);
+            fflush(stdout);
+
+            analyzer_set_config(analyzer, &job);
+            if (analyzer_run(analyzer, argv[0], &report) == 0) {
+                sprintf(response, "OK %s %.2f %.3f\n", report.results_dir, report.bpm, report.t_total);
+            } else {
+                sprintf(response, "ERROR %s no se pudo analizar\n", argv[0]);
+            }
+            fflush(stdout);
+            reply(reader.fd, response);
+        }
+
+        close(reader.fd);
+    }
+
+    header[0] = SERVICE_CMD_SHUTDOWN;
+    header[1] = 0;
+    MPI_Bcast(header, 2, MPI_INT, 0, comm);
+}
+
+/* Demás procesos: esperan trabajos de rank 0 y colaboran en cada análisis */
+static void serve_worker(Analyzer* analyzer, const Config* cfg, MPI_Comm comm) {
+    char job_line[SERVICE_LINE_MAX];
+    char* argv[SERVICE_MAX_ARGS];
+    int header[2];
+    int argc;
+    const char* fixed;
+    Config job;
+
+    for (;;) {
+        MPI_Bcast(header, 2, MPI_INT, 0, comm);
+        if (header[0] != SERVICE_CMD_JOB) {
+            break;
+        }
+        MPI_Bcast(job_line, header[1], MPI_CHAR, 0, comm);
+
+        /* Rank 0 ya la validó, así que acá no puede fallar */
+        job_config(cfg, job_line, &job, argv, &argc, &fixed);
+        analyzer_set_config(analyzer, &job);
+        analyzer_run(analyzer, NULL, NULL);
+    }
+}
+
+int service_run(const Config* cfg, MPI_Comm comm) {
+    Analyzer* analyzer;
+    int rank, listen_fd = -1, ok;
+
+    MPI_Comm_rank(comm, &rank);
+
+    /* Rank 0 abre el socket; todos se enteran si se pudo */
+    if (rank == 0) {
+        listen_fd = open_listen_socket(cfg->serve_path);
+        if (listen_fd >= 0) {
+            /* Un cliente que corta antes de la respuesta no debe terminar el servicio */
+            signal(SIGPIPE, SIG_IGN);
+            printf("Servicio escuchando en %s\n", cfg->serve_path);
+            fflush(stdout);
+        }
+    }
+    ok = listen_fd >= 0;
+    MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+    if (!ok) {
+        return -1;
+    }
+
+    analyzer = analyzer_create(cfg, comm);
+    if (!analyzer) {
+        fprintf(stderr, "Error: No se pudo crear el contexto de análisis\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (rank == 0) {
+        serve_root(analyzer, cfg, listen_fd, comm);
+        close(listen_fd);
+        unlink(cfg->serve_path);
+        printf("Servicio terminado\n");
+    } else {
+        serve_worker(analyzer, cfg, comm);
+    }
+
+    analyzer_destroy(analyzer);
+    return 0;
+}
@@ -5,6 +5,9 @@
 #include "common.h"
 #include "window.h"
 #include "fft.h"
+#include "mpi_utils.h"
+#include "band.h"
+#include "arena.h"
 
 /**
  * Calcula el STFT solo para los frames asignados a este proceso.
@@ -27,58 +30,379 @@ int calculate_local_frames(int rank, int n_frames, int procs_number) {
     return local_frames;
 }
 
+int calculate_block_frames(int rank, int n_frames, int procs_number, int block) {
+    int local_frames = 0;
+    int start;
+    for (start = rank * block; start < n_frames; start += procs_number * block) {
+        local_frames += (start + block <= n_frames) ? block : n_frames - start;
+    }
+    return local_frames;
+}
+
+/* Estado reutilizable entre frames: plan de FFT, ventana precalculada y buffers */
+struct StftWorkspace {
+    int N;
+    int hop;
+    win_t wtype;
+    int bin_lo;
+    int bin_hi;
+    fft_kernel_t fft_kernel;
+    FFTPlan* plan;
+    Arena* arena;      /* memoria de window/real/imaginary (alineada a ARENA_ALIGN) */
+    float* window;     /* coeficientes de la ventana (N) */
+    float* real;       /* N */
+    float* imaginary;  /* N */
+    BandPlan* band;    /* solo con banda limitada: calcula únicamente [bin_lo, bin_hi] */
+};
+
+void stft_workspace_destroy(StftWorkspace* ws) {
+    if (!ws) return;
+    fft_plan_destroy(ws->plan);
+    band_plan_destroy(ws->band);
+    arena_destroy(ws->arena);
+    free(ws);
+}
+
+StftWorkspace* stft_workspace_create(const Config* cfg) {
+    StftWorkspace* ws;
+    int k;
+    int banded = cfg->bin_lo != 0 || cfg->bin_hi != STFT_NBINS(cfg->N) - 1;
+
+    ws = calloc(1, sizeof(StftWorkspace));
+    if (!ws) return NULL;
+
+    ws->N = cfg->N;
+    ws->hop = cfg->hop;
+    ws->wtype = cfg->wtype;
+    ws->bin_lo = cfg->bin_lo;
+    ws->bin_hi = cfg->bin_hi;
+    ws->fft_kernel = cfg->fft_kernel;
+
+    /* Los tres arrays de un frame juntos y alineados para cargas vectoriales */
+    ws->arena = arena_create(3 * (size_t)cfg->N * sizeof(float) + 3 * ARENA_ALIGN, 0);
+    if (ws->arena) {
+        ws->window = arena_alloc(ws->arena, cfg->N * sizeof(float));
+        ws->real = arena_alloc(ws->arena, cfg->N * sizeof(float));
+        ws->imaginary = arena_alloc(ws->arena, cfg->N * sizeof(float));
+    }
+
+    /* Con banda limitada el plan de banda reemplaza a la FFT completa */
+    if (banded) {
+        ws->band = band_plan_create(cfg->N, cfg->bin_lo, cfg->bin_hi);
+    } else {
+        ws->plan = fft_plan_create_kernel(cfg->N, cfg->fft_kernel);
+    }
+
+    if (!(ws->plan || ws->band) || !ws->window || !ws->real || !ws->imaginary) {
+        stft_workspace_destroy(ws);
+        return NULL;
+    }
+
+    /* La ventana se calcula una sola vez (aplicarla sobre unos da sus coeficientes) */
+    for (k = 0; k < cfg->N; k++) {
+        ws->window[k] = 1.0f;
+    }
+    window_apply(ws->window, cfg->N, cfg->wtype);
+    return ws;
+}
+
+int stft_workspace_matches(const StftWorkspace* ws, const Config* cfg) {
+    return ws && ws->N == cfg->N && ws->hop == cfg->hop && ws->wtype == cfg->wtype &&
+           ws->bin_lo == cfg->bin_lo && ws->bin_hi == cfg->bin_hi && ws->fft_kernel == cfg->fft_kernel;
+}
+
+/**
+ * Pipeline de STFT para un único frame: extrae, ventanea, transforma y guarda magnitudes.
+ *
+ * @param ws Plan, ventana y buffers del proceso.
+ * @param samples Array completo de muestras de audio.
+ * @param i Índice global del frame.
+ * @param n_bins Cantidad de bins a guardar (los de la banda si está limitada).
+ * @param out Destino de las n_bins magnitudes.
+ */
+static void stft_frame(StftWorkspace* ws, const float* samples, int i, int n_bins, float* out) {
+    const float* frame = samples + (size_t)i * ws->hop;
+    float r, imv;
+    int k;
+
+    /* PASOS 1-3: Extraer el frame, aplicar la ventana y preparar arrays para la FFT */
+    for (k = 0; k < ws->N; k++) {
+        ws->real[k] = frame[k] * ws->window[k];
+        ws->imaginary[k] = 0.0f;
+    }
+
+    /* Banda limitada: Goertzel o FFT podada calculan solo los bins pedidos */
+    if (ws->band) {
+        band_magnitudes(ws->band, ws->real, out);
+        return;
+    }
+    
+    /* PASO 4: Aplicar FFT (cualquier N, ver fft_plan_create) */
+    fft_execute(ws->plan, ws->real, ws->imaginary);
+
+    /* PASO 5: Calcular magnitudes */
+    for (k = 0; k < n_bins; k++) {
+        r = ws->real[k];
+        imv = ws->imaginary[k];
+        out[k] = (float)sqrt(r * r + imv * imv);
+    }
+}
+
+void stft_compute_cyclic(StftWorkspace* ws, const float* samples, int rank, int procs_number,
+                         int n_frames, int n_bins, float* mag_local) {
+    size_t idx_local = 0;
+    int i;
+
+    /* Bucle de procesamiento principal (distribución cíclica) */
+    for (i = rank; i < n_frames; i += procs_number) {
+        stft_frame(ws, samples, i, n_bins, mag_local + idx_local * n_bins);
+        idx_local++;
+    }
+}
+
+int stft_compute_pair_cyclic(StftWorkspace* ws, const float* a, const float* b, const float* mix, int rank,
+                             int procs_number, int n_frames, int bin_lo, int n_bins, stereo_t mode,
+                             float* mag_mono, float* mag_a, float* mag_b) {
+    size_t idx_local = 0;
+    int i, k;
+
+    if (!ws->plan) {
+        return -1;
+    }
+
+    for (i = rank; i < n_frames; i += procs_number) {
+        const float* fa = a + (size_t)i * ws->hop;
+        const float* fb = b + (size_t)i * ws->hop;
+        float* out_a = mag_a + idx_local * n_bins;
+        float* out_b = mag_b + idx_local * n_bins;
+        float* out_mono = mag_mono + idx_local * n_bins;
+
+        /* Un canal en la parte real y el otro en la imaginaria: una sola FFT para los dos */
+        for (k = 0; k < ws->N; k++) {
+            ws->real[k] = fa[k] * ws->window[k];
+            ws->imaginary[k] = fb[k] * ws->window[k];
+        }
+        fft_execute(ws->plan, ws->real, ws->imaginary);
+
+        /* Separación por simetría conjugada: A[k] = (Z[k] + conj(Z[N-k])) / 2,
+           B[k] = (Z[k] - conj(Z[N-k])) / 2i */
+        for (k = 0; k < n_bins; k++) {
+            int bin = bin_lo + k;
+            int mirror = (bin == 0) ? 0 : ws->N - bin;
+            float zr = ws->real[bin], zi = ws->imaginary[bin];
+            float cr = ws->real[mirror], ci = ws->imaginary[mirror];
+            float ar = 0.5f * (zr + cr), ai = 0.5f * (zi - ci);
+            float br = 0.5f * (zi + ci), bi = 0.5f * (cr - zr);
+
+            out_a[k] = (float)sqrt(ar * ar + ai * ai);
+            out_b[k] = (float)sqrt(br * br + bi * bi);
+
+            /* La mezcla mono sale gratis: (L + R) / 2, o el canal medio */
+            if (mode == STEREO_MS) {
+                out_mono[k] = out_a[k];
+            } else {
+                float mr = 0.5f * (ar + br), mi = 0.5f * (ai + bi);
+                out_mono[k] = (float)sqrt(mr * mr + mi * mi);
+            }
+        }
+
+        /* Más de dos canales: la mezcla no sale de los dos primeros, FFT propia */
+        if (mix) {
+            const float* fm = mix + (size_t)i * ws->hop;
+
+            for (k = 0; k < ws->N; k++) {
+                ws->real[k] = fm[k] * ws->window[k];
+                ws->imaginary[k] = 0.0f;
+            }
+            fft_execute(ws->plan, ws->real, ws->imaginary);
+            for (k = 0; k < n_bins; k++) {
+                float r = ws->real[bin_lo + k], imv = ws->imaginary[bin_lo + k];
+                out_mono[k] = (float)sqrt(r * r + imv * imv);
+            }
+        }
+        idx_local++;
+    }
+    return 0;
+}
+
 float* compute_stft_local(float* samples, int n_samples, int rank, int procs_number, 
-                          int n_frames, int n_bins, int local_frames) {
+                          int n_frames, int n_bins, int local_frames, const Config* cfg) {
     
     float *mag_local;
-    int idx_local;
-    int i, k;
+    StftWorkspace* ws;
     
     /* 1. Reservar memoria para los resultados de este proceso */
-    mag_local = malloc(local_frames * n_bins * sizeof(float));
+    mag_local = malloc((size_t)local_frames * n_bins * sizeof(float) + sizeof(float));
     
     if (!mag_local) {
         return NULL;
     }
 
-    idx_local = 0;
+    ws = stft_workspace_create(cfg);
+    if (!ws) {
+        free(mag_local);
+        return NULL;
+    }
+
+    /* 2. Procesar los frames de este proceso */
+    stft_compute_cyclic(ws, samples, rank, procs_number, n_frames, n_bins, mag_local);
 
-    /* 2. Bucle de procesamiento principal (distribución cíclica) */
-    for (i = rank; i < n_frames; i += procs_number) {
-        float frame[DEFAULT_N];
-        float real[DEFAULT_N];
-        float imaginary[DEFAULT_N];
-        float r, imv;
-
-        /* --- INICIO DEL PIPELINE DE STFT (para el frame 'i') --- */
-        
-        /* PASO 1: Extraer el frame del audio */
-        memcpy(frame, samples + i * DEFAULT_HOP, sizeof(float) * DEFAULT_N);
-        
-        /* PASO 2: Aplicar la ventana */
-        window_apply(frame, DEFAULT_N, WIN_HANN);
-
-        /* PASO 3: Preparar arrays para la FFT */
-        for (k = 0; k < DEFAULT_N; k++) {
-            real[k] = frame[k];
-            imaginary[k] = 0.0f;
+    stft_workspace_destroy(ws);
+
+    /* 3. Devolver el puntero al bloque de resultados locales */
+    return mag_local;
+}
+
+/* Agrega un bloque [start, start+count) a la lista de bloques del proceso */
+static int chunks_push(FrameChunks* chunks, int start, int count) {
+    if (chunks->n_chunks == chunks->capacity) {
+        int new_capacity = chunks->capacity ? chunks->capacity * 2 : 64;
+        int* starts = realloc(chunks->starts, new_capacity * sizeof(int));
+        int* counts;
+        if (!starts) return -1;
+        chunks->starts = starts;
+        counts = realloc(chunks->counts, new_capacity * sizeof(int));
+        if (!counts) return -1;
+        chunks->counts = counts;
+        chunks->capacity = new_capacity;
+    }
+    chunks->starts[chunks->n_chunks] = start;
+    chunks->counts[chunks->n_chunks] = count;
+    chunks->n_chunks++;
+    return 0;
+}
+
+int stft_compute_blocks(StftWorkspace* ws, const float* samples, int rank, int procs_number,
+                        int n_frames, int n_bins, int block, float* mag_local, FrameChunks* chunks) {
+    size_t idx_local = 0;
+    int start, count, i;
+
+    chunks->n_chunks = 0;
+
+    /* Bloque b al proceso b % procs_number (cíclica por bloques) */
+    for (start = rank * block; start < n_frames; start += procs_number * block) {
+        count = (start + block <= n_frames) ? block : n_frames - start;
+        if (chunks_push(chunks, start, count) != 0) {
+            return -1;
+        }
+        for (i = 0; i < count; i++) {
+            stft_frame(ws, samples, start + i, n_bins, mag_local + idx_local * n_bins);
+            idx_local++;
+        }
+    }
+    return 0;
+}
+
+int stft_compute_complex(StftWorkspace* ws, const float* samples, int first, int count,
+                         float* spec_re, float* spec_im, FrameChunks* chunks) {
+    int n_full = STFT_NBINS(ws->N);
+    size_t offset;
+    int f, k;
+
+    /* Solo con la FFT completa quedan todos los bins para volver al tiempo */
+    if (ws->band) {
+        return -1;
+    }
+
+    chunks->n_chunks = 0;
+    if (count > 0 && chunks_push(chunks, first, count) != 0) {
+        return -1;
+    }
+
+    for (f = 0; f < count; f++) {
+        const float* frame = samples + (size_t)(first + f) * ws->hop;
+
+        for (k = 0; k < ws->N; k++) {
+            ws->real[k] = frame[k] * ws->window[k];
+            ws->imaginary[k] = 0.0f;
         }
-        
-        /* PASO 4: Aplicar FFT */
-        fft_inplace(real, imaginary, DEFAULT_N);
+        fft_execute(ws->plan, ws->real, ws->imaginary);
+
+        /* La otra mitad del espectro es la conjugada: se guarda solo hasta N/2 */
+        offset = (size_t)f * n_full;
+        memcpy(spec_re + offset, ws->real, n_full * sizeof(float));
+        memcpy(spec_im + offset, ws->imaginary, n_full * sizeof(float));
+    }
+    return 0;
+}
+
+void stft_magnitudes(const float* spec_re, const float* spec_im, int count, int n_full,
+                     int bin_lo, int n_bins, float* mag) {
+    float r, imv;
+    size_t src;
+    int f, k;
 
-        /* PASO 5: Calcular magnitudes */
+    for (f = 0; f < count; f++) {
         for (k = 0; k < n_bins; k++) {
-            r = real[k];
-            imv = imaginary[k];
-            mag_local[idx_local * n_bins + k] = (float)sqrt(r * r + imv * imv);
+            src = (size_t)f * n_full + bin_lo + k;
+            r = spec_re[src];
+            imv = spec_im[src];
+            mag[(size_t)f * n_bins + k] = (float)sqrt(r * r + imv * imv);
         }
-        
-        idx_local++;
     }
+}
 
-    /* --- FIN DEL PIPELINE --- */
+int compute_stft_dynamic(StftWorkspace* ws, const float* samples, int n_frames, int n_bins,
+                         int chunk_min, int align, MPI_Comm comm, GrowBuffer* mag_local,
+                         int* local_frames, FrameChunks* chunks) {
+    WorkCounter counter;
+    float* mag;
+    int procs_number, start, chunk, count, seen, i, failed = 0;
 
-    /* 3. Devolver el puntero al bloque de resultados locales */
-    return mag_local;
-}
\ No newline at end of file
+    MPI_Comm_size(comm, &procs_number);
+    if (chunk_min < 1) chunk_min = 1;
+    if (align < 1) align = 1;
+
+    /* Los bloques de la corrida anterior se descartan, la memoria se conserva */
+    *local_frames = 0;
+    chunks->n_chunks = 0;
+
+    if (work_counter_create(&counter, comm) != 0) {
+        return -1;
+    }
+
+    /* Estimación del primer valor del contador (nadie reclamó nada todavía) */
+    seen = 0;
+
+    while (!failed) {
+        /* 1. Tamaño guiado: la mitad de lo que queda repartido entre los procesos */
+        chunk = (n_frames - seen) / (2 * procs_number);
+        if (chunk < chunk_min) chunk = chunk_min;
+        chunk = ((chunk + align - 1) / align) * align;
+
+        /* 2. Reclamar el bloque de forma atómica */
+        start = work_counter_next(&counter, chunk);
+        if (start >= n_frames) {
+            break;
+        }
+        count = (start + chunk <= n_frames) ? chunk : n_frames - start;
+        seen = start + count;
+
+        /* El destino crece con lo reclamado: solo se reserva lo que este proceso calcula */
+        mag = grow_buffer_reserve(mag_local, (size_t)(*local_frames + count) * n_bins * sizeof(float));
+        if (!mag || chunks_push(chunks, start, count) != 0) {
+            failed = 1;
+            break;
+        }
+
+        /* 3. Procesar los frames del bloque, a continuación de los ya calculados */
+        for (i = 0; i < count; i++) {
+            stft_frame(ws, samples, start + i, n_bins, mag + (size_t)(*local_frames + i) * n_bins);
+        }
+        *local_frames += count;
+    }
+
+    /* Todos deben terminar de reclamar antes de liberar la ventana RMA */
+    work_counter_free(&counter);
+
+    return failed ? -1 : 0;
+}
+
+void free_frame_chunks(FrameChunks* chunks) {
+    free(chunks->starts);
+    free(chunks->counts);
+    chunks->starts = NULL;
+    chunks->counts = NULL;
+    chunks->n_chunks = 0;
+    chunks->capacity = 0;
+}
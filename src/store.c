@@ -0,0 +1,523 @@
+/* src/store.c */
+#define _GNU_SOURCE
+#include "store.h"
+#include "wav.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define STORE_MAGIC "PAAS"
+#define STORE_INDEX_MAGIC "PAAI"
+#define STORE_VERSION 1
+
+/* Registros que se leen de una vez al recorrer records.bin */
+#define STORE_READ_BATCH 1024
+
+/* Encabezado de records.bin */
+typedef struct {
+    char magic[4];
+    int version;
+    int record_size;   /* sizeof(StoreRecord): otro valor = otro formato */
+    int reserved;
+} StoreHeader;
+
+/* Encabezado de index.bin */
+typedef struct {
+    char magic[4];
+    int version;
+    uint64_t n_records;  /* el índice cubre los registros [0, n_records) */
+    uint64_t n_entries;
+} IndexHeader;
+
+/* Entrada del índice: la última aparición de cada ruta */
+typedef struct {
+    uint64_t hash;
+    uint64_t record;
+} IndexEntry;
+
+uint64_t store_path_hash(const char* path) {
+    return wav_hash_bytes(path, strlen(path), 0);
+}
+
+static void store_file_path(char* out, const char* dir, const char* name) {
+    sprintf(out, "%s/%s", dir, name);
+}
+
+static uint32_t record_check(const StoreRecord* record) {
+    return (uint32_t)wav_hash_bytes(record, offsetof(StoreRecord, check), 0);
+}
+
+static int write_full(int fd, const void* data, size_t len) {
+    const char* p = (const char*)data;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void* data, size_t len, off_t offset) {
+    char* p = (char*)data;
+
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+/* Valida el encabezado de records.bin; devuelve la cantidad de registros completos o -1 */
+static long count_records(int fd) {
+    StoreHeader header;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || read_full(fd, &header, sizeof(header), 0) != 0 ||
+        memcmp(header.magic, STORE_MAGIC, 4) != 0 || header.version != STORE_VERSION ||
+        header.record_size != (int)sizeof(StoreRecord)) {
+        return -1;
+    }
+    return (long)((st.st_size - (off_t)sizeof(StoreHeader)) / (off_t)sizeof(StoreRecord));
+}
+
+static off_t record_offset(uint64_t record) {
+    return (off_t)sizeof(StoreHeader) + (off_t)record * (off_t)sizeof(StoreRecord);
+}
+
+/* Lee el índice (sin índice: 0 registros cubiertos). entries puede ser NULL (solo el encabezado) */
+static int load_index(const char* dir, IndexHeader* header, IndexEntry** entries) {
+    char path[MAX_PATH + 16];
+    FILE* f;
+
+    memset(header, 0, sizeof(IndexHeader));
+    if (entries) *entries = NULL;
+
+    store_file_path(path, dir, STORE_INDEX_FILE);
+    f = fopen(path, "rb");
+    if (!f) return 0;
+
+    if (fread(header, sizeof(IndexHeader), 1, f) != 1 ||
+        memcmp(header->magic, STORE_INDEX_MAGIC, 4) != 0 || header->version != STORE_VERSION) {
+        /* Índice ilegible: se rehace desde cero */
+        memset(header, 0, sizeof(IndexHeader));
+        fclose(f);
+        return 0;
+    }
+
+    if (entries && header->n_entries > 0) {
+        *entries = malloc(header->n_entries * sizeof(IndexEntry));
+        if (!*entries ||
+            fread(*entries, sizeof(IndexEntry), header->n_entries, f) != header->n_entries) {
+            free(*entries);
+            *entries = NULL;
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/* Orden del índice: por hash y, a igual hash, por registro */
+static int compare_entries(const void* a, const void* b) {
+    const IndexEntry* x = (const IndexEntry*)a;
+    const IndexEntry* y = (const IndexEntry*)b;
+    if (x->hash != y->hash) return (x->hash < y->hash) ? -1 : 1;
+    if (x->record != y->record) return (x->record < y->record) ? -1 : 1;
+    return 0;
+}
+
+/* Ordena y deja solo la última aparición de cada hash; devuelve cuántas quedan */
+static size_t sort_unique(IndexEntry* entries, size_t n) {
+    size_t i, kept = 0;
+
+    qsort(entries, n, sizeof(IndexEntry), compare_entries);
+    for (i = 0; i < n; i++) {
+        if (i + 1 < n && entries[i + 1].hash == entries[i].hash) continue;
+        entries[kept++] = entries[i];
+    }
+    return kept;
+}
+
+/**
+ * Suma al índice los registros [indexados, n_records) de records.bin y lo reescribe
+ * (temporal + rename: los lectores ven el índice viejo o el nuevo, nunca uno a medias).
+ */
+static int rebuild_index(const char* dir, int fd, long n_records) {
+    char path[MAX_PATH + 16], tmp_path[MAX_PATH + 24];
+    IndexHeader header;
+    IndexEntry* entries;
+    StoreRecord* batch;
+    size_t n = 0;
+    long r, count, i;
+    FILE* f;
+    int ok;
+
+    if (load_index(dir, &header, &entries) != 0) return -1;
+    if ((long)header.n_records > n_records) {
+        /* El índice es de otro records.bin: se rehace completo */
+        free(entries);
+        memset(&header, 0, sizeof(header));
+        entries = NULL;
+    }
+
+    n = (size_t)header.n_entries;
+    entries = realloc(entries, (n + (size_t)(n_records - (long)header.n_records) + 1) * sizeof(IndexEntry));
+    batch = malloc(STORE_READ_BATCH * sizeof(StoreRecord));
+    if (!entries || !batch) {
+        free(entries);
+        free(batch);
+        return -1;
+    }
+
+    for (r = (long)header.n_records; r < n_records; r += count) {
+        count = n_records - r < STORE_READ_BATCH ? n_records - r : STORE_READ_BATCH;
+        if (read_full(fd, batch, (size_t)count * sizeof(StoreRecord), record_offset((uint64_t)r)) != 0) {
+            free(entries);
+            free(batch);
+            return -1;
+        }
+        for (i = 0; i < count; i++) {
+            if (batch[i].check != record_check(&batch[i])) continue;
+            entries[n].hash = batch[i].path_hash;
+            entries[n].record = (uint64_t)(r + i);
+            n++;
+        }
+    }
+    free(batch);
+
+    n = sort_unique(entries, n);
+    memcpy(header.magic, STORE_INDEX_MAGIC, 4);
+    header.version = STORE_VERSION;
+    header.n_records = (uint64_t)n_records;
+    header.n_entries = (uint64_t)n;
+
+    store_file_path(path, dir, STORE_INDEX_FILE);
+    sprintf(tmp_path, "%s.tmp", path);
+    f = fopen(tmp_path, "wb");
+    if (!f) {
+        perror("almacen: no se pudo crear el indice temporal");
+        free(entries);
+        return -1;
+    }
+    ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+         (n == 0 || fwrite(entries, sizeof(IndexEntry), n, f) == n);
+    if (fclose(f) != 0 || !ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "almacen: error escribiendo %s\n", path);
+        remove(tmp_path);
+        free(entries);
+        return -1;
+    }
+
+    free(entries);
+    return 0;
+}
+
+/* Agregado con el lock ya tomado sobre records.bin (fd) */
+static int append_locked(const char* dir, int fd, const char* path, StoreRecord* entry,
+                         const float* flux, int n_flux) {
+    char records_path[MAX_PATH + 16], blob_path[MAX_PATH + 16];
+    IndexHeader index;
+    struct stat st;
+    off_t blob_end;
+    long n_records;
+    int blob, ok;
+
+    store_file_path(records_path, dir, STORE_RECORDS_FILE);
+    store_file_path(blob_path, dir, STORE_BLOB_FILE);
+
+    if (fstat(fd, &st) != 0) {
+        perror(records_path);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        StoreHeader header;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, STORE_MAGIC, 4);
+        header.version = STORE_VERSION;
+        header.record_size = (int)sizeof(StoreRecord);
+        if (write_full(fd, &header, sizeof(header)) != 0) {
+            perror(records_path);
+            return -1;
+        }
+    } else if ((n_records = count_records(fd)) < 0) {
+        fprintf(stderr, "Error: %s no es un almacen de esta version\n", records_path);
+        return -1;
+    } else if (record_offset((uint64_t)n_records) != st.st_size &&
+               ftruncate(fd, record_offset((uint64_t)n_records)) != 0) {
+        /* Un agregado anterior se cortó a mitad del registro: el pedazo se descarta */
+        perror(records_path);
+        return -1;
+    }
+
+    /* 1. Ruta y flux al final del blob, bajados a disco antes de publicar el registro */
+    blob = open(blob_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (blob < 0 || (blob_end = lseek(blob, 0, SEEK_END)) < 0) {
+        perror(blob_path);
+        if (blob >= 0) close(blob);
+        return -1;
+    }
+
+    entry->path_hash = store_path_hash(path);
+    entry->path_len = (int)strlen(path);
+    entry->path_offset = (uint64_t)blob_end;
+    entry->flux_offset = (uint64_t)blob_end + (uint64_t)entry->path_len;
+    entry->n_flux = n_flux;
+    entry->check = record_check(entry);
+
+    ok = write_full(blob, path, (size_t)entry->path_len) == 0 &&
+         write_full(blob, flux, (size_t)n_flux * sizeof(float)) == 0 && fdatasync(blob) == 0;
+    close(blob);
+    if (!ok) {
+        perror(blob_path);
+        return -1;
+    }
+
+    /* 2. El registro: una sola escritura al final */
+    if (write_full(fd, entry, sizeof(StoreRecord)) != 0) {
+        perror(records_path);
+        return -1;
+    }
+
+    /* 3. Índice: se rehace cuando quedan demasiados registros sin indexar */
+    n_records = count_records(fd);
+    if (n_records >= 0 && load_index(dir, &index, NULL) == 0 &&
+        (n_records - (long)index.n_records >= STORE_INDEX_TAIL || (long)index.n_records > n_records) &&
+        rebuild_index(dir, fd, n_records) != 0) {
+        fprintf(stderr, "Advertencia: no se pudo rehacer el indice de %s\n", dir);
+    }
+    return 0;
+}
+
+int store_append(const char* dir, const char* path, const StoreRecord* record,
+                 const float* flux, int n_flux) {
+    char records_path[MAX_PATH + 16];
+    StoreRecord entry = *record;
+    int fd, status;
+
+    if (strlen(dir) >= MAX_PATH) {
+        fprintf(stderr, "Error: ruta del almacen demasiado larga\n");
+        return -1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror(dir);
+        return -1;
+    }
+
+    store_file_path(records_path, dir, STORE_RECORDS_FILE);
+    fd = open(records_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        perror(records_path);
+        return -1;
+    }
+
+    /* Un solo escritor a la vez (los grupos del modo lote agregan en paralelo) */
+    if (flock(fd, LOCK_EX) != 0) {
+        perror(records_path);
+        close(fd);
+        return -1;
+    }
+    status = append_locked(dir, fd, path, &entry, flux, n_flux);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return status;
+}
+
+int store_lookup(const char* dir, const char* path, StoreRecord* record) {
+    char records_path[MAX_PATH + 16];
+    uint64_t hash = store_path_hash(path);
+    IndexHeader header;
+    IndexEntry* entries;
+    StoreRecord* tail;
+    long n_records, found = -1, r;
+    size_t lo, hi;
+    int fd;
+
+    store_file_path(records_path, dir, STORE_RECORDS_FILE);
+    fd = open(records_path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    n_records = count_records(fd);
+    if (n_records < 0 || load_index(dir, &header, &entries) != 0) {
+        close(fd);
+        return -1;
+    }
+    if ((long)header.n_records > n_records) {
+        /* El índice es de otro records.bin: se recorre todo */
+        free(entries);
+        entries = NULL;
+        memset(&header, 0, sizeof(header));
+    }
+
+    /* 1. Búsqueda binaria en la parte indexada */
+    lo = 0;
+    hi = (size_t)header.n_entries;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < (size_t)header.n_entries && entries[lo].hash == hash) {
+        found = (long)entries[lo].record;
+    }
+    free(entries);
+
+    /* 2. Los registros agregados después del índice (los más nuevos ganan) */
+    if (n_records > (long)header.n_records) {
+        long n_tail = n_records - (long)header.n_records;
+
+        tail = malloc((size_t)n_tail * sizeof(StoreRecord));
+        if (tail && read_full(fd, tail, (size_t)n_tail * sizeof(StoreRecord),
+                              record_offset(header.n_records)) == 0) {
+            for (r = 0; r < n_tail; r++) {
+                if (tail[r].path_hash == hash && tail[r].check == record_check(&tail[r])) {
+                    found = (long)header.n_records + r;
+                }
+            }
+        }
+        free(tail);
+    }
+
+    if (found < 0 || read_full(fd, record, sizeof(StoreRecord), record_offset((uint64_t)found)) != 0 ||
+        record->check != record_check(record)) {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+float* store_read_flux(const char* dir, const StoreRecord* record) {
+    char blob_path[MAX_PATH + 16];
+    float* flux;
+    int fd;
+
+    store_file_path(blob_path, dir, STORE_BLOB_FILE);
+    fd = open(blob_path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    flux = malloc(((size_t)record->n_flux + 1) * sizeof(float));
+    if (flux && read_full(fd, flux, (size_t)record->n_flux * sizeof(float),
+                          (off_t)record->flux_offset) != 0) {
+        free(flux);
+        flux = NULL;
+    }
+
+    close(fd);
+    return flux;
+}
+
+int store_print_track(const char* dir, const char* path) {
+    StoreRecord record;
+    float* flux;
+    int t;
+
+    if (store_lookup(dir, path, &record) != 0) {
+        fprintf(stderr, "%s no esta en el almacen %s\n", path, dir);
+        return -1;
+    }
+    flux = store_read_flux(dir, &record);
+    if (!flux) {
+        fprintf(stderr, "Error: no se pudo leer el flux de %s en %s\n", path, dir);
+        return -1;
+    }
+
+    fprintf(stderr, "%s: BPM %.2f, confianza %.4f, %.2f s a %d Hz (%d frames de flux)\n", path,
+            record.bpm, record.confidence, record.duration_s, record.sample_rate, record.n_flux);
+    printf("tiempo_seg,flux_onset,bpm_estimado\n");
+    for (t = 0; t < record.n_flux; t++) {
+        printf("%.6f,%.6f,%.2f\n", (float)t * record.hop / record.sample_rate, flux[t], record.bpm);
+    }
+
+    free(flux);
+    return 0;
+}
+
+int store_query_bpm(const char* dir, float bpm_lo, float bpm_hi) {
+    char records_path[MAX_PATH + 16], blob_path[MAX_PATH + 16];
+    char track[MAX_PATH];
+    StoreRecord* records;
+    IndexEntry* latest;
+    long n_records, n = 0, i;
+    size_t n_latest;
+    int fd, blob, matches = 0;
+
+    store_file_path(records_path, dir, STORE_RECORDS_FILE);
+    store_file_path(blob_path, dir, STORE_BLOB_FILE);
+
+    fd = open(records_path, O_RDONLY);
+    if (fd < 0 || (n_records = count_records(fd)) < 0) {
+        fprintf(stderr, "Error: no se pudo leer el almacen %s\n", dir);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    /* 1. Todo records.bin en una lectura secuencial */
+    records = malloc(((size_t)n_records + 1) * sizeof(StoreRecord));
+    latest = malloc(((size_t)n_records + 1) * sizeof(IndexEntry));
+    if (!records || !latest ||
+        read_full(fd, records, (size_t)n_records * sizeof(StoreRecord), record_offset(0)) != 0) {
+        fprintf(stderr, "Error: no se pudo leer el almacen %s\n", dir);
+        free(records);
+        free(latest);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    /* 2. Un track reanalizado tiene varios registros: cuenta solo el último */
+    for (i = 0; i < n_records; i++) {
+        if (records[i].check != record_check(&records[i])) continue;
+        latest[n].hash = records[i].path_hash;
+        latest[n].record = (uint64_t)i;
+        n++;
+    }
+    n_latest = sort_unique(latest, (size_t)n);
+
+    /* 3. Filtro por BPM; solo se leen del blob las rutas que coinciden (en orden de registro) */
+    blob = open(blob_path, O_RDONLY);
+    printf("ruta,bpm,confianza,duracion_seg,sample_rate\n");
+    for (i = 0; i < (long)n_latest; i++) {
+        latest[i].hash = 0;   /* de nuevo en orden de registro */
+    }
+    qsort(latest, n_latest, sizeof(IndexEntry), compare_entries);
+
+    for (i = 0; i < (long)n_latest; i++) {
+        const StoreRecord* r = &records[latest[i].record];
+        int len = r->path_len < MAX_PATH - 1 ? r->path_len : MAX_PATH - 1;
+
+        if (r->bpm < bpm_lo || r->bpm > bpm_hi) continue;
+        if (blob < 0 || read_full(blob, track, (size_t)len, (off_t)r->path_offset) != 0) {
+            len = 0;
+        }
+        track[len] = '\0';
+        printf("%s,%.2f,%.4f,%.2f,%d\n", track, r->bpm, r->confidence, r->duration_s, r->sample_rate);
+        matches++;
+    }
+
+    if (blob >= 0) close(blob);
+    free(latest);
+    free(records);
+    return matches;
+}
@@ -0,0 +1,171 @@
+/* src/tempogram.c */
+#include "tempogram.h"
+#include "bpm.h"
+#include "stft.h"
+#include "mpi_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+
+/**
+ * @brief BPM y confianza de una ventana de la curva de flux.
+ * Solo se evalúan los lags del rango de BPM: O(largo * lags) en vez de O(largo^2).
+ * La ventana se centra (se le resta la media) para que la ACF normalizada sea comparable.
+ */
+static void analyze_window(const float* flux, int len, int lag_min, int lag_max,
+                           const Config* cfg, float* centered, float* bpm, float* confidence) {
+    double mean = 0.0, energy = 0.0, sum, best_value = -1.0;
+    int t, lag, best_lag = 0;
+
+    for (t = 0; t < len; t++) {
+        mean += flux[t];
+    }
+    mean /= len;
+
+    for (t = 0; t < len; t++) {
+        centered[t] = (float)(flux[t] - mean);
+        energy += (double)centered[t] * centered[t];
+    }
+
+    if (lag_max >= len) {
+        lag_max = len - 1;
+    }
+
+    /* Autocorrelación solo en [lag_min, lag_max] y búsqueda del pico */
+    for (lag = lag_min; lag <= lag_max; lag++) {
+        sum = 0.0;
+        for (t = 0; t < len - lag; t++) {
+            sum += centered[t] * centered[t + lag];
+        }
+        if (sum > best_value) {
+            best_value = sum;
+            best_lag = lag;
+        }
+    }
+
+    if (best_lag == 0 || energy <= 0.0) {
+        /* Ventana muda o demasiado corta para el rango de tempo */
+        *bpm = 0.0f;
+        *confidence = 0.0f;
+        return;
+    }
+
+    *bpm = bpm_from_lag(cfg, best_lag);
+    *confidence = (float)(best_value / energy);
+    if (*confidence < 0.0f) *confidence = 0.0f;
+    if (*confidence > 1.0f) *confidence = 1.0f;
+}
+
+Tempogram* compute_tempogram_parallel(const float* flux, int num_frames, const Config* cfg,
+                                      MPI_Comm comm) {
+    Tempogram* tempogram = NULL;
+    float flux_sample_rate_hz = (float)cfg->fs / (float)cfg->hop;
+    float *flux_all, *local, *centered, *gathered = NULL, *gather_temp = NULL;
+    int window_frames, hop_frames, num_windows, local_windows;
+    int lag_min, lag_max, w, idx;
+    int rank, procs_number;
+
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs_number);
+
+    /* 1. Ventanas en frames de flux */
+    window_frames = (int)floor(cfg->tempo_window_s * flux_sample_rate_hz + 0.5);
+    hop_frames = (int)floor(cfg->tempo_hop_s * flux_sample_rate_hz + 0.5);
+    if (hop_frames < 1) hop_frames = 1;
+    if (window_frames > num_frames) window_frames = num_frames;
+    if (window_frames < 2) window_frames = 2 <= num_frames ? 2 : num_frames;
+    num_windows = (num_frames >= window_frames) ? 1 + (num_frames - window_frames) / hop_frames : 0;
+
+    bpm_lag_range(cfg, &lag_min, &lag_max);
+
+    /* 2. Todos necesitan la curva de flux (es chica: un float por frame) */
+    flux_all = malloc((num_frames > 0 ? num_frames : 1) * sizeof(float));
+    centered = malloc((window_frames > 0 ? window_frames : 1) * sizeof(float));
+    local_windows = calculate_local_frames(rank, num_windows, procs_number);
+    local = malloc((local_windows > 0 ? local_windows : 1) * 2 * sizeof(float));
+    if (!flux_all || !centered || !local) {
+        fprintf(stderr, "Error: No se pudo alocar memoria para el tempograma\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (rank == 0) {
+        int t;
+        for (t = 0; t < num_frames; t++) flux_all[t] = flux[t];
+    }
+    MPI_Bcast(flux_all, num_frames, MPI_FLOAT, 0, comm);
+
+    /* 3. Ventanas de este proceso (distribución cíclica, como los frames del STFT) */
+    idx = 0;
+    for (w = rank; w < num_windows; w += procs_number) {
+        analyze_window(flux_all + (size_t)w * hop_frames, window_frames, lag_min, lag_max, cfg,
+                       centered, &local[2 * idx], &local[2 * idx + 1]);
+        idx++;
+    }
+
+    /* 4. Recolectar (bpm, confianza) de cada ventana en orden */
+    if (rank == 0) {
+        gathered = malloc((num_windows > 0 ? num_windows : 1) * 2 * sizeof(float));
+        gather_temp = malloc((num_windows > 0 ? num_windows : 1) * 2 * sizeof(float));
+        if (!gathered || !gather_temp) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para el tempograma\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    gather_spectrogram_into(local, local_windows, num_windows, 2, comm, gather_temp, gathered);
+
+    if (rank == 0) {
+        tempogram = malloc(sizeof(Tempogram));
+        if (!tempogram) {
+            fprintf(stderr, "Error: No se pudo alocar memoria para el tempograma\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        tempogram->num_windows = num_windows;
+        tempogram->window_frames = window_frames;
+        tempogram->hop_frames = hop_frames;
+        tempogram->bpm = malloc((num_windows > 0 ? num_windows : 1) * sizeof(float));
+        tempogram->confidence = malloc((num_windows > 0 ? num_windows : 1) * sizeof(float));
+
+        for (w = 0; w < num_windows; w++) {
+            tempogram->bpm[w] = gathered[2 * w];
+            tempogram->confidence[w] = gathered[2 * w + 1];
+        }
+        free(gathered);
+        free(gather_temp);
+    }
+
+    free(flux_all);
+    free(centered);
+    free(local);
+    return tempogram;
+}
+
+void write_tempogram_csv(const char* filename, const Tempogram* tempogram, const Config* cfg) {
+    FILE* f;
+    float flux_sample_rate_hz = (float)cfg->fs / (float)cfg->hop;
+    int w;
+
+    f = fopen(filename, "w");
+    if (!f) {
+        perror("Error al abrir archivo CSV del tempograma");
+        return;
+    }
+
+    fprintf(f, "tiempo_inicio_seg,tiempo_centro_seg,bpm,confianza\n");
+    for (w = 0; w < tempogram->num_windows; w++) {
+        float start = (float)(w * tempogram->hop_frames) / flux_sample_rate_hz;
+        float center = start + 0.5f * tempogram->window_frames / flux_sample_rate_hz;
+        fprintf(f, "%.3f,%.3f,%.2f,%.4f\n", start, center, tempogram->bpm[w], tempogram->confidence[w]);
+    }
+
+    fclose(f);
+    printf("\nTempograma escrito en %s (%d ventanas)\n", filename, tempogram->num_windows);
+}
+
+void free_tempogram(Tempogram* tempogram) {
+    if (!tempogram) return;
+    free(tempogram->bpm);
+    free(tempogram->confidence);
+    free(tempogram);
+}
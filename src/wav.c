@@ -1,5 +1,6 @@
 #include "wav.h"
 #include "common.h"
+#include "pcm.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
@@ -8,33 +9,70 @@
 #include <ctype.h>
 #include <errno.h>
 
+/* Constantes del hash (las mismas de FNV-1a 64 bits) */
+#define HASH_OFFSET ((uint64_t)0xcbf29ce484222325ULL)
+#define HASH_PRIME  ((uint64_t)0x100000001b3ULL)
+
+/**
+ * Hash de 64 bits que consume el bloque de a 8 bytes (palabra por palabra) en vez de
+ * byte por byte como FNV-1a clásico, así no es el cuello de botella en archivos grandes.
+ * No es criptográfico: solo sirve para detectar si el audio cambió entre corridas.
+ */
+uint64_t wav_hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t h = seed ? seed : HASH_OFFSET;
+    uint64_t w;
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        memcpy(&w, p + i, 8);
+        h ^= w;
+        h *= HASH_PRIME;
+        h ^= h >> 29;
+    }
 
+    /* Bytes sobrantes (menos de 8) */
+    for (; i < len; i++) {
+        h ^= p[i];
+        h *= HASH_PRIME;
+    }
 
-/* Lectura de WAV PCM16 (mono) */
-int wav_read(const char *path, WAVFile *out) {
-    FILE *f;
+    /* Mezclamos también la longitud para distinguir prefijos */
+    h ^= (uint64_t)len;
+    h *= HASH_PRIME;
+    return h;
+}
+
+/* Frames que se leen y decodifican por bloque (el bloque entra holgado en L2) */
+#define WAV_BLOCK_FRAMES 8192
+
+/* Formato y ubicación del chunk data de un WAV */
+typedef struct {
+    int samplerate;
+    int channels;
+    int bits_per_sample;
+    pcm_format_t format;
+    long data_pos;
+    uint32_t data_size;
+} WavHeader;
+
+/**
+ * Recorre los chunks RIFF hasta encontrar fmt y data (sin leer el audio).
+ * @return 0 si el formato es soportado y hay datos, -1 si no (el error ya se informó)
+ */
+static int wav_parse_header(FILE *f, const char *path, WavHeader *hdr) {
     char riff_id[4];
     char wave_id[4];
     int samplerate = 0, channels = 0, bits_per_sample = 0;
     uint32_t data_size = 0;
     long data_pos = 0;
     uint16_t audio_format = 0;
-    int total_samples, frames, i, c;
-    short *raw;
-    float *samples;
-    float acc;
-    
-    f = fopen(path, "rb");
-    if (!f) {
-        perror("wav_read fopen");
-        return -1;
-    }
+    pcm_format_t pcm_fmt;
  
     /* Estructura WAV: RIFF header + chunks */
     fread(riff_id, 1, 4, f);
     if (memcmp(riff_id, "RIFF", 4) != 0) {
         fprintf(stderr, "wav_read: No es un archivo RIFF válido (%s)\n", path);
-        fclose(f);
         return -1;
     }
 
@@ -43,7 +81,6 @@ int wav_read(const char *path, WAVFile *out) {
     fread(wave_id, 1, 4, f);
     if (memcmp(wave_id, "WAVE", 4) != 0) {
         fprintf(stderr, "wav_read: Faltante encabezado WAVE (%s)\n", path);
-        fclose(f);
         return -1;
     }
 
@@ -56,17 +93,30 @@ int wav_read(const char *path, WAVFile *out) {
         if (fread(&chunk_size, 4, 1, f) != 1) break;
 
         if (memcmp(chunk_id, "fmt ", 4) == 0) {
-            uint16_t fmt_code;
-            fread(&fmt_code, sizeof(uint16_t), 1, f);
-            fread(&channels, sizeof(uint16_t), 1, f);
-            fread(&samplerate, sizeof(uint32_t), 1, f);
-            fseek(f, 6, SEEK_CUR); /* skip byte_rate + block_align */
-            fread(&bits_per_sample, sizeof(uint16_t), 1, f);
-            audio_format = fmt_code;
-
-            /* Saltar bytes restantes si el fmt chunk es más largo (PCM=16 bytes total) */
-            if (chunk_size > 16)
-                fseek(f, chunk_size - 16, SEEK_CUR);
+            unsigned char fmt[40];
+            uint32_t fmt_len = chunk_size < sizeof(fmt) ? chunk_size : sizeof(fmt);
+            uint16_t u16;
+            uint32_t u32;
+
+            if (chunk_size < 16 || fread(fmt, 1, fmt_len, f) != fmt_len) {
+                fprintf(stderr, "wav_read: Chunk fmt inválido (%s)\n", path);
+                return -1;
+            }
+
+            memcpy(&u16, fmt, 2);       audio_format = u16;
+            memcpy(&u16, fmt + 2, 2);   channels = u16;
+            memcpy(&u32, fmt + 4, 4);   samplerate = (int)u32;
+            memcpy(&u16, fmt + 14, 2);  bits_per_sample = u16;
+
+            /* EXTENSIBLE: el formato real está en los 2 primeros bytes del GUID SubFormat */
+            if (audio_format == WAVE_FORMAT_EXTENSIBLE && fmt_len >= 40) {
+                memcpy(&u16, fmt + 24, 2);
+                audio_format = u16;
+            }
+
+            /* Saltar bytes restantes si el fmt chunk es más largo */
+            if (chunk_size > fmt_len)
+                fseek(f, chunk_size - fmt_len, SEEK_CUR);
         }
         else if (memcmp(chunk_id, "data", 4) == 0) {
             data_pos = ftell(f);
@@ -77,65 +127,253 @@ int wav_read(const char *path, WAVFile *out) {
             /* Saltar chunks desconocidos */
             fseek(f, chunk_size, SEEK_CUR);
         }
+
+        /* Los chunks de tamaño impar llevan un byte de relleno */
+        if (chunk_size & 1)
+            fseek(f, 1, SEEK_CUR);
     }
 
-    if (audio_format != 1) {
-        fprintf(stderr, "wav_read: Formato no PCM (%s)\n", path);
-        fclose(f);
+    if (pcm_format_from_wav(audio_format, bits_per_sample, &pcm_fmt) != 0) {
+        fprintf(stderr, "wav_read: Formato no soportado (formato %d, %d bits) (%s)\n",
+                audio_format, bits_per_sample, path);
+        return -1;
+    }
+
+    if (channels <= 0 || data_pos == 0 || data_size == 0) {
+        fprintf(stderr, "wav_read: No se encontró chunk de datos (%s)\n", path);
+        return -1;
+    }
+
+    hdr->samplerate = samplerate;
+    hdr->channels = channels;
+    hdr->bits_per_sample = bits_per_sample;
+    hdr->format = pcm_fmt;
+    hdr->data_pos = data_pos;
+    hdr->data_size = data_size;
+    return 0;
+}
+
+/* Lectura de WAV PCM 16/24/32 bits o float32 (incluye WAVE_FORMAT_EXTENSIBLE), mezclado a mono */
+int wav_read(const char *path, WAVFile *out) {
+    out->samples = NULL;
+    out->capacity = 0;
+    out->channel[0] = out->channel[1] = NULL;
+    out->channel_capacity = 0;
+    return wav_read_reuse(path, out);
+}
+
+int wav_probe(const char *path, int *frames, int *samplerate) {
+    FILE *f;
+    WavHeader hdr;
+    int status;
+
+    f = fopen(path, "rb");
+    if (!f) {
+        perror("wav_probe fopen");
+        return -1;
+    }
+
+    status = wav_parse_header(f, path, &hdr);
+    fclose(f);
+    if (status != 0) {
+        return -1;
+    }
+
+    *frames = (int)(hdr.data_size / (uint32_t)(hdr.channels * pcm_bytes_per_sample(hdr.format)));
+    *samplerate = hdr.samplerate;
+    return 0;
+}
+
+/* Crece los buffers de los dos canales (solo crecen, como samples) */
+static int wav_reserve_channels(WAVFile *out, int frames) {
+    int c;
+
+    if (out->channel[0] && out->channel[1] && frames <= out->channel_capacity) {
+        return 0;
+    }
+    for (c = 0; c < 2; c++) {
+        free(out->channel[c]);
+        out->channel[c] = malloc(sizeof(float) * (frames > 0 ? frames : 1));
+    }
+    out->channel_capacity = frames > 0 ? frames : 1;
+    if (!out->channel[0] || !out->channel[1]) {
+        free(out->channel[0]);
+        free(out->channel[1]);
+        out->channel[0] = out->channel[1] = NULL;
+        out->channel_capacity = 0;
         return -1;
     }
-    if (bits_per_sample != 16) {
-        fprintf(stderr, "wav_read: Solo se soporta PCM16 (%d bits)\n", bits_per_sample);
+    return 0;
+}
+
+/**
+ * Lectura por bloques compartida por wav_read_reuse y wav_read_channels.
+ * pair: -1 = solo mono, 0 = además izquierdo/derecho, 1 = además medio/lateral.
+ */
+static int wav_read_into(const char *path, WAVFile *out, int pair) {
+    FILE *f;
+    WavHeader hdr;
+    int block_align, frames, done, n;
+    unsigned char *block;
+    float *samples;
+    uint64_t hash;
+    
+    f = fopen(path, "rb");
+    if (!f) {
+        perror("wav_read fopen");
+        return -1;
+    }
+
+    if (wav_parse_header(f, path, &hdr) != 0) {
         fclose(f);
         return -1;
     }
 
-    if (data_pos == 0 || data_size == 0) {
-        fprintf(stderr, "wav_read: No se encontró chunk de datos (%s)\n", path);
+
+    /* Leemos y decodificamos por bloques: no hace falta el buffer crudo completo */
+    block_align = hdr.channels * pcm_bytes_per_sample(hdr.format);
+    frames = (int)(hdr.data_size / (uint32_t)block_align);
+
+    /* El buffer de muestras solo crece: un archivo más corto reutiliza el anterior */
+    samples = out->samples;
+    if (!samples || frames > out->capacity) {
+        samples = malloc(sizeof(float) * (frames > 0 ? frames : 1));
+    }
+    block = malloc((size_t)WAV_BLOCK_FRAMES * block_align);
+    if (!samples || !block) {
+        fprintf(stderr, "wav_read: Sin memoria (%s)\n", path);
+        if (samples != out->samples) free(samples);
+        free(block);
+        fclose(f);
+        return -1;
+    }
+    if (samples != out->samples) {
+        free(out->samples);
+        out->samples = samples;
+        out->capacity = frames > 0 ? frames : 1;
+    }
+    if (pair >= 0 && wav_reserve_channels(out, frames) != 0) {
+        fprintf(stderr, "wav_read: Sin memoria para los canales (%s)\n", path);
+        free(block);
         fclose(f);
         return -1;
     }
 
-    /* Leemos los datos de audio */
-    total_samples = data_size / 2; /* 2 bytes por muestra */
-    raw = malloc(data_size);
-    fseek(f, data_pos, SEEK_SET);
-    fread(raw, sizeof(short), total_samples, f);
-    fclose(f);
+    fseek(f, hdr.data_pos, SEEK_SET);
+    hash = 0;
+
+    for (done = 0; done < frames; done += n) {
+        n = frames - done;
+        if (n > WAV_BLOCK_FRAMES) n = WAV_BLOCK_FRAMES;
+
+        if (fread(block, (size_t)block_align, (size_t)n, f) != (size_t)n) {
+            /* Archivo truncado: nos quedamos con lo que se pudo leer */
+            fprintf(stderr, "wav_read: Chunk de datos incompleto (%s)\n", path);
+            frames = done;
+            break;
+        }
+
+        /* Huella del audio para la cache de resultados (encadenada bloque a bloque) */
+        hash = wav_hash_bytes(block, (size_t)n * block_align, hash);
 
-    /* Convertir a float mono */
-    frames = total_samples / channels;
-    samples = malloc(sizeof(float) * frames);
-
-    if (channels == 1) {
-        for (i = 0; i < frames; i++)
-            samples[i] = raw[i] / 32768.0f;
-    } else {
-        for (i = 0; i < frames; i++) {
-            acc = 0.0;
-            for (c = 0; c < channels; c++)
-                acc += raw[i * channels + c] / 32768.0;
-            samples[i] = acc / channels;
+        /* Conversión a float + mezcla a mono en una sola pasada (con los canales, la
+           misma pasada los separa y deja la mezcla) */
+        if (pair >= 0) {
+            pcm_decode_pair(block, out->channel[0] + done, out->channel[1] + done, samples + done,
+                            n, hdr.channels, hdr.format, pair);
+        } else {
+            pcm_decode_downmix(block, samples + done, n, hdr.channels, hdr.format);
         }
     }
 
-    free(raw);
+    free(block);
+    fclose(f);
 
-    strncpy(out->filename, path, sizeof(out->filename));
-    out->samplerate = samplerate;
+    strncpy(out->filename, path, sizeof(out->filename) - 1);
+    out->filename[sizeof(out->filename) - 1] = '\0';
+    out->samplerate = hdr.samplerate;
     out->n_samples = frames;
-    out->channels = channels;
-    out->samples = samples;
+    out->channels = hdr.channels;
+    out->bits_per_sample = hdr.bits_per_sample;
+    out->data_hash = hash;
 
     return 0;
 }
 
+/* Igual que wav_read, pero reutiliza out->samples si tiene capacidad suficiente */
+int wav_read_reuse(const char *path, WAVFile *out) {
+    return wav_read_into(path, out, -1);
+}
+
+int wav_read_channels(const char *path, WAVFile *out, int mid_side) {
+    return wav_read_into(path, out, mid_side ? 1 : 0);
+}
+
 /* Libera la memoria */
 void wav_free(WAVFile *w) {
     if (w && w->samples) {
         free(w->samples);
         w->samples = NULL;
     }
+    if (w) {
+        free(w->channel[0]);
+        free(w->channel[1]);
+        w->channel[0] = w->channel[1] = NULL;
+        w->channel_capacity = 0;
+        w->capacity = 0;
+    }
+}
+
+/* Escribe 'bytes' en little endian (el formato WAV lo es siempre) */
+static void put_le(unsigned char *p, uint32_t value, int bytes) {
+    int i;
+    for (i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+int wav_write_float(const char *path, const float *samples, int n_samples, int samplerate) {
+    unsigned char header[58];
+    uint32_t data_bytes = (uint32_t)n_samples * 4;
+    FILE *f = fopen(path, "wb");
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    /* RIFF + fmt (18 bytes, formato float) + fact (obligatorio fuera de PCM) + data */
+    memcpy(header, "RIFF", 4);
+    put_le(header + 4, 50 + data_bytes, 4);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    put_le(header + 16, 18, 4);
+    put_le(header + 20, WAVE_FORMAT_IEEE_FLOAT, 2);
+    put_le(header + 22, 1, 2);                        /* mono */
+    put_le(header + 24, (uint32_t)samplerate, 4);
+    put_le(header + 28, (uint32_t)samplerate * 4, 4); /* bytes por segundo */
+    put_le(header + 32, 4, 2);                        /* bytes por frame */
+    put_le(header + 34, 32, 2);                       /* bits por muestra */
+    put_le(header + 36, 0, 2);                        /* sin extensión */
+    memcpy(header + 38, "fact", 4);
+    put_le(header + 42, 4, 4);
+    put_le(header + 46, (uint32_t)n_samples, 4);
+    memcpy(header + 50, "data", 4);
+    put_le(header + 54, data_bytes, 4);
+
+    /* Las muestras float ya están en little endian en x86 */
+    if (fwrite(header, 1, sizeof(header), f) != sizeof(header) ||
+        fwrite(samples, sizeof(float), (size_t)n_samples, f) != (size_t)n_samples) {
+        perror(path);
+        fclose(f);
+        return -1;
+    }
+
+    if (fclose(f) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
 }
 
 /* Guarda CSV con features */
@@ -227,3 +465,61 @@ int load_wav_list(const char *path, char files[MAX_FILES][MAX_PATH]) {
     return count; /* >=0 líneas cargadas, -1 si apertura falló */
 }
 
+
+char *load_wav_list_all(const char *path, int *count, size_t *bytes) {
+    FILE *f;
+    char buf[4096]; /* buffer grande para detectar líneas largas */
+    char *list = NULL, *grown;
+    size_t used = 0, capacity = 0, len;
+    int truncated, c;
+    char *p;
+
+    *count = 0;
+    *bytes = 0;
+
+    f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+
+    while (fgets(buf, sizeof(buf), f)) {
+        /* Mismas reglas que load_wav_list: recorte, vacías y comentarios */
+        truncated = (strchr(buf, '\n') == NULL && !feof(f));
+        rstrip(buf);
+        p = buf;
+        lstrip(&p);
+        if (truncated) { while ((c = fgetc(f)) != '\n' && c != EOF) {} }
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        len = strlen(p);
+        if (len >= MAX_PATH) len = MAX_PATH - 1;
+
+        /* Las rutas van una detrás de otra, cada una terminada en '\0' */
+        if (used + len + 1 > capacity) {
+            capacity = (used + len + 1) * 2;
+            grown = realloc(list, capacity);
+            if (!grown) {
+                free(list);
+                fclose(f);
+                *count = 0;
+                return NULL;
+            }
+            list = grown;
+        }
+        memcpy(list + used, p, len);
+        list[used + len] = '\0';
+        used += len + 1;
+        (*count)++;
+    }
+
+    fclose(f);
+
+    /* Lista vacía: buffer válido de un byte para distinguirla de un error de apertura */
+    if (!list) {
+        list = calloc(1, 1);
+    }
+    *bytes = used;
+    return list;
+}